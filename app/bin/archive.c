@@ -452,3 +452,121 @@ BOOL_T UnpackArchiveFor(
     return TRUE;
 }
 
+
+/**************************************************************************
+ * Open an archive for reading entries with ReadArchiveEntry
+ *
+ * \param IN pathName the name of the archive
+ *
+ * \returns the archive, NULL if it can't be opened (the user was told)
+ */
+struct zip * OpenArchive(
+    const char * pathName)
+{
+    struct zip *za;
+    char buf[100];
+    int err;
+
+    char *destBuffer = MyStrdup(pathName);
+#ifdef WINDOWS
+    destBuffer = Convert2UTF8(destBuffer);
+#endif // WINDOWS
+
+    za = zip_open(destBuffer, 0, &err);
+    MyFree(destBuffer);
+    if (za == NULL) {
+        zip_error_to_str(buf, sizeof(buf), err, errno);
+        NoticeMessage(MSG_ZIP_OPEN_FAIL, _("Continue"), NULL, pathName, buf);
+        return NULL;
+    }
+    return za;
+}
+
+/**************************************************************************
+ * Read one entry of an archive into memory, without going through a file
+ *
+ * \param IN za the archive
+ * \param IN entryName the name of the entry
+ * \param OUT size the size of the entry
+ *
+ * \returns the contents followed by a NUL, to be MyFree'd by the caller.
+ *	NULL if there is no such entry or it can't be read.
+ */
+char * ReadArchiveEntry(
+    struct zip * za,
+    const char * entryName,
+    size_t * size)
+{
+    struct zip_file *zf;
+    struct zip_stat sb;
+    char * buffer;
+    zip_int64_t len;
+    zip_uint64_t sum;
+
+    if (zip_stat(za, entryName, 0, &sb) != 0 ||
+        (sb.valid & ZIP_STAT_SIZE) == 0) {
+        LOG(log_zip, 1, ("Zip-Entry [%s] not found \n", entryName))
+        return NULL;
+    }
+    LOG(log_zip, 1, ("Zip-Entry [%s] Size [%llu] \n", entryName, sb.size))
+    zf = zip_fopen(za, entryName, 0);
+    if (!zf) {
+        NoticeMessage(MSG_ZIP_READ_FAIL, _("Continue"), NULL, entryName, zip_strerror(za));
+        return NULL;
+    }
+    buffer = MyMalloc((size_t)sb.size + 1);
+    for (sum = 0; sum < sb.size; sum += len) {
+        len = zip_fread(zf, buffer + sum, sb.size - sum);
+        if (len <= 0) {
+            NoticeMessage(MSG_ZIP_READ_FAIL, _("Continue"), NULL, entryName, zip_file_strerror(zf));
+            zip_fclose(zf);
+            MyFree(buffer);
+            return NULL;
+        }
+    }
+    zip_fclose(zf);
+    buffer[sb.size] = '\0';
+    *size = (size_t)sb.size;
+    return buffer;
+}
+
+/**************************************************************************
+ * Write one entry of an archive to a file
+ *
+ * \param IN pathName the name of the archive
+ * \param IN entryName the name of the entry
+ * \param IN fileName the file to write
+ *
+ * \returns TRUE if all worked
+ */
+BOOL_T ExtractArchiveEntry(
+    const char * pathName,
+    const char * entryName,
+    const char * fileName)
+{
+    struct zip *za;
+    char * buffer;
+    size_t size;
+    FILE * fd;
+    BOOL_T rc;
+
+    if ((za = OpenArchive(pathName)) == NULL) {
+        return FALSE;
+    }
+    buffer = ReadArchiveEntry(za, entryName, &size);
+    zip_discard(za);
+    if (buffer == NULL) {
+        return FALSE;
+    }
+    fd = fopen(fileName, "wb");
+    if (!fd) {
+        NoticeMessage(MSG_ZIP_FILE_OPEN_FAIL, _("Continue"), NULL, fileName,
+                      strerror(errno));
+        MyFree(buffer);
+        return FALSE;
+    }
+    rc = fwrite(buffer, 1, size, fd) == size;
+    rc &= fclose(fd) == 0;
+    MyFree(buffer);
+    return rc;
+}
@@ -12,4 +12,7 @@ char *GetZipDirectoryName(enum ArchiveOps op);
 BOOL_T AddDirectoryToArchive(struct zip * za, const char * dir_path, const char * prefix);
 BOOL_T CreateArchive(const char * dir_path, const char * fileName);
 BOOL_T UnpackArchiveFor(const char * pathName, const char * fileName, const char * tempDir, BOOL_T file_only);
+struct zip * OpenArchive(const char * pathName);
+char * ReadArchiveEntry(struct zip * za, const char * entryName, size_t * size);
+BOOL_T ExtractArchiveEntry(const char * pathName, const char * entryName, const char * fileName);
 #endif
@@ -54,6 +54,7 @@
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "messages.h"
 #include "param.h"
@@ -397,14 +398,14 @@ static BOOL_T WriteBlock ( track_p t, FILE * f )
 	blockName = Convert2UTF8(blockName);
 #endif // WINDOWS
 
-	rc &= fprintf(f, "BLOCK %d \"%s\" \"%s\"\n",
+	rc &= FilePrintf(f, "BLOCK %d \"%s\" \"%s\"\n",
 		GetTrkIndex(t), blockName, xx->script)>0;
 	for (iTrack = 0; iTrack < xx->numTracks && rc; iTrack++) {
                 if ((&(xx->trackList))[iTrack].t == NULL) continue;
-		rc &= fprintf(f, "\tTRK %d\n",
+		rc &= FilePrintf(f, "\tTRK %d\n",
 				GetTrkIndex((&(xx->trackList))[iTrack].t))>0;
 	}
-	rc &= fprintf( f, "\t%s\n", END_BLOCK )>0;
+	rc &= FilePrintf( f, "\t%s\n", END_BLOCK )>0;
 	MyFree(blockName);
 	return rc;
 }
@@ -495,6 +496,22 @@ EXPORT void ResolveBlockTrack ( track_p trk )
     }
 }
 
+/**
+ * Take the indices of the block's tracks from the tracks resolved by
+ * ResolveBlockTrack, after they were given new ones (see UndoJournalReplay).
+ */
+EXPORT void RenumberBlockTrack ( track_p trk )
+{
+    blockData_p xx;
+    wIndex_t iTrack;
+    if (GetTrkType(trk) != T_BLOCK) return;
+    xx = GetblockData(trk);
+    for (iTrack = 0; iTrack < xx->numTracks; iTrack++) {
+        if (tracklist(iTrack).t != NULL)
+            tracklist(iTrack).i = GetTrkIndex(tracklist(iTrack).t);
+    }
+}
+
 static void MoveBlock (track_p trk, coOrd orig ) {}
 static void RotateBlock (track_p trk, coOrd orig, ANGLE_T angle ) {}
 static void RescaleBlock (track_p trk, FLOAT_T ratio ) {}
@@ -986,8 +1003,7 @@ EXPORT void BlockMgmLoad( void )
     if ( blockI == NULL) 
         blockI = wIconCreatePixMap( block_xpm );
     
-    TRK_ITERATE(trk) {
-        if (GetTrkType(trk) != T_BLOCK) continue;
+    for (trk=NULL; TrackIterateType(T_BLOCK, &trk);) {
         ContMgmLoad( blockI, BlockMgmProc, (void *)trk );
     }
     
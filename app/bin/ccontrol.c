@@ -53,6 +53,7 @@ static const char rcsid[] = "@(#) : $Id$";
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "param.h"
@@ -314,7 +315,7 @@ static BOOL_T WriteControl ( track_p t, FILE * f )
 	controlName = Convert2UTF8(controlName);
 #endif // WINDOWS
 
-    rc &= fprintf(f, "CONTROL %d %u %s %d %0.6f %0.6f \"%s\" \"%s\" \"%s\"\n",
+    rc &= FilePrintf(f, "CONTROL %d %u %s %d %0.6f %0.6f \"%s\" \"%s\" \"%s\"\n",
                   GetTrkIndex(t), GetTrkLayer(t), GetTrkScaleName(t),
                   GetTrkVisible(t), xx->orig.x, xx->orig.y, controlName, 
                   xx->onscript, xx->offscript)>0;
@@ -627,8 +628,7 @@ EXPORT void ControlMgmLoad ( void )
         controlI = wIconCreatePixMap( control_xpm );
     }
     
-    TRK_ITERATE(trk) {
-        if (GetTrkType(trk) != T_CONTROL) continue;
+    for (trk=NULL; TrackIterateType(T_CONTROL, &trk);) {
         ContMgmLoad (controlI, ControlMgmProc, (void *) trk );
     }
 }
@@ -2734,7 +2734,6 @@ static STATUS_T CmdConvertTo(
 	case C_LCLICK:
 			if ((trk = OnTrack(&pos,FALSE,TRUE))!=NULL) {
 				SetTrkBits(trk,TB_SELECTED);
-				selectedTrackCount = 1;
 			} else {
 				wBeep();
 				InfoMessage( _("Not on a Track") );
@@ -2789,7 +2788,6 @@ static STATUS_T CmdConvertTo(
 					prior = Da.trk[0];
 					ep0 = 1-Da.ep[0];
 					ClrTrkBits( Da.trk[0], TB_SELECTED );          //Done with this one
-					if (selectedTrackCount>0) selectedTrackCount--;
 					DYNARR_APPEND(track_p,Da.tracks,1);
 					DYNARR_LAST(track_p,Da.tracks) = prior;
 					DYNARR_APPEND(coOrd,Da.mid_points,1);
@@ -2821,7 +2819,6 @@ static STATUS_T CmdConvertTo(
 				while (Da.trk[1] && GetTrkSelected( Da.trk[1]) && (QueryTrack(Da.trk[1], Q_CORNU_CAN_MODIFY) || QueryTrack(Da.trk[1], Q_IS_CORNU))) {
 					next = Da.trk[1];
 					ep1 = 1-Da.ep[1];
-					if (selectedTrackCount>0) selectedTrackCount--;
 					ClrTrkBits( Da.trk[1], TB_SELECTED );          //Done with this one
 					DYNARR_APPEND(track_p,Da.tracks,1);
 					DYNARR_LAST(track_p,Da.tracks) = next;
@@ -2947,7 +2944,6 @@ static STATUS_T CmdConvertFrom(
 		case C_LCLICK:
 			if ((trk = OnTrack(&pos,FALSE,TRUE))!=NULL) {
 				SetTrkBits(trk,TB_SELECTED);
-				selectedTrackCount = 1;
 				trk = NULL;
 			} else {
 				wBeep();
@@ -2980,7 +2976,6 @@ static STATUS_T CmdConvertFrom(
 				if ( GetTrkSelected( trk1 ) && IsTrack( trk1 ) ) {
 					//Only Cornu or Bezier
 					tracks[0] = NULL, tracks[1] = NULL;
-					if (selectedTrackCount>0) selectedTrackCount--;
 					ClrTrkBits( trk1, TB_SELECTED );          //Done with this one
 					if (GetTrkType(trk1) == T_CORNU) {
 						GetTracksFromCornuTrack(trk1,tracks);
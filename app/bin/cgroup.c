@@ -29,6 +29,7 @@
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "tbezier.h"
 #include "tcornu.h"
@@ -1573,7 +1574,7 @@ LOG( log_group, 3, ( "\n" ) );
 		if (f && to) {
 			long options = 0;
 			oldLocale = SaveLocale("C");
-			rc &= fprintf( f, "TURNOUT %s \"%s\" %ld\n", curScaleName, PutTitle(to->title), options )>0;
+			rc &= FilePrintf( f, "TURNOUT %s \"%s\" %ld\n", curScaleName, PutTitle(to->title), options )>0;
 			rc &= WriteCompoundPathsEndPtsSegs( f, path, outputSegs_da.cnt, &outputSegs(0), tempEndPts_da.cnt, &tempEndPts(0) );
 		}
 		if ( groupReplace ) {
@@ -1626,7 +1627,7 @@ LOG( log_group, 3, ( "\n" ) );
 		f = OpenCustom("a");
 		if (f && to) {
 			oldLocale = SaveLocale("C");
-			rc &= fprintf( f, "STRUCTURE %s \"%s\"\n", curScaleName, PutTitle(groupTitle) )>0;
+			rc &= FilePrintf( f, "STRUCTURE %s \"%s\"\n", curScaleName, PutTitle(groupTitle) )>0;
 			rc &= WriteSegs( f, tempSegs_da.cnt, &tempSegs(0) );
 		}
 		if ( groupReplace ) {
@@ -24,6 +24,7 @@
 #include "custom.h"
 #include "dynstring.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "misc.h"
 #include "param.h"
@@ -96,7 +97,7 @@ BOOL_T WriteMainNote(FILE* f)
 
 
 	char * sText = ConvertToEscapedText( noteText );
-        rc &= fprintf(f, "NOTE MAIN 0 0 0 0 0 \"%s\"\n", sText )>0;
+        rc &= FilePrintf(f, "NOTE MAIN 0 0 0 0 0 \"%s\"\n", sText )>0;
 	MyFree( sText );
 
 #ifdef WINDOWS
@@ -86,9 +86,16 @@ typedef struct {
 #define CHECK_SIZE(T,DA)
 #endif
 
+/*
+ * DYNARR_APPEND grows the array geometrically (at least by INCR) so that
+ * appending n elements costs O(n) copies.  DYNARR_TRIM returns the unused
+ * space of an array which has stopped growing.
+ */
+#define DYNARR_GROW(DA,INCR) \
+		(((DA).max < (INCR)) ? (DA).max + (INCR) : (DA).max * 2)
 #define DYNARR_APPEND(T,DA,INCR) \
 		{ if ((DA).cnt >= (DA).max) { \
-			(DA).max += INCR; \
+			(DA).max = DYNARR_GROW(DA,INCR); \
 			CHECK_SIZE(T,DA) \
 			(DA).ptr = MyRealloc( (DA).ptr, (DA).max * sizeof *(T*)NULL ); \
 			if ( (DA).ptr == NULL ) \
@@ -112,6 +119,11 @@ typedef struct {
 				abort(); \
 		} \
 		(DA).cnt = N; }
+#define DYNARR_TRIM(T,DA) \
+		{ if ((DA).ptr && (DA).max > (DA).cnt) { \
+			(DA).max = (DA).cnt; \
+			(DA).ptr = MyRealloc( (DA).ptr, (DA).max * sizeof *(T*)NULL ); \
+		} }
 #define DYNARR_FREE(T,DA) \
 		{ if ((DA).ptr) { \
 			MyFree( (DA).ptr); \
@@ -33,6 +33,7 @@
 #include "cundo.h"
 #include "dynstring.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "shrtpath.h"
 #include "track.h"
@@ -149,13 +150,13 @@ EXPORT BOOL_T WriteCompoundPathsEndPtsSegs(
 
 	BOOL_T rc = TRUE;
 	for ( pp=paths; *pp; pp+=2 ) {
-		rc &= fprintf( f, "\tP \"%s\"", pp )>0;
+		rc &= FilePrintf( f, "\tP \"%s\"", pp )>0;
 		for ( pp+=strlen((char *)pp)+1; pp[0]!=0 || pp[1]!=0; pp++ )
-			rc &= fprintf( f, " %d", pp[0] )>0;
-		rc &= fprintf( f, "\n" )>0;
+			rc &= FilePrintf( f, " %d", pp[0] )>0;
+		rc &= FilePrintf( f, "\n" )>0;
 	}
 	for ( i=0; i<endPtCnt; i++ )
-		rc &= fprintf( f, "\tE %0.6f %0.6f %0.6f\n",
+		rc &= FilePrintf( f, "\tE %0.6f %0.6f %0.6f\n",
 				endPts[i].pos.x, endPts[i].pos.y, endPts[i].angle )>0;
 	rc &= WriteSegs( f, segCnt, segs )>0;
 	return rc;
@@ -1075,7 +1076,7 @@ BOOL_T WriteCompound(
 		options |= COMPOUND_OPTION_HIDEDESC;
 	epCnt = GetTrkEndPtCnt(t);
 	lineType = xx->lineType;
-	rc &= fprintf(f, "%s %d %d %ld %ld %d %s %d %0.6f %0.6f 0 %0.6f \"%s\"\n",
+	rc &= FilePrintf(f, "%s %d %d %ld %ld %d %s %d %0.6f %0.6f 0 %0.6f \"%s\"\n",
 				GetTrkTypeName(t),
 				GetTrkIndex(t), GetTrkLayer(t), options,
 				GetCurrPathIndex(t), lineType,
@@ -1086,17 +1087,17 @@ BOOL_T WriteCompound(
 		WriteEndPt( f, t, ep );
 	switch ( xx->special ) {
 	case TOadjustable:
-		rc &= fprintf( f, "\tX %s %0.3f %0.3f\n", ADJUSTABLE,
+		rc &= FilePrintf( f, "\tX %s %0.3f %0.3f\n", ADJUSTABLE,
 				xx->u.adjustable.minD, xx->u.adjustable.maxD )>0;
 		break;
 	case TOpier:
-		rc &= fprintf( f, "\tX %s %0.6f \"%s\"\n", PIER, xx->u.pier.height, xx->u.pier.name )>0;
+		rc &= FilePrintf( f, "\tX %s %0.6f \"%s\"\n", PIER, xx->u.pier.height, xx->u.pier.name )>0;
 		break;
 
 	default:
 		;
 	}
-	rc &= fprintf( f, "\tD %0.6f %0.6f\n", xx->descriptionOff.x, xx->descriptionOff.y )>0;
+	rc &= FilePrintf( f, "\tD %0.6f %0.6f\n", xx->descriptionOff.x, xx->descriptionOff.y )>0;
 	rc &= WriteCompoundPathsEndPtsSegs( f, GetPaths( t ), xx->segCnt, xx->segs, 0, NULL );
 	return rc;
 }
@@ -642,6 +642,8 @@ static void CreateConnectAnchor(EPINX_T ep, track_p t, BOOL_T shift) {
 
 STATUS_T ConnectMultiple() {
 	int countTracksR0 =0,countTracksR1 =0, possibleEndPoints =0;
+	static dynArr_t nearEndPts_da;
+	int inx;
 	if (selectedTrackCount==0) {
 		ErrorMessage(_("Connect Multiple Tracks - Select multiple tracks to join first"));
 		return C_CONTINUE;
@@ -659,26 +661,27 @@ STATUS_T ConnectMultiple() {
 			if ( GetTrkSelected( trk1 ) ) {
 				for (ep1=0; ep1<GetTrkEndPtCnt(trk1); ep1++) {
 					if (!GetTrkEndTrk( trk1, ep1 )) {
-						trk2 = NULL;
-						while (!found && TrackIterate(&trk2) ) {
+						// Only unconnected end points close enough to pass below can match
+						GridFindEndPtsNear( GetTrkEndPos(trk1,ep1), (i==0)?connectDistance:3.0, &nearEndPts_da );
+						for (inx=0; inx<nearEndPts_da.cnt; inx++) {
+							trk2 = DYNARR_N( trkEndPtRef_t, nearEndPts_da, inx ).trk;
+							ep2 = DYNARR_N( trkEndPtRef_t, nearEndPts_da, inx ).ep;
 							if (trk1 == trk2) continue;
-							for (ep2=0; ep2<GetTrkEndPtCnt(trk2); ep2++) {
-								if (GetTrkEndTrk( trk2, ep2 )) continue;
-								d = FindDistance(GetTrkEndPos(trk1,ep1),GetTrkEndPos(trk2,ep2));
-								a = NormalizeAngle( 180+GetTrkEndAngle( trk1, ep1 ) - GetTrkEndAngle( trk2, ep2 )+(connectAngle/2.0));
-								// Take two passes. In round one favor closer connections. In round two try anything.
-								if ( (i==0 && (d < connectDistance) && (a < connectAngle)) ||
-										(i>0 && (d<3.0 && a<7.5))) {    // Match PullTracks criteria in round 2
-									PullTracks(trk1,ep1,trk2,ep2);
-									if (GetTrkEndTrk( trk2, ep2 )) {
-										found = TRUE;
-										if (i==0)
-											countTracksR0++;
-										else
-											countTracksR1++;
-										break;               //Stop looking
-									} else if (i==1) possibleEndPoints++;
-								}
+							if (GetTrkEndTrk( trk2, ep2 )) continue;
+							d = FindDistance(GetTrkEndPos(trk1,ep1),GetTrkEndPos(trk2,ep2));
+							a = NormalizeAngle( 180+GetTrkEndAngle( trk1, ep1 ) - GetTrkEndAngle( trk2, ep2 )+(connectAngle/2.0));
+							// Take two passes. In round one favor closer connections. In round two try anything.
+							if ( (i==0 && (d < connectDistance) && (a < connectAngle)) ||
+									(i>0 && (d<3.0 && a<7.5))) {    // Match PullTracks criteria in round 2
+								PullTracks(trk1,ep1,trk2,ep2);
+								if (GetTrkEndTrk( trk2, ep2 )) {
+									found = TRUE;
+									if (i==0)
+										countTracksR0++;
+									else
+										countTracksR1++;
+									break;               //Stop looking
+								} else if (i==1) possibleEndPoints++;
 							}
 						}
 						if (found) break;  //Next EndPoint
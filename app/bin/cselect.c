@@ -44,6 +44,7 @@
 #include "draw.h"
 #include "misc.h"
 #include "trackx.h"
+#include "uthash.h"
 
 
 #include "bitmaps/bmendpt.xbm"
@@ -74,18 +75,86 @@ static coOrd moveDescPos;
 int incrementalDrawLimit = 0;
 static int microCount = 0;
 
+/*
+ * tlist_da holds the tracks being moved (or visited by SelectConnectedTracks),
+ * each once.  tlist_hash maps each of them to its position so membership
+ * tests do not have to scan the list.  RemoveSelectedTrack leaves a NULL
+ * behind, which TlistCompact squeezes out.
+ */
 static dynArr_t tlist_da;
 
+typedef struct {
+		track_p trk;
+		wIndex_t inx;
+		UT_hash_handle hh;
+		} tlistEntry_t;
+static tlistEntry_t * tlist_hash = NULL;
+
 #define Tlist(N) DYNARR_N( track_p, tlist_da, N )
-#define TlistAppend( T ) \
-		{ DYNARR_APPEND( track_p, tlist_da, 10 );\
-		  Tlist(tlist_da.cnt-1) = T; }
+
+static void TlistAppend( track_p trk )
+{
+	tlistEntry_t * entry;
+	HASH_FIND_PTR( tlist_hash, &trk, entry );
+	if ( entry )
+		return;
+	DYNARR_APPEND( track_p, tlist_da, 10 );
+	Tlist(tlist_da.cnt-1) = trk;
+	entry = (tlistEntry_t*)PoolAlloc( sizeof *entry );
+	entry->trk = trk;
+	entry->inx = tlist_da.cnt-1;
+	HASH_ADD_PTR( tlist_hash, trk, entry );
+}
+
+static void TlistReset( void )
+{
+	tlistEntry_t * entry, * tmp;
+	HASH_ITER( hh, tlist_hash, entry, tmp ) {
+		HASH_DEL( tlist_hash, entry );
+		PoolFree( entry, sizeof *entry );
+	}
+	DYNARR_RESET( track_p, tlist_da );
+}
 
 BOOL_T TListSearch(track_p T) {
-	for (int i=0;i<tlist_da.cnt-1;i++) { \
-		if (Tlist(i) == T) return TRUE;
+	tlistEntry_t * entry;
+	HASH_FIND_PTR( tlist_hash, &T, entry );
+	return entry != NULL;
+}
+
+/*
+ * undoTrks_da collects the tracks which a command changes alike, so they are
+ * recorded for undo in one call.
+ */
+static dynArr_t undoTrks_da;
+#define UndoTrks(N) DYNARR_N( track_p, undoTrks_da, N )
+
+static void UndoTrksAppend( track_p trk )
+{
+	DYNARR_APPEND( track_p, undoTrks_da, 100 );
+	UndoTrks(undoTrks_da.cnt-1) = trk;
+}
+
+/*
+ * Record the selected tracks, and the tracks connected to them if
+ * neighbours, before a change which leaves their type specific data alone.
+ */
+static void UndoChangeSelectedTracks( BOOL_T neighbours )
+{
+	track_p trk, trk1;
+	trkSelIter_t selIter;
+	EPINX_T ep;
+	DYNARR_RESET( track_p, undoTrks_da );
+	for ( trk=NULL; SelectedTrackIterate( &selIter, &trk ); ) {
+		UndoTrksAppend( trk );
+		if ( !neighbours )
+			continue;
+		for ( ep=0; ep<GetTrkEndPtCnt(trk); ep++ ) {
+			if ( (trk1 = GetTrkEndTrk(trk,ep)) != NULL && !GetTrkSelected(trk1) )
+				UndoTrksAppend( trk1 );
+		}
 	}
-	return FALSE;
+	UndoChangeTracks( undoTrks_da.cnt, &UndoTrks(0) );
 }
 
 static wMenu_p selectPopup1M;
@@ -265,7 +334,7 @@ void CreateEndAnchor(coOrd p, wBool_t lock) {
  *
  */
 
-EXPORT long selectedTrackCount = 0;	/**< number of currently selected track components */
+EXPORT long selectedTrackCount = 0;	/**< number of currently selected track components, kept by track.c */
 
 static void SelectedTrackCountChange( void )
 {
@@ -388,6 +457,7 @@ static void RedrawSelectedTracksBoundary()
 EXPORT void SetAllTrackSelect( BOOL_T select )
 {
 	track_p trk;
+	trkSelIter_t selIter;
 	BOOL_T doRedraw = FALSE;
 
 	if (select || selectedTrackCount > incrementalDrawLimit) {
@@ -395,12 +465,9 @@ EXPORT void SetAllTrackSelect( BOOL_T select )
 	} else {
 		wDrawDelayUpdate( mainD.d, TRUE );
 	}
-	selectedTrackCount = 0;
 	trk = NULL;
-	while ( TrackIterate( &trk ) ) {
+	while ( select ? TrackIterate( &trk ) : SelectedTrackIterate( &selIter, &trk ) ) {
 		if ((!select) || GetLayerVisible( GetTrkLayer( trk ))) {
-			if (select)
-				selectedTrackCount++;
 			if ((GetTrkSelected(trk)!=0) != select) {
 				if (select)
 					SetTrkBits( trk, TB_SELECTED );
@@ -469,7 +536,6 @@ EXPORT void OrphanedTrackSelect( void *ptr )
 			if( !cnt && GetTrkEndPtCnt( trk )) {
 				SetTrkBits( trk, TB_SELECTED );
 				DrawTrackAndEndPts( trk, wDrawColorBlack );
-				selectedTrackCount++;			
 			}		
 		}
 	}
@@ -488,13 +554,10 @@ static void SelectOneTrack(
 			return;
 		}
 		SetTrkBits( trk, TB_SELREDRAW );
-		if (selected) {
+		if (selected)
 			SetTrkBits( trk, TB_SELECTED );
-			selectedTrackCount++;
-		} else {
+		else
 			ClrTrkBits( trk, TB_SELECTED );
-			selectedTrackCount--;
-		}
 		SelectedTrackCountChange();
 }
 
@@ -503,19 +566,18 @@ static void HighlightSelectedTracks(
 		track_p trk_ignore, BOOL_T keep, BOOL_T invert )
 {
 	track_p trk = NULL;
+	trkSelIter_t selIter;
 	if ( selectedTrackCount == 0 )
 		return;
-	while ( TrackIterate( &trk ) ) {
+	while ( SelectedTrackIterate( &selIter, &trk ) ) {
 		if (trk == trk_ignore) continue;
-	    if(GetTrkSelected(trk)) {
-	    	if (!GetLayerVisible( GetTrkLayer( trk ))) continue;
-	    	if (keep)
-	    		DrawTrack(trk,&tempD,selectedColor);
-	    	else if (invert)
-	    		DrawTrack(trk,&tempD,wDrawColorPreviewUnselected);
-	    	else
-	    		DrawTrack(trk,&tempD,wDrawColorPreviewSelected );
-	    }
+		if (!GetLayerVisible( GetTrkLayer( trk ))) continue;
+		if (keep)
+			DrawTrack(trk,&tempD,selectedColor);
+		else if (invert)
+			DrawTrack(trk,&tempD,wDrawColorPreviewUnselected);
+		else
+			DrawTrack(trk,&tempD,wDrawColorPreviewSelected );
 	}
 
 }
@@ -526,7 +588,7 @@ static void SelectConnectedTracks(
 	track_p trk1;
 	int inx;
 	EPINX_T ep;
-	tlist_da.cnt = 0;
+	TlistReset();
 	TlistAppend( trk );
 	InfoCount( 0 );
 	if (!display_only) wDrawDelayUpdate( mainD.d, FALSE );
@@ -576,11 +638,9 @@ static int DoModuleTracks( int moduleLayer, doModuleTrackCallBack_t doit, BOOL_T
 	track_p trk;
 	trk = NULL;
 	int cnt = 0;
-	while ( TrackIterate( &trk ) ) {
-		if (GetTrkLayer(trk) == moduleLayer) {
-			 doit( trk, val );
-			 cnt++;
-		}
+	while ( TrackIterateLayer( moduleLayer, &trk ) ) {
+		doit( trk, val );
+		cnt++;
 	}
 	return cnt;
 }
@@ -593,12 +653,11 @@ typedef BOOL_T (*doSelectedTrackCallBack_t)(track_p, BOOL_T);
 static void DoSelectedTracks( doSelectedTrackCallBack_t doit )
 {
 	track_p trk;
+	trkSelIter_t selIter;
 	trk = NULL;
-	while ( TrackIterate( &trk ) ) {
-		if (GetTrkSelected(trk)) {
-			if ( !doit( trk, TRUE ) ) {
-				break;
-			}
+	while ( SelectedTrackIterate( &selIter, &trk ) ) {
+		if ( !doit( trk, TRUE ) ) {
+			break;
 		}
 	}
 }
@@ -607,13 +666,12 @@ static void DoSelectedTracks( doSelectedTrackCallBack_t doit )
 static BOOL_T SelectedTracksAreFrozen( void )
 {
 	track_p trk;
+	trkSelIter_t selIter;
 	trk = NULL;
-	while ( TrackIterate( &trk ) ) {
-		if ( GetTrkSelected(trk) ) {
-			if ( GetLayerFrozen( GetTrkLayer( trk ) ) ) {
-				ErrorMessage( MSG_SEL_TRK_FROZEN );
-				return TRUE;
-			}
+	while ( SelectedTrackIterate( &selIter, &trk ) ) {
+		if ( GetLayerFrozen( GetTrkLayer( trk ) ) ) {
+			ErrorMessage( MSG_SEL_TRK_FROZEN );
+			return TRUE;
 		}
 	}
 	return FALSE;
@@ -623,6 +681,7 @@ static BOOL_T SelectedTracksAreFrozen( void )
 EXPORT void SelectTrackWidth( void* width )
 {
 	track_p trk;
+	trkSelIter_t selIter;
 	if (SelectedTracksAreFrozen())
 		return;
 	if (selectedTrackCount<=0) {
@@ -630,15 +689,13 @@ EXPORT void SelectTrackWidth( void* width )
 		return;
 	}
 	UndoStart( _("Change Track Width"), "trackwidth" );
+	UndoChangeSelectedTracks( FALSE );
 	trk = NULL;
 	wDrawDelayUpdate( mainD.d, TRUE );
-	while ( TrackIterate( &trk ) ) {
-		if (GetTrkSelected(trk)) {
-			DrawTrackAndEndPts( trk, wDrawColorWhite );
-			UndoModify( trk );
-			SetTrkWidth( trk, (int)(long)width );
-			DrawTrackAndEndPts( trk, wDrawColorBlack );
-		}
+	while ( SelectedTrackIterate( &selIter, &trk ) ) {
+		DrawTrackAndEndPts( trk, wDrawColorWhite );
+		SetTrkWidth( trk, (int)(long)width );
+		DrawTrackAndEndPts( trk, wDrawColorBlack );
 	}
 	wDrawDelayUpdate( mainD.d, FALSE );
 	UndoEnd();
@@ -647,6 +704,7 @@ EXPORT void SelectTrackWidth( void* width )
 EXPORT void SelectLineType( void* width )
 {
 	track_p trk;
+	trkSelIter_t selIter;
 	if (SelectedTracksAreFrozen())
 		return;
 	if (selectedTrackCount<=0) {
@@ -656,16 +714,14 @@ EXPORT void SelectLineType( void* width )
 	UndoStart( _("Change Line Type"), "linetype" );
 	trk = NULL;
 	wDrawDelayUpdate( mainD.d, TRUE );
-	while ( TrackIterate( &trk ) ) {
-		if (GetTrkSelected(trk)) {
-			UndoModify( trk );
-			if (QueryTrack(trk, Q_CAN_MODIFY_CONTROL_POINTS))
-				SetBezierLineType(trk, (int) (long) width);
-			else if (QueryTrack(trk, Q_IS_DRAW))
-				SetLineType( trk, (int)(long)width );
-			else if (QueryTrack(trk, Q_IS_STRUCTURE)) {
-				SetCompoundLineType(trk, (int)(long)width);
-			}
+	while ( SelectedTrackIterate( &selIter, &trk ) ) {
+		UndoModify( trk );
+		if (QueryTrack(trk, Q_CAN_MODIFY_CONTROL_POINTS))
+			SetBezierLineType(trk, (int) (long) width);
+		else if (QueryTrack(trk, Q_IS_DRAW))
+			SetLineType( trk, (int)(long)width );
+		else if (QueryTrack(trk, Q_IS_STRUCTURE)) {
+			SetCompoundLineType(trk, (int)(long)width);
 		}
 	}
 	wDrawDelayUpdate( mainD.d, FALSE );
@@ -689,7 +745,6 @@ EXPORT void SelectDelete( void )
 		DoRedraw(); // SelectDelete
 		wDrawDelayUpdate( mainD.d, FALSE );
 		wDrawDelayUpdate( mapD.d, FALSE );
-		selectedTrackCount = 0;
 		SelectedTrackCountChange();
 		UndoEnd();
 	} else {
@@ -710,7 +765,6 @@ static BOOL_T FlipHidden( track_p trk, BOOL_T junk )
 		if ((trk2=GetTrkEndTrk(trk,i)) != NULL) {
 			UndrawNewTrack( trk2 );
 		}*/
-	UndoModify( trk );
 	if ( drawTunnel == 0 )
 		flipHiddenDoSelectRecount = TRUE;
 	if (GetTrkVisible(trk)) {
@@ -732,7 +786,6 @@ static BOOL_T FlipHidden( track_p trk, BOOL_T junk )
 
 static BOOL_T FlipBridge( track_p trk, BOOL_T junk )
 {
-	UndoModify( trk );
 	if (GetTrkBridge(trk)) {
 		ClrTrkBits( trk, TB_BRIDGE );
 	} else {
@@ -744,7 +797,6 @@ static BOOL_T FlipBridge( track_p trk, BOOL_T junk )
 
 static BOOL_T FlipTies( track_p trk, BOOL_T junk )
 {
-	UndoModify( trk );
 	if (GetTrkNoTies(trk)) {
 		ClrTrkBits( trk, TB_NOTIES );
 	} else {
@@ -761,6 +813,7 @@ EXPORT void SelectTunnel( void )
 	if (selectedTrackCount>0) {
 		flipHiddenDoSelectRecount = FALSE;
 		UndoStart( _("Hide Tracks (Tunnel)"), "tunnel" );
+		UndoChangeSelectedTracks( FALSE );
 		wDrawDelayUpdate( mainD.d, TRUE );
 		DoSelectedTracks( FlipHidden );
 		wDrawDelayUpdate( mainD.d, FALSE );
@@ -779,6 +832,7 @@ EXPORT void SelectBridge( void )
 	if (selectedTrackCount>0) {
 		flipHiddenDoSelectRecount = FALSE;
 		UndoStart( _("Bridge Tracks "), "bridge" );
+		UndoChangeSelectedTracks( FALSE );
 		wDrawDelayUpdate( mainD.d, TRUE );
 		DoSelectedTracks( FlipBridge );
 		wDrawDelayUpdate( mainD.d, FALSE );
@@ -796,6 +850,7 @@ EXPORT void SelectTies( void )
 	if (selectedTrackCount>0) {
 		flipHiddenDoSelectRecount = FALSE;
 		UndoStart( _("Ties Tracks "), "noties" );
+		UndoChangeSelectedTracks( FALSE );
 		wDrawDelayUpdate( mainD.d, TRUE );
 		DoSelectedTracks( FlipTies );
 		wDrawDelayUpdate( mainD.d, FALSE );
@@ -806,23 +861,18 @@ EXPORT void SelectTies( void )
 	MainRedraw(); // SelectTies
 }
 
+/**
+ * Update the commands after the selection was changed behind our back.
+ * selectedTrackCount itself is kept current by SetTrkBits and ClrTrkBits.
+ */
 void SelectRecount( void )
 {
-	track_p trk;
-	selectedTrackCount = 0;
-	trk = NULL;
-	while ( TrackIterate( &trk ) ) {
-		if (GetTrkSelected(trk)) {
-			selectedTrackCount++;
-		}
-	}
 	SelectedTrackCountChange();
 }
 
 
 static BOOL_T SetLayer( track_p trk, BOOL_T junk )
 {
-	UndoModify( trk );
 	SetTrkLayer( trk, curLayer );
 	return TRUE;
 }
@@ -833,6 +883,7 @@ EXPORT void MoveSelectedTracksToCurrentLayer( void )
 		return;
 		if (selectedTrackCount>0) {
 			UndoStart( _("Move To Current Layer"), "changeLayer" );
+			UndoChangeSelectedTracks( FALSE );
 			DoSelectedTracks( SetLayer );
 			UndoEnd();
 		} else {
@@ -873,6 +924,7 @@ EXPORT void ClearElevations( void )
 		return;
 	if (selectedTrackCount>0) {
 		UndoStart( _("Clear Elevations"), "clear elevations" );
+		UndoChangeSelectedTracks( TRUE );
 		DoSelectedTracks( ClearElevation );
 		UpdateAllElevations();
 		UndoEnd();
@@ -917,6 +969,7 @@ EXPORT void AddElevations( DIST_T delta )
 	if (selectedTrackCount>0) {
 		elevDelta = delta;
 		UndoStart( _("Add Elevations"), "add elevations" );
+		UndoChangeSelectedTracks( TRUE );
 		DoSelectedTracks( AddElevation );
 		UndoEnd();
 	} else {
@@ -1015,12 +1068,22 @@ static BOOL_T GetboundsDoIt( track_p trk, BOOL_T junk )
 }
 
 static coOrd rescaleShift;
+/*
+ * Only a rescale which changes the track dimensions touches the type specific
+ * data; otherwise the tracks are recorded for undo in one go.
+ */
+static BOOL_T RescaleChangesDim( void )
+{
+	return rescalePercent != 100.0 && rescaleNoChangeDim == 0;
+}
+
 static BOOL_T RescaleDoIt( track_p trk, BOOL_T junk )
 {
 	EPINX_T ep, ep1;
 	track_p trk1;
 	UndrawNewTrack( trk );
-	UndoModify(trk);
+	if ( RescaleChangesDim() )
+		UndoModify(trk);
 	if ( rescalePercent != 100.0 ) {
 		for (ep=0; ep<GetTrkEndPtCnt(trk); ep++) {
 			if ((trk1 = GetTrkEndTrk(trk,ep)) != NULL &&
@@ -1089,6 +1152,8 @@ static void RescaleDlgOk(
 	rescaleShift.y = (getboundsLo.y+getboundsHi.y)/2.0 - center.y*ratio;
 	
 	rescaleToInx = GetScaleInx( rescaleToScaleInx, rescaleToGaugeInx );
+	if ( !RescaleChangesDim() )
+		UndoChangeSelectedTracks( FALSE );
 	DoSelectedTracks( RescaleDoIt );
 
 	// rescale the background if it exists and the layout is resized
@@ -1240,23 +1305,41 @@ static void DrawSelectedTracksD( drawCmd_p d, wDrawColor color )
 static BOOL_T AddSelectedTrack(
 		track_p trk, BOOL_T junk )
 {
-	DYNARR_APPEND( track_p, tlist_da, 10 );
-	DYNARR_LAST( track_p, tlist_da ) = trk;
+	TlistAppend( trk );
 	return TRUE;
 }
 
+/* Call TlistCompact before tlist_da is used again */
 static BOOL_T RemoveSelectedTrack(track_p trk) {
+	tlistEntry_t * entry;
 
-	for(int i=0;i<tlist_da.cnt; i++) {
-		if (DYNARR_N(track_p,tlist_da,i) == trk) {
-			for (int j=i;j<tlist_da.cnt-1;j++) {
-				DYNARR_N(track_p,tlist_da,j) = DYNARR_N(track_p,tlist_da,j+1);
-			}
-			tlist_da.cnt--;
-			return TRUE;
+	HASH_FIND_PTR( tlist_hash, &trk, entry );
+	if ( entry == NULL )
+		return FALSE;
+	Tlist(entry->inx) = NULL;
+	HASH_DEL( tlist_hash, entry );
+	PoolFree( entry, sizeof *entry );
+	return TRUE;
+}
+
+/* Close the gaps RemoveSelectedTrack left, keeping the order */
+static void TlistCompact( void ) {
+	tlistEntry_t * entry;
+	track_p trk;
+	int inx, cnt = 0;
+
+	for ( inx=0; inx<tlist_da.cnt; inx++ ) {
+		trk = Tlist(inx);
+		if ( trk == NULL )
+			continue;
+		if ( cnt != inx ) {
+			Tlist(cnt) = trk;
+			HASH_FIND_PTR( tlist_hash, &trk, entry );
+			entry->inx = cnt;
 		}
+		cnt++;
 	}
-	return FALSE;
+	tlist_da.cnt = cnt;
 }
 
 static coOrd moveOrig;
@@ -1311,8 +1394,7 @@ static void AddEndCornus() {
 			tc = GetTrkEndTrk(trk,j);
 			if (tc && !GetTrkSelected(tc) && QueryTrack(tc,Q_IS_CORNU) && !QueryTrack(trk,Q_IS_CORNU)) {  //On end and cornu
 				SelectOneTrack( tc, TRUE );
-				DYNARR_APPEND(track_p,tlist_da,1);	//Add to selected list
-				DYNARR_LAST(track_p,tlist_da) = tc;
+				TlistAppend( tc );	//Add to selected list
 				DYNARR_APPEND(track_p,auto_select_da,1);
 				DYNARR_LAST(track_p,auto_select_da) = tc;
 			}
@@ -1327,6 +1409,7 @@ static void RemoveEndCornus() {
 		SelectOneTrack( tc, FALSE );
 		RemoveSelectedTrack(tc);
 	}
+	TlistCompact();
 	DYNARR_RESET(track_p,auto_select_da);
 }
 
@@ -1334,7 +1417,7 @@ static void RemoveEndCornus() {
 static void GetMovedTracks( BOOL_T undraw )
 {
 	wSetCursor( mainD.d, wCursorWait );
-	DYNARR_RESET( track_p, tlist_da );
+	TlistReset();
 	DoSelectedTracks( AddSelectedTrack );
 	AddEndCornus();							//Include Cornus that are attached at ends of selected
 	DYNARR_RESET( trkSeg_p, tempSegs_da );
@@ -1446,6 +1529,24 @@ static void DrawMovedTracks( void )
 
 
 
+/*
+ * A Cornu connected to an unselected track keeps that end where it is and
+ * is reshaped rather than moved.
+ */
+static BOOL_T HasFixedEnd( track_p trk )
+{
+	track_p te;
+	int i;
+	if (!QueryTrack(trk, Q_IS_CORNU))
+		return FALSE;
+	for (i=0;i<2;i++) {
+		if ((te = GetTrkEndTrk(trk,i)) && !GetTrkSelected(te))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
 static void MoveTracks(
 		BOOL_T eraseFirst,
 		BOOL_T move,
@@ -1471,21 +1572,15 @@ static void MoveTracks(
 			DrawSelectedTracksD( &mapD, wDrawColorWhite );
 		}
 	}
+	DYNARR_RESET( track_p, undoTrks_da );
+	for ( inx=0; inx<tlist_da.cnt; inx++ ) {
+		if ( !HasFixedEnd( Tlist(inx) ) )
+			UndoTrksAppend( Tlist(inx) );
+	}
+	UndoMoveTracks( undoTrks_da.cnt, &UndoTrks(0) );
 	for ( inx=0; inx<tlist_da.cnt; inx++ ) {
 		trk = Tlist(inx);
-		UndoModify( trk );
-		BOOL_T fixed_end;
-		fixed_end = FALSE;
-		if (QueryTrack(trk, Q_IS_CORNU)) {
-			for (int i=0;i<2;i++) {
-				track_p te;
-				if ((te = GetTrkEndTrk(trk,i)) && !GetTrkSelected(te)) {
-					fixed_end = TRUE;
-				}
-			}
-		}
-
-	    if (!fixed_end) {
+	    if (!HasFixedEnd(trk)) {
 			if (move)
 				MoveTrack( trk, base );
 			if (rotate)
@@ -1499,6 +1594,7 @@ static void MoveTracks(
 				}
 			}
 	    } else {
+			UndoModify( trk );
 			if (QueryTrack(trk, Q_IS_CORNU)) {			//Cornu will be at the end of selected set
 				for (int i=0;i<2;i++) {
 					if ((trk1 = GetTrkEndTrk(trk,i)) && GetTrkSelected(trk1)) {
@@ -1668,11 +1764,11 @@ wBool_t FindEndIntersection(coOrd base, coOrd orig, ANGLE_T angle, track_p * t1,
 
 void DrawHighlightLayer(int layer) {
 	track_p ts = NULL;
+	trkSelIter_t selIter;
 	BOOL_T initial = TRUE;
 	coOrd layer_hi = zero,layer_lo = zero;
-	while ( TrackIterate( &ts ) ) {
+	while ( SelectedTrackIterate( &selIter, &ts ) ) {
 		if ( !GetLayerVisible( GetTrkLayer( ts))) continue;
-		if (!GetTrkSelected(ts)) continue;
 		if (GetTrkLayer(ts) != layer) continue;
 		coOrd hi,lo;
 		GetBoundingBox(ts, &hi, &lo);
@@ -1837,7 +1933,7 @@ static STATUS_T CmdMove(
 			ep1 = -1;
 			ep2 = -1;
 			RemoveEndCornus();
-			tlist_da.cnt = 0;
+			TlistReset();
 			return C_TERMINATE;
 
 		case C_CMDMENU:
@@ -1932,7 +2028,7 @@ static STATUS_T CmdMove(
 				UndoEnd();
 			}
 			RemoveEndCornus();
-			tlist_da.cnt = 0;
+			TlistReset();
 			break;
 		case C_CONFIRM:
 		case C_CANCEL:
@@ -1941,7 +2037,7 @@ static STATUS_T CmdMove(
 				UndoUndo();
 			}
 			RemoveEndCornus();
-			tlist_da.cnt = 0;
+			TlistReset();
 			break;
 		default:
 			break;
@@ -2193,7 +2289,7 @@ static STATUS_T CmdRotate(
 			}
 			UndoEnd();
 			RemoveEndCornus();
-			tlist_da.cnt = 0;
+			TlistReset();
 			return C_TERMINATE;
 
 		case C_CMDMENU:
@@ -2634,6 +2730,7 @@ static void FlipTracks(
 		ANGLE_T angle )
 {
 	track_p trk, trk1;
+	trkSelIter_t selIter;
 	EPINX_T ep, ep1;
 
 	wSetCursor( mainD.d, wCursorWait );
@@ -2642,10 +2739,11 @@ static void FlipTracks(
 		wDrawDelayUpdate( mainD.d, TRUE );
 		wDrawDelayUpdate( mapD.d, TRUE );
 	}
-	for ( trk=NULL; TrackIterate(&trk); ) {
-		if ( !GetTrkSelected(trk) )
-			continue;
-		UndoModify( trk );
+	DYNARR_RESET( track_p, undoTrks_da );
+	for ( trk=NULL; SelectedTrackIterate( &selIter, &trk ); )
+		UndoTrksAppend( trk );
+	UndoMoveTracks( undoTrks_da.cnt, &UndoTrks(0) );
+	for ( trk=NULL; SelectedTrackIterate( &selIter, &trk ); ) {
 		if (selectedTrackCount <= incrementalDrawLimit) {
 			 DrawTrack( trk, &mainD, wDrawColorWhite );
 			 DrawTrack( trk, &mapD, wDrawColorWhite );
@@ -2737,7 +2835,8 @@ static BOOL_T SelectArea(
 	static coOrd base, size, lo, hi;
 	static BOOL_T add;
 	static BOOL_T subtract;
-	int cnt;
+	static dynArr_t areaTrks_da;
+	int cnt, inx;
 
 	track_p trk;
 
@@ -2781,22 +2880,23 @@ static BOOL_T SelectArea(
 			add = (action == C_UP);
 			subtract = (action == C_RUP);
 			cnt = 0;
-			trk = NULL;
 			if (add && (selectMode == 0)) SetAllTrackSelect( FALSE );		//Remove all tracks first
-			while ( TrackIterate( &trk ) ) {
+			hi.x = base.x+size.x;
+			hi.y = base.y+size.y;
+			GridFindTracks( base, hi, GetLayerVisible, &areaTrks_da );
+			for ( inx=0; inx<areaTrks_da.cnt; inx++ ) {
+				trk = DYNARR_N( track_p, areaTrks_da, inx );
 				GetBoundingBox( trk, &hi, &lo );
-				if (GetLayerVisible( GetTrkLayer( trk ) ) &&
-					lo.x >= base.x && hi.x <= base.x+size.x &&
+				if (lo.x >= base.x && hi.x <= base.x+size.x &&
 					lo.y >= base.y && hi.y <= base.y+size.y) {
 					if ( (GetTrkSelected( trk )==0) == (action==C_UP) )
 					  cnt++;
 				}
 			}
-			trk = NULL;
-			while ( TrackIterate( &trk ) ) {
+			for ( inx=0; inx<areaTrks_da.cnt; inx++ ) {
+				trk = DYNARR_N( track_p, areaTrks_da, inx );
 				GetBoundingBox( trk, &hi, &lo );
-				if (GetLayerVisible( GetTrkLayer( trk ) ) &&
-					lo.x >= base.x && hi.x <= base.x+size.x &&
+				if (lo.x >= base.x && hi.x <= base.x+size.x &&
 					lo.y >= base.y && hi.y <= base.y+size.y) {
 					if ( (GetTrkSelected( trk )==0) == (action==C_UP) ) {
 						if (GetLayerModule(GetTrkLayer(trk))) {
@@ -2805,7 +2905,6 @@ static BOOL_T SelectArea(
 							else
 								DoModuleTracks(GetTrkLayer(trk),SelectOneTrack,FALSE);
 						} else if (cnt > incrementalDrawLimit) {
-							selectedTrackCount += (action==C_UP?1:-1);
 							if (add)
 								SetTrkBits( trk, TB_SELECTED );
 							else
@@ -2941,9 +3040,9 @@ static STATUS_T Activate( coOrd pos) {
 
 track_p IsInsideABox(coOrd pos) {
 	track_p ts = NULL;
-	while ( TrackIterate( &ts ) ) {
+	trkSelIter_t selIter;
+	while ( SelectedTrackIterate( &selIter, &ts ) ) {
 		if (!GetLayerVisible( GetTrkLayer( ts))) continue;
-		if (!GetTrkSelected(ts)) continue;
 		coOrd hi,lo;
 		GetBoundingBox(ts, &hi, &lo);
 		double boundary = mainD.scale*5/mainD.dpi;
@@ -2956,11 +3055,11 @@ track_p IsInsideABox(coOrd pos) {
 
 void DrawHighlightBoxes(BOOL_T highlight_selected, BOOL_T select, track_p not_this) {
 	track_p ts = NULL;
+	trkSelIter_t selIter;
 	coOrd origin,max;
 	BOOL_T first = TRUE;
-	while ( TrackIterate( &ts ) ) {
+	while ( SelectedTrackIterate( &selIter, &ts ) ) {
 		if ( !GetLayerVisible( GetTrkLayer( ts))) continue;
-		if (!GetTrkSelected(ts)) continue;
 		if (GetLayerModule(GetTrkLayer(ts))) {
 			DrawHighlightLayer(GetTrkLayer(ts));
 		}
@@ -3158,7 +3257,7 @@ static STATUS_T CmdSelect(
 		case MOVE:
 			if (SelectedTracksAreFrozen() || (selectedTrackCount==0)) {
 				rc = C_TERMINATE;
-				tlist_da.cnt = 0;
+				TlistReset();
 				doingMove = FALSE;
 				doingRotate = FALSE;
 			} else if (doingRotate == TRUE) {
@@ -53,6 +53,7 @@ static const char rcsid[] = "@(#) : $Id$";
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "param.h"
@@ -279,7 +280,7 @@ static BOOL_T WriteSensor ( track_p t, FILE * f )
 	sensorName = Convert2UTF8(sensorName);
 #endif // WINDOWS
 
-    rc &= fprintf(f, "SENSOR %d %u %s %d %0.6f %0.6f \"%s\" \"%s\"\n",
+    rc &= FilePrintf(f, "SENSOR %d %u %s %d %0.6f %0.6f \"%s\" \"%s\"\n",
                   GetTrkIndex(t), GetTrkLayer(t), GetTrkScaleName(t),
                   GetTrkVisible(t), xx->orig.x, xx->orig.y, sensorName, 
                   xx->script)>0;
@@ -583,8 +584,7 @@ EXPORT void SensorMgmLoad ( void )
         sensorI = wIconCreatePixMap( sensor_xpm );
     }
     
-    TRK_ITERATE(trk) {
-        if (GetTrkType(trk) != T_SENSOR) continue;
+    for (trk=NULL; TrackIterateType(T_SENSOR, &trk);) {
         ContMgmLoad (sensorI, SensorMgmProc, (void *) trk );
     }
 }
@@ -54,6 +54,7 @@ static const char rcsid[] = "@(#) : $Id$";
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "param.h"
@@ -347,16 +348,16 @@ static BOOL_T WriteSignal ( track_p t, FILE * f )
 	signalName = Convert2UTF8(signalName);
 #endif // WINDOWS
 
-    rc &= fprintf(f, "SIGNAL %d %u %s %d %0.6f %0.6f %0.6f %d \"%s\"\n",
+    rc &= FilePrintf(f, "SIGNAL %d %u %s %d %0.6f %0.6f %0.6f %d \"%s\"\n",
                   GetTrkIndex(t), GetTrkLayer(t), GetTrkScaleName(t), 
                   GetTrkVisible(t), xx->orig.x, xx->orig.y, xx->angle, 
                   xx->numHeads, signalName)>0;
     for (ia = 0; ia < xx->numAspects; ia++) {
-        rc &= fprintf(f, "\tASPECT \"%s\" \"%s\"\n",
+        rc &= FilePrintf(f, "\tASPECT \"%s\" \"%s\"\n",
                       (&(xx->aspectList))[ia].aspectName,
                       (&(xx->aspectList))[ia].aspectScript)>0;
     }
-    rc &= fprintf( f, "\t%s\n",END_SIGNAL )>0;
+    rc &= FilePrintf( f, "\t%s\n",END_SIGNAL )>0;
 
 	MyFree(signalName);
     return rc;
@@ -567,7 +568,7 @@ static void SignalEditOk ( void * junk )
                 (&(xx->aspectList))[ia].aspectScript = NULL;
             }
             newsize = sizeof(signalData_t)+(sizeof(signalAspect_t)*(signalAspect_da.cnt-1))+1;
-            trk->extraData = MyRealloc(trk->extraData,newsize);
+            trk->extraData = PoolRealloc(trk->extraData,trk->extraSize,newsize);
             trk->extraSize = newsize;
             xx = GetsignalData(trk);
         }
@@ -901,8 +902,7 @@ EXPORT void SignalMgmLoad ( void )
         signalI = wIconCreatePixMap( signal_xpm );
     }
     
-    TRK_ITERATE(trk) {
-        if (GetTrkType(trk) != T_SIGNAL) continue;
+    for (trk=NULL; TrackIterateType(T_SIGNAL, &trk);) {
         ContMgmLoad (signalI, SignalMgmProc, (void *) trk );
     }
 }
@@ -56,6 +56,7 @@
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "param.h"
 #include "track.h"
@@ -417,7 +418,7 @@ static BOOL_T WriteSwitchMotor ( track_p t, FILE * f )
 
     if (xx->turnout == NULL) 
 		return FALSE;
-	rc &= fprintf(f, "SWITCHMOTOR %d %d \"%s\" \"%s\" \"%s\" \"%s\"\n",
+	rc &= FilePrintf(f, "SWITCHMOTOR %d %d \"%s\" \"%s\" \"%s\" \"%s\"\n",
 		GetTrkIndex(t), GetTrkIndex(xx->turnout), switchMotorName,
 		xx->normal, xx->reverse, xx->pointsense)>0;
 
@@ -479,6 +480,20 @@ EXPORT void ResolveSwitchmotorTurnout ( track_p trk )
     LOG( log_switchmotor, 1,("*** ResolveSwitchmotorTurnout(): t_trk = (%d) %p\n",xx->turnindx,t_trk))
 }
 
+/**
+ * Take the index of the turnout from the one resolved by
+ * ResolveSwitchmotorTurnout, after it was given a new one (see
+ * UndoJournalReplay).
+ */
+EXPORT void RenumberSwitchmotorTurnout ( track_p trk )
+{
+    switchmotorData_p xx;
+    if (GetTrkType(trk) != T_SWITCHMOTOR) return;
+    xx = GetswitchmotorData(trk);
+    if (xx->turnout != NULL)
+        xx->turnindx = GetTrkIndex(xx->turnout);
+}
+
 static void MoveSwitchMotor (track_p trk, coOrd orig ) {}
 static void RotateSwitchMotor (track_p trk, coOrd orig, ANGLE_T angle ) {}
 static void RescaleSwitchMotor (track_p trk, FLOAT_T ratio ) {}
@@ -842,8 +857,7 @@ EXPORT void SwitchmotorMgmLoad( void )
     if ( switchmI == NULL)
         switchmI = wIconCreatePixMap( switchm_xpm );
     
-    TRK_ITERATE(trk) {
-        if (GetTrkType(trk) != T_SWITCHMOTOR) continue;
+    for (trk=NULL; TrackIterateType(T_SWITCHMOTOR, &trk);) {
         ContMgmLoad( switchmI, SwitchmotorMgmProc, (void *)trk );
     }
 }
@@ -318,7 +318,7 @@ BOOL_T TraverseTrack2(
 EXPORT void CheckCarTraverse(track_p track) {
 
     track_p car;
-	for (car=NULL; TrackIterate(&car);) {
+	for (car=NULL; TrackIterateType(T_CAR, &car);) {
         if (GetTrkType(car) == T_CAR) {
         	struct extraData * xx = GetTrkExtraData(car);
 			if (xx->trvTrk.trk == track) {
@@ -1051,11 +1051,7 @@ static void LocoListInit(void)
     struct extraData * xx;
     locoList_da.cnt = 0;
 
-    for (train=NULL; TrackIterate(&train);) {
-        if (GetTrkType(train) != T_CAR) {
-            continue;
-        }
-
+    for (train=NULL; TrackIterateType(T_CAR, &train);) {
         xx = GetTrkExtraData(train);
 
         if (!CarItemIsLoco(xx->item)) {
@@ -1331,7 +1327,7 @@ static void DrawAllCars(void)
     wDrawRestoreImage(mainD.d);
     DrawPositionIndicators();
 
-    for (car=NULL; TrackIterate(&car);) {
+    for (car=NULL; TrackIterateType(T_CAR, &car);) {
         if (GetTrkType(car) == T_CAR) {
             xx = GetTrkExtraData(car);
             CarItemSize(xx->item,
@@ -1418,7 +1414,7 @@ static track_p FindCar(
     struct extraData * xx;
     trk1 = NULL;
 
-    for (trk=NULL; TrackIterate(&trk);) {
+    for (trk=NULL; TrackIterateType(T_CAR, &trk);) {
         if (GetTrkType(trk) == T_CAR) {
             xx = GetTrkExtraData(trk);
 
@@ -2104,11 +2100,7 @@ static BOOL_T MoveTrains(long timeD)
     track_p train;
     struct extraData * xx;
 
-    for (train=NULL; TrackIterate(&train);) {
-        if (GetTrkType(train) != T_CAR) {
-            continue;
-        }
-
+    for (train=NULL; TrackIterateType(T_CAR, &train);) {
         xx = GetTrkExtraData(train);
 
         if (!CarItemIsLoco(xx->item)) {
@@ -2305,22 +2297,14 @@ void AttachTrains(void)
     EPINX_T ep0, ep1;
     int dir;
 
-    for (car=NULL; TrackIterate(&car);) {
-        ClrTrkBits(car, TB_CARATTACHED);
-
-        if (GetTrkType(car) != T_CAR) {
-            continue;
-        }
+    ClrAllTrkBits(TB_CARATTACHED);
 
+    for (car=NULL; TrackIterateType(T_CAR, &car);) {
         xx = GetTrkExtraData(car);
         ClrProcessed(xx);
     }
 
-    for (car=NULL; TrackIterate(&car);) {
-        if (GetTrkType(car) != T_CAR) {
-            continue;
-        }
-
+    for (car=NULL; TrackIterateType(T_CAR, &car);) {
         xx = GetTrkExtraData(car);
 
         if (IsProcessed(xx)) {
@@ -2385,11 +2369,7 @@ void AttachTrains(void)
         WALK_CARS_END(loco, xx, dir)
     }
 
-    for (car=NULL; TrackIterate(&car);) {
-        if (GetTrkType(car) != T_CAR) {
-            continue;
-        }
-
+    for (car=NULL; TrackIterateType(T_CAR, &car);) {
         xx = GetTrkExtraData(car);
         ClrProcessed(xx);
     }
@@ -2401,11 +2381,9 @@ static void UpdateTrainAttachment(void)
     track_p trk;
     struct extraData * xx;
 
-    for (trk=NULL; TrackIterate(&trk);) {
-        ClrTrkBits(trk, TB_CARATTACHED);
-    }
+    ClrAllTrkBits(TB_CARATTACHED);
 
-    for (trk=NULL; TrackIterate(&trk);) {
+    for (trk=NULL; TrackIterateType(T_CAR, &trk);) {
         if (GetTrkType(trk) == T_CAR) {
             xx = GetTrkExtraData(trk);
 
@@ -2425,11 +2403,7 @@ static BOOL_T TrainOnMovableTrack(
     struct extraData * xx;
     int dir;
 
-    for (train=NULL; TrackIterate(&train);) {
-        if (GetTrkType(train) != T_CAR) {
-            continue;
-        }
-
+    for (train=NULL; TrackIterateType(T_CAR, &train);) {
         xx = GetTrkExtraData(train);
 
         if (IsOnTrack(xx)) {
@@ -2994,6 +2968,7 @@ static void TrainFunc(
         }
 
         trainFuncCar->deleted = TRUE;
+        HotUpdateTrack( trainFuncCar );
         /*DeleteTrack( trainFuncCar, FALSE );*/
         CarItemUpdate(xx->item);
         HotBarCancel();
@@ -3012,6 +2987,7 @@ static void TrainFunc(
         if (temp0) {
             xx1 = GetTrkExtraData(temp0);
             temp0->deleted = TRUE;
+            HotUpdateTrack( temp0 );
             /*DeleteTrack( temp0, FALSE );*/
             CarItemUpdate(xx1->item);
         }
@@ -3022,6 +2998,7 @@ static void TrainFunc(
         if (temp0) {
             xx1 = GetTrkExtraData(temp0);
             temp0->deleted = TRUE;
+            HotUpdateTrack( temp0 );
             /*DeleteTrack( temp0, FALSE );*/
             CarItemUpdate(xx1->item);
         }
@@ -26,6 +26,7 @@
 #include "cstraigh.h"
 #include "cundo.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "messages.h"
 #include "param.h"
@@ -310,12 +311,12 @@ static BOOL_T WriteTurntable( track_p t, FILE * f )
 	struct extraData *xx = GetTrkExtraData(t);
 	EPINX_T ep;
 	BOOL_T rc = TRUE;
-	rc &= fprintf(f, "TURNTABLE %d %d 0 0 0 %s %d %0.6f %0.6f 0 %0.6f %d\n",
+	rc &= FilePrintf(f, "TURNTABLE %d %d 0 0 0 %s %d %0.6f %0.6f 0 %0.6f %d\n",
 		GetTrkIndex(t), GetTrkLayer(t), GetTrkScaleName(t), GetTrkVisible(t),
 				xx->pos.x, xx->pos.y, xx->radius, xx->currEp )>0;
 	for (ep=0; ep<GetTrkEndPtCnt(t); ep++)
 		rc &= WriteEndPt( f, t, ep );
-	rc &= fprintf(f, "\t%s\n", END_SEGS)>0;
+	rc &= FilePrintf(f, "\t%s\n", END_SEGS)>0;
 	return rc;
 }
 
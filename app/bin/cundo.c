@@ -25,15 +25,25 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/stat.h>
+#ifdef WINDOWS
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "cselect.h"
 #include "custom.h"
 #include "fileio.h"
 #include "i18n.h"
+#include "lzblock.h"
 #include "messages.h"
 #include "paths.h"
 #include "track.h"
 #include "trackx.h"
+#include "utility.h"
+#include "workers.h"
 #include "cundo.h"
 
 
@@ -45,8 +55,6 @@
 
 static int log_undo = 0;	/**< loglevel, can only be set at compile time */
 
-#define UNDO_STACK_SIZE (10)
-
 typedef struct {
 		wIndex_t modCnt;
 		wIndex_t newCnt;
@@ -61,34 +69,54 @@ typedef struct {
 		track_p * oldTail;
 		track_p * newTail;
 		char * label;
+		int logStart;			/**< first entry in the undo log, or -1 */
+		int logEnd;			/**< entry after the last one */
+		wIndex_t logNewCnt;		/**< newCnt when the group was logged */
 		} undoStack_t, *undoStack_p;
 
-static undoStack_t undoStack[UNDO_STACK_SIZE];
+/*
+ * The undo stack grows without limit, oldest entry first.  It is trimmed from
+ * the bottom by UndoStart when the streams use more than undoMemory.
+ */
+static dynArr_t undoStack_da;
+#define undoStack(N) DYNARR_N( undoStack_t, undoStack_da, N )
 static wIndex_t undoHead = -1;
 static BOOL_T undoActive = FALSE;
 static int doCount = 0;
 static int undoCount = 0;
 
+/*
+ * An object in the undo stream is a full copy of a track (ModifyOp), or the
+ * values a move, rotate or flip changes (XformOp): its track_t, end points and
+ * type specific data, without the data StoreTrackData keeps.  Their Delete
+ * variants mark tracks which the command deleted.  An XformOp becomes a
+ * StaleOp when a full copy replaces it, see PromoteXform.
+ */
 static char ModifyOp = 1;
 static char DeleteOp = 2;
+static char XformOp = 3;
+static char XformDeleteOp = 4;
+static char StaleOp = 5;
+#define IsXformOp( OP ) ( (OP) >= XformOp )
 
 static BOOL_T recordUndo = 1;
 
 #define UASSERT( ARG, VAL ) \
 		if (!(ARG)) return UndoFail( #ARG, VAL, __FILE__, __LINE__ )
 
-#define INC_UNDO_INX( INX ) {\
-		if (++INX >= UNDO_STACK_SIZE) \
-			INX = 0; \
-		}
-#define DEC_UNDO_INX( INX ) {\
-		if (--INX < 0) \
-			INX = UNDO_STACK_SIZE-1; \
-		}
+EXPORT long undoMemory = 32;		/**< undo memory budget in MB, a preference */
 
+/*
+ * Streams are kept in blocks of BSTREAM_SIZE bytes.  Blocks of old undo
+ * entries are compressed and expanded again when they are read back.
+ */
 #define BSTREAM_SIZE (4096)
 typedef char streamBlocks_t[BSTREAM_SIZE];
 typedef streamBlocks_t *streamBlocks_p;
+typedef struct {
+		char * data;		/**< the block, or its compressed contents */
+		int size;		/**< BSTREAM_SIZE unless compressed */
+		} streamBlock_t;
 typedef struct {
 		dynArr_t stream_da;
 		long startBInx;
@@ -98,9 +126,14 @@ typedef struct {
 typedef stream_t *stream_p;
 static stream_t undoStream;
 static stream_t redoStream;
+static long streamMemory = 0;		/**< bytes held by the stream blocks */
 
 static BOOL_T needAttachTrains = FALSE;
 
+static void UndoLogBefore( track_p trk );
+static void UndoLogState( void );
+static void SetButtons( BOOL_T undoSetting, BOOL_T redoSetting );
+
 void UndoResume( void )
 {
 	LOG( log_undo, 1, ( "UndoResume()\n" ) )
@@ -114,6 +147,90 @@ void UndoSuspend( void )
 }
 
 
+/**
+ * Free the tracks created by the undone commands, from entry first on.
+ */
+static void FreeUndoneTracks( int first )
+{
+	undoStack_p us1;
+	track_p trk, next;
+	int inx, usp;
+	for( inx=0,usp = first; inx<undoCount; inx++,usp++ ) {
+		us1 = &undoStack(usp);
+		if (recordUndo) Rprintf("  U[%d] N:%d\n", usp, us1->newCnt );
+		for (trk=us1->newTrks; trk; trk=next) {
+			if (recordUndo) Rprintf( "    Free T%d @ %lx\n", trk->index, (long)trk );
+			/*ASSERT( IsTrackDeleted(trk) );*/
+			next = trk->next;
+			FreeTrack( trk );
+		}
+	}
+}
+
+
+/**
+ * Return block binx of stream, expanding it first if it is compressed.
+ *
+ * \param stream IN the stream
+ * \param binx IN index of the block in stream_da
+ * \return the block or NULL if it can not be expanded
+ */
+static streamBlocks_p StreamBlock( stream_p stream, long binx )
+{
+	streamBlock_t * sb = &DYNARR_N( streamBlock_t, stream->stream_da, binx );
+	char * data;
+	if ( sb->size != BSTREAM_SIZE ) {
+		data = (char*)MyMalloc( BSTREAM_SIZE );
+		if ( LzDecompress( sb->data, sb->size, data, BSTREAM_SIZE ) != BSTREAM_SIZE ) {
+			MyFree( data );
+			return NULL;
+		}
+		MyFree( sb->data );
+		streamMemory += BSTREAM_SIZE - sb->size;
+		sb->data = data;
+		sb->size = BSTREAM_SIZE;
+	}
+	return (streamBlocks_p)sb->data;
+}
+
+
+/**
+ * Compress the full blocks of stream before offset off which are not yet
+ * compressed.  Blocks which do not get smaller are left alone.
+ *
+ * \param stream IN the stream
+ * \param off IN stream offset of the first byte to keep expanded
+ */
+static void CompressStream( stream_p stream, long off )
+{
+	static char buff[BSTREAM_SIZE];
+	streamBlock_t * sb;
+	long binx;
+	int size;
+	for ( binx = 0; binx < off/BSTREAM_SIZE-stream->startBInx; binx++ ) {
+		sb = &DYNARR_N( streamBlock_t, stream->stream_da, binx );
+		if ( sb->size != BSTREAM_SIZE )
+			continue;
+		size = LzCompress( sb->data, BSTREAM_SIZE, buff, BSTREAM_SIZE-BSTREAM_SIZE/8 );
+		if ( size == 0 )
+			continue;
+		MyFree( sb->data );
+		sb->data = (char*)MyMalloc( size );
+		memcpy( sb->data, buff, size );
+		sb->size = size;
+		streamMemory -= BSTREAM_SIZE - size;
+	}
+}
+
+
+static void FreeStreamBlock( stream_p stream, long binx )
+{
+	streamBlock_t * sb = &DYNARR_N( streamBlock_t, stream->stream_da, binx );
+	streamMemory -= sb->size;
+	MyFree( sb->data );
+}
+
+
 static void DumpStream( FILE * outf, stream_p stream, char * name )
 {
 	long binx;
@@ -126,7 +243,12 @@ static void DumpStream( FILE * outf, stream_p stream, char * name )
 	off = stream->startBInx*BSTREAM_SIZE;
 	zeroCnt = 0;
 	for ( binx=0; binx<stream->stream_da.cnt; binx++ ) {
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, binx );
+		blk = StreamBlock( stream, binx );
+		if ( blk == NULL ) {
+			fprintf( outf, "%6.6lx (corrupt compressed block)\n", off );
+			off += BSTREAM_SIZE;
+			continue;
+		}
 		for ( i=0; i<BSTREAM_SIZE; i+= 16 ) {
 			if ( memcmp( &((*blk)[i]), zeros, 16 ) == 0 ) {
 				zeroCnt++;
@@ -153,7 +275,7 @@ static void DumpStream( FILE * outf, stream_p stream, char * name )
 
 static BOOL_T UndoFail( char * cause, long val, char * fileName, int lineNumber )
 {
-	int inx, cnt;
+	int inx;
 	undoStack_p us;
 	FILE * outf;
 	time_t clock;
@@ -170,18 +292,13 @@ static BOOL_T UndoFail( char * cause, long val, char * fileName, int lineNumber
 	fprintf(outf, "\nUndo Assert: %s @ %s:%d (%s)\n", cause, fileName, lineNumber, ctime(&clock) );
 	fprintf(outf, "Val = %ld(%lx)\n", val, val );
 	fprintf(outf, "to_first=%lx, to_last=%lx\n", (long)to_first, (long)to_last );
-	fprintf(outf, "undoHead=%d, doCount=%d, undoCount=%d\n", undoHead, doCount, undoCount );
-	if (undoHead >= 0 && undoHead < UNDO_STACK_SIZE)
-		inx=undoHead;
-	else
-		inx = 0;
-	for (cnt=0; cnt<UNDO_STACK_SIZE; cnt++) {
-		us = &undoStack[inx];
+	fprintf(outf, "undoHead=%d, doCount=%d, undoCount=%d, memory=%ld\n", undoHead, doCount, undoCount, streamMemory );
+	for (inx=0; inx<undoStack_da.cnt; inx++) {
+		us = &undoStack(inx);
 		fprintf( outf, "US[%d]: M:%d N:%d D:%d TC:%d NT:%lx OT:%lx NT:%lx US:%lx UE:%lx RS:%lx RE:%lx NR:%d\n",
 				inx, us->modCnt, us->newCnt, us->delCnt, us->trackCount,
 				(long)us->newTrks, (long)us->oldTail, (long)us->newTail,
 				us->undoStart, us->undoEnd, us->redoStart, us->redoEnd, us->needRedo );
-		INC_UNDO_INX(inx);
 	}
 	fprintf( outf, "Undo: SBI:%ld E:%lx C:%lx SC:%d SM:%d\n",
 			undoStream.startBInx, undoStream.end, undoStream.curr, undoStream.stream_da.cnt, undoStream.stream_da.max );
@@ -213,7 +330,8 @@ LOG( log_undo, 5, ( "ReadStream( , %lx, %d ) %ld %ld %ld\n", (long)ptr, size, st
 	brem = BSTREAM_SIZE - boff;
 	while ( brem < size ) {
 		UASSERT( binx>=0 && binx < stream->stream_da.cnt, binx );
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, binx );
+		blk = StreamBlock( stream, binx );
+		UASSERT( blk != NULL, binx );
 		memcpy( ptr, &(*blk)[boff], (size_t)brem );
 		ptr = (char*)ptr + brem;
 		size -= (int)brem;
@@ -223,7 +341,8 @@ LOG( log_undo, 5, ( "ReadStream( , %lx, %d ) %ld %ld %ld\n", (long)ptr, size, st
 	}
 	if (size) {
 		UASSERT( binx>=0 && binx < stream->stream_da.cnt, binx );
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, binx );
+		blk = StreamBlock( stream, binx );
+		UASSERT( blk != NULL, binx );
 		memcpy( ptr, &(*blk)[boff], size );
 	}
 	return TRUE;
@@ -244,12 +363,15 @@ LOG( log_undo, 5, ( "WriteStream( , %lx, %d ) %ld %ld %ld\n", (long)ptr, size, s
 	while ( size ) {
 		if (boff==0) {
 			UASSERT( binx == stream->stream_da.cnt, binx );
-			DYNARR_APPEND( streamBlocks_p, stream->stream_da, 10 );
+			DYNARR_APPEND( streamBlock_t, stream->stream_da, 10 );
 			blk = (streamBlocks_p)MyMalloc( sizeof *blk );
-			DYNARR_N( streamBlocks_p, stream->stream_da, binx ) = blk;
+			DYNARR_N( streamBlock_t, stream->stream_da, binx ).data = (char*)blk;
+			DYNARR_N( streamBlock_t, stream->stream_da, binx ).size = BSTREAM_SIZE;
+			streamMemory += BSTREAM_SIZE;
 		} else {
 			UASSERT( binx == stream->stream_da.cnt-1, binx );
-			blk = DYNARR_N( streamBlocks_p, stream->stream_da, binx );
+			blk = StreamBlock( stream, binx );
+			UASSERT( blk != NULL, binx );
 		}
 		if (size > brem) {
 			memcpy( &(*blk)[boff], ptr, (size_t)brem );
@@ -269,7 +391,6 @@ LOG( log_undo, 5, ( "WriteStream( , %lx, %d ) %ld %ld %ld\n", (long)ptr, size, s
 BOOL_T TrimStream( stream_p stream, long off )
 {
 	long binx, cnt, inx;
-	streamBlocks_p blk;
 LOG( log_undo, 3, ( "TrimStream( , %ld )\n", off ) )
 	binx = off/BSTREAM_SIZE;
 	cnt = binx-stream->startBInx;
@@ -279,11 +400,10 @@ LOG( log_undo, 3, ( "TrimStream( , %ld )\n", off ) )
 	if (cnt == 0)
 		return TRUE;
 	for (inx=0; inx<cnt; inx++) {
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, inx );
-		MyFree( blk );
+		FreeStreamBlock( stream, inx );
 	}
 	for (inx=cnt; inx<stream->stream_da.cnt; inx++ ) {
-		DYNARR_N( streamBlocks_p, stream->stream_da, inx-cnt ) = DYNARR_N( streamBlocks_p, stream->stream_da, inx );
+		DYNARR_N( streamBlock_t, stream->stream_da, inx-cnt ) = DYNARR_N( streamBlock_t, stream->stream_da, inx );
 	}
 	stream->startBInx = binx;
 	stream->stream_da.cnt -= (wIndex_t)cnt;
@@ -295,10 +415,8 @@ LOG( log_undo, 3, ( "TrimStream( , %ld )\n", off ) )
 void ClearStream( stream_p stream )
 {
 	long inx;
-	streamBlocks_p blk;
 	for (inx=0; inx<stream->stream_da.cnt; inx++) {
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, inx );
-		MyFree( blk );
+		FreeStreamBlock( stream, inx );
 	}
 	stream->stream_da.cnt = 0;
 	stream->startBInx = stream->end = stream->curr = 0;
@@ -308,7 +426,6 @@ void ClearStream( stream_p stream )
 BOOL_T TruncateStream( stream_p stream, long off )
 {
 	long binx, boff, cnt, inx;
-	streamBlocks_p blk;
 LOG( log_undo, 3, ( "TruncateStream( , %ld )\n", off ) )
 	binx = off/BSTREAM_SIZE;
 	boff = off%BSTREAM_SIZE;
@@ -322,8 +439,7 @@ LOG( log_undo, 3, ( "TruncateStream( , %ld )\n", off ) )
 	if (cnt == 0)
 		return TRUE;
 	for (inx=binx; inx<stream->stream_da.cnt; inx++) {
-		blk = DYNARR_N( streamBlocks_p, stream->stream_da, inx );
-		MyFree( blk );
+		FreeStreamBlock( stream, inx );
 	}
 	stream->stream_da.cnt = (wIndex_t)binx;
 	stream->end = off;
@@ -332,6 +448,57 @@ LOG( log_undo, 3, ( "TruncateStream( , %ld )\n", off ) )
 }
 
 
+/**
+ * Overwrite size bytes of stream at offset off.
+ */
+static BOOL_T PatchStream( stream_p stream, long off, void * ptr, int size )
+{
+	long binx, boff, brem;
+	streamBlocks_p blk;
+	binx = off/BSTREAM_SIZE - stream->startBInx;
+	boff = off%BSTREAM_SIZE;
+	while ( size > 0 ) {
+		UASSERT( binx>=0 && binx < stream->stream_da.cnt, binx );
+		blk = StreamBlock( stream, binx );
+		UASSERT( blk != NULL, binx );
+		brem = BSTREAM_SIZE - boff;
+		if ( brem > size )
+			brem = size;
+		memcpy( &(*blk)[boff], ptr, (size_t)brem );
+		ptr = (char*)ptr + brem;
+		size -= (int)brem;
+		binx++;
+		boff = 0;
+	}
+	return TRUE;
+}
+
+
+/**
+ * Read the op, track and track_t of the next object in stream and skip the
+ * rest of it.
+ */
+static BOOL_T NextObject( stream_p stream, char * op, track_p * trk, track_t * tempTrk )
+{
+	long Addsize;
+	if (!ReadStream( stream, op, sizeof *op ))
+		return FALSE;
+	UASSERT( *op >= ModifyOp && *op <= StaleOp, (long)*op );
+	if (!ReadStream( stream, trk, sizeof *trk ))
+		return FALSE;
+	if (!ReadStream( stream, tempTrk, sizeof *tempTrk ))
+		return FALSE;
+	stream->curr += tempTrk->endCnt*sizeof tempTrk->endPt[0];
+	stream->curr += tempTrk->extraSize;
+	if ( IsXformOp(*op) )
+		return TRUE;
+	if (!ReadStream( stream, &Addsize, sizeof Addsize ))
+		return FALSE;
+	stream->curr += Addsize;
+	return TRUE;
+}
+
+
 BOOL_T WriteObject( stream_p stream, char op, track_p trk )
 {
 	void * buff = NULL;
@@ -353,6 +520,432 @@ BOOL_T WriteObject( stream_p stream, char op, track_p trk )
 }
 
 
+static BOOL_T WriteXform( stream_p stream, char op, track_p trk )
+{
+	if (!WriteStream( stream, &op, sizeof op ) ||
+		!WriteStream( stream, &trk, sizeof trk ) ||
+		!WriteStream( stream, trk, sizeof *trk ) ||
+		!WriteStream( stream, trk->endPt, trk->endCnt * sizeof trk->endPt[0] ) ||
+		!WriteStream( stream, trk->extraData, trk->extraSize ))
+		return FALSE;
+	return TRUE;
+}
+
+
+/*****************************************************************************
+ *
+ * GRAVEYARD
+ *
+ */
+
+/*
+ * When a command that deleted tracks ends, the deleted tracks are moved off
+ * the track list onto the graveyard so that walking the list only visits
+ * live tracks.  They are kept there while the undo history can bring them
+ * back.  Undo puts them back in their old place in the list (ordered by
+ * trk->seq, which RenumberTracks keeps up to date for the graveyard too).
+ * The graveyard is linked through trk->next.
+ */
+
+static track_p graveyard = NULL;
+static track_p savedGraveyard = NULL;
+static dynArr_t risen_da;
+
+
+static void BuryDeletedTracks( void )
+{
+	track_p trk, *ptrk;
+	for (ptrk=&to_first; *ptrk; ) {
+		trk = *ptrk;
+		if (!IsTrackDeleted(trk)) {
+			ptrk = &trk->next;
+			continue;
+		}
+		*ptrk = trk->next;
+		trk->next = graveyard;
+		graveyard = trk;
+	}
+	to_last = ptrk;
+}
+
+
+static int CompareTrackSeq( const void * a, const void * b )
+{
+	long seq1 = (*(track_p*)a)->seq;
+	long seq2 = (*(track_p*)b)->seq;
+	return ( seq1 < seq2 ) ? -1 : ( seq1 > seq2 ) ? 1 : 0;
+}
+
+
+static void ResurrectTracks( void )
+{
+	track_p trk, *ptrk;
+	int inx;
+	DYNARR_RESET( track_p, risen_da );
+	for (ptrk=&graveyard; *ptrk; ) {
+		trk = *ptrk;
+		if (IsTrackDeleted(trk)) {
+			ptrk = &trk->next;
+			continue;
+		}
+		*ptrk = trk->next;
+		DYNARR_APPEND( track_p, risen_da, 10 );
+		DYNARR_LAST( track_p, risen_da ) = trk;
+	}
+	if (risen_da.cnt == 0)
+		return;
+	qsort( risen_da.ptr, risen_da.cnt, sizeof (track_p), CompareTrackSeq );
+	ptrk = &to_first;
+	for (inx=0; inx<risen_da.cnt; inx++) {
+		trk = DYNARR_N( track_p, risen_da, inx );
+		if (recordUndo) Rprintf( " Restore T%d @ %lx to list\n", trk->index, (long)trk );
+		while (*ptrk && (*ptrk)->seq <= trk->seq)
+			ptrk = &(*ptrk)->next;
+		trk->next = *ptrk;
+		*ptrk = trk;
+		ptrk = &trk->next;
+		if (trk->next == NULL)
+			to_last = &trk->next;
+	}
+	HotRebuild();
+}
+
+
+/**
+ * The tracks on the graveyard, linked through their next field.
+ */
+EXPORT track_p UndoGraveyard( void )
+{
+	return graveyard;
+}
+
+
+/**
+ * Free the tracks on the graveyard, see ClearTracks.
+ */
+EXPORT void UndoFreeGraveyard( void )
+{
+	track_p trk;
+	while ((trk = graveyard) != NULL) {
+		graveyard = trk->next;
+		FreeTrack( trk );
+	}
+}
+
+
+/**
+ * Set aside the graveyard with the rest of the track list, see
+ * SaveTrackState.
+ */
+EXPORT void UndoSaveGraveyard( void )
+{
+	savedGraveyard = graveyard;
+	graveyard = NULL;
+}
+
+
+/**
+ * Free the current graveyard and reinstate the one set aside by
+ * UndoSaveGraveyard.
+ */
+EXPORT void UndoRestoreGraveyard( void )
+{
+	UndoFreeGraveyard();
+	graveyard = savedGraveyard;
+	savedGraveyard = NULL;
+}
+
+
+/*****************************************************************************
+ *
+ * TRANSFORMS
+ *
+ */
+
+/*
+ * Moving, rotating or flipping a track only changes its position, so instead
+ * of a full copy the undo stream gets its track_t, end points (connections
+ * and elevations) and type specific data (XformOp).  The data StoreTrackData
+ * keeps, and writing it out, is left out.  Undo copies these values back and
+ * rebuilds the segments which are derived from them, so any number of undos
+ * and redos gives back the same track bit for bit.  Applying the inverse
+ * transform would not: every round trip adds rounding errors.  Tracks whose
+ * StoreTrackData data is moved too (HasTrackData) get a full copy.
+ *
+ * Further moves of the track in the same command need nothing more, its
+ * XformOp already holds the values from before the command.  Any other
+ * change needs the full copy, which PromoteXform makes from the XformOp.
+ * xformRecs_da finds the XformOp of a track of the current command; it is an
+ * open hash keyed by the track pointer.
+ *
+ * Commands which treat many tracks alike record them all at once with
+ * UndoMoveTracks or UndoChangeTracks.  RecordXforms builds their XformOps in
+ * xformBuf_da and writes them to the stream in large pieces.
+ * UndoChangeTracks is for a change of layer, flags, width, scale or
+ * elevations, which leaves the StoreTrackData data alone.
+ */
+
+typedef struct {
+		track_p trk;
+		long off;		/**< offset of its XformOp in undoStream, -1 if it has a full copy */
+		} xformRec_t;
+static dynArr_t xformRecs_da;
+#define xformRecs(N) DYNARR_N( xformRec_t, xformRecs_da, N )
+static int xformRecCnt = 0;
+static dynArr_t xformEndPts_da;
+static dynArr_t xformExtra_da;
+static dynArr_t xformBuf_da;
+#define XFORMBUF_SIZE (16*BSTREAM_SIZE)
+
+static void ClearXformRecs( void )
+{
+	if ( xformRecCnt == 0 )
+		return;
+	memset( xformRecs_da.ptr, 0, xformRecs_da.cnt * sizeof (xformRec_t) );
+	xformRecCnt = 0;
+}
+
+
+static xformRec_t * FindXformRec( track_p trk, BOOL_T add )
+{
+	xformRec_t * old;
+	int oldCnt, inx, mask;
+	if ( add && (xformRecCnt+1)*2 > xformRecs_da.cnt ) {
+		oldCnt = xformRecs_da.cnt;
+		old = NULL;
+		if ( oldCnt > 0 ) {
+			old = (xformRec_t*)MyMalloc( oldCnt * sizeof *old );
+			memcpy( old, xformRecs_da.ptr, oldCnt * sizeof *old );
+		}
+		inx = oldCnt > 0 ? oldCnt*2 : 256;
+		DYNARR_SET( xformRec_t, xformRecs_da, inx );
+		memset( xformRecs_da.ptr, 0, xformRecs_da.cnt * sizeof *old );
+		xformRecCnt = 0;
+		for ( inx=0; inx<oldCnt; inx++ )
+			if ( old[inx].trk != NULL )
+				*FindXformRec( old[inx].trk, TRUE ) = old[inx];
+		if ( old )
+			MyFree( old );
+	}
+	if ( xformRecCnt == 0 && !add )
+		return NULL;
+	mask = xformRecs_da.cnt-1;
+	for ( inx = (int)(((size_t)trk>>4)*2654435761UL) & mask; xformRecs(inx).trk; inx = (inx+1) & mask ) {
+		if ( xformRecs(inx).trk == trk )
+			return &xformRecs(inx);
+	}
+	if ( !add )
+		return NULL;
+	xformRecCnt++;
+	xformRecs(inx).trk = trk;
+	return &xformRecs(inx);
+}
+
+
+/**
+ * Give trk back the values recorded in an XformOp.
+ *
+ * \param trk IN the track
+ * \param tempTrk IN its recorded track_t
+ * \param endPts IN its recorded end points
+ * \param extraData IN its recorded type specific data
+ * \param rebuild IN rebuild the segments derived from the type specific data
+ */
+static void CopyXform( track_p trk, track_t * tempTrk, trkEndPt_p endPts, void * extraData, BOOL_T rebuild )
+{
+	track_t newTrk;
+	newTrk = *tempTrk;
+	newTrk.endPt = trk->endPt;
+	newTrk.extraData = trk->extraData;
+	newTrk.extraSize = trk->extraSize;
+	if ( newTrk.endCnt > 0 )
+		memcpy( newTrk.endPt, endPts, newTrk.endCnt * sizeof newTrk.endPt[0] );
+	if ( newTrk.extraSize > 0 )
+		memcpy( newTrk.extraData, extraData, newTrk.extraSize );
+	if ( rebuild ) {
+		/* newTrk is not in the grid: don't let RebuildTrackSegs register it */
+		newTrk.grid.inGrid = FALSE;
+		RebuildTrackSegs( &newTrk );
+	}
+	newTrk.index = trk->index;
+	newTrk.next = trk->next;
+	newTrk.seq = trk->seq;
+	newTrk.grid = trk->grid;
+	newTrk.hot = trk->hot;
+	newTrk.sel = trk->sel;
+	newTrk.lists = trk->lists;
+	*trk = newTrk;
+}
+
+
+/**
+ * Replace the XformOp of a track of the current command by a full copy of
+ * the track as it was before the command.
+ */
+static BOOL_T PromoteXform( xformRec_t * rec )
+{
+	undoStack_p us = &undoStack(undoHead);
+	track_p trk = rec->trk;
+	track_t tempTrk, curTrk;
+	char * extraData;
+	char op = StaleOp;
+LOG( log_undo, 3, ( "    PromoteXform( T%d )\n", trk->index ) )
+	undoStream.curr = rec->off + sizeof op + sizeof trk;
+	if (!ReadStream( &undoStream, &tempTrk, sizeof tempTrk ))
+		return FALSE;
+	UASSERT( tempTrk.endCnt == trk->endCnt, tempTrk.endCnt );
+	UASSERT( tempTrk.extraSize == trk->extraSize, tempTrk.extraSize );
+	DYNARR_SET( trkEndPt_t, xformEndPts_da, trk->endCnt*2 );
+	DYNARR_SET( char, xformExtra_da, trk->extraSize*2 );
+	extraData = (char*)xformExtra_da.ptr;
+	if (!ReadStream( &undoStream, xformEndPts_da.ptr, trk->endCnt * sizeof trk->endPt[0] ) ||
+		!ReadStream( &undoStream, extraData, trk->extraSize ))
+		return FALSE;
+	if ( trk->endCnt > 0 )
+		memcpy( &DYNARR_N( trkEndPt_t, xformEndPts_da, trk->endCnt ), trk->endPt, trk->endCnt * sizeof trk->endPt[0] );
+	if ( trk->extraSize > 0 )
+		memcpy( extraData + trk->extraSize, trk->extraData, trk->extraSize );
+	curTrk = *trk;
+	CopyXform( trk, &tempTrk, &DYNARR_N( trkEndPt_t, xformEndPts_da, 0 ), extraData, FALSE );
+	if (!WriteObject( &undoStream, ModifyOp, trk ))
+		return FALSE;
+	us->undoEnd = undoStream.end;
+	CopyXform( trk, &curTrk, &DYNARR_N( trkEndPt_t, xformEndPts_da, trk->endCnt ), extraData + trk->extraSize, FALSE );
+	if (!PatchStream( &undoStream, rec->off, &op, sizeof op ))
+		return FALSE;
+	rec->off = -1;
+	return TRUE;
+}
+
+
+static BOOL_T FlushXforms( void )
+{
+	if ( xformBuf_da.cnt == 0 )
+		return TRUE;
+	if (!WriteStream( &undoStream, xformBuf_da.ptr, xformBuf_da.cnt ))
+		return FALSE;
+	undoStack(undoHead).undoEnd = undoStream.end;
+	DYNARR_RESET( char, xformBuf_da );
+	return TRUE;
+}
+
+
+/**
+ * Record cnt tracks before a move, rotate, flip or a change of their track_t
+ * or end points.
+ *
+ * \param cnt IN number of tracks
+ * \param trks IN the tracks
+ * \param copyData IN the data StoreTrackData keeps changes too, tracks which
+ *	have such data get a full copy
+ */
+static BOOL_T RecordXforms( int cnt, track_p * trks, BOOL_T copyData )
+{
+	undoStack_p us;
+	xformRec_t * rec;
+	track_p trk;
+	char * cp;
+	int inx, size;
+
+	if ( !undoActive ) return TRUE;
+	UASSERT(undoCount==0, undoCount);
+	UASSERT(undoHead >= 0, undoHead);
+LOG( log_undo, 2, ( "    RecordXforms( %d, C%d )\n", cnt, copyData ) )
+	us = &undoStack(undoHead);
+	if ( xformBuf_da.max < XFORMBUF_SIZE )
+		DYNARR_SET( char, xformBuf_da, XFORMBUF_SIZE );
+	DYNARR_RESET( char, xformBuf_da );
+	for ( inx=0; inx<cnt; inx++ ) {
+		trk = trks[inx];
+		if ( trk == NULL || trk->new )
+			continue;
+		UASSERT(!IsTrackDeleted(trk), (long)trk);
+		if ( copyData && HasTrackData( trk ) ) {
+			/* its XformOp may still be in the buffer */
+			if (!FlushXforms() || !UndoModify( trk ))
+				return FALSE;
+			continue;
+		}
+		if ( trk->modified )
+			continue;
+		if ( (GetTrkBits(trk)&TB_CARATTACHED)!=0 )
+			needAttachTrains = TRUE;
+		if (recordUndo)
+			Rprintf( " XFORM T%d @ %lx\n", trk->index, (long)trk );
+		UndoLogBefore( trk );
+		size = sizeof XformOp + sizeof trk + sizeof *trk + trk->endCnt * sizeof trk->endPt[0] + trk->extraSize;
+		if ( xformBuf_da.cnt + size > xformBuf_da.max ) {
+			if (!FlushXforms())
+				return FALSE;
+			if ( size > xformBuf_da.max )
+				DYNARR_SET( char, xformBuf_da, size );
+			DYNARR_RESET( char, xformBuf_da );
+		}
+		rec = FindXformRec( trk, TRUE );
+		rec->off = undoStream.end + xformBuf_da.cnt;
+		cp = (char*)xformBuf_da.ptr + xformBuf_da.cnt;
+		DYNARR_SET( char, xformBuf_da, xformBuf_da.cnt + size );
+		/* the layout of WriteXform */
+		memcpy( cp, &XformOp, sizeof XformOp );
+		cp += sizeof XformOp;
+		memcpy( cp, &trk, sizeof trk );
+		cp += sizeof trk;
+		memcpy( cp, trk, sizeof *trk );
+		cp += sizeof *trk;
+		memcpy( cp, trk->endPt, trk->endCnt * sizeof trk->endPt[0] );
+		cp += trk->endCnt * sizeof trk->endPt[0];
+		memcpy( cp, trk->extraData, trk->extraSize );
+		trk->modified = TRUE;
+		us->modCnt++;
+	}
+	return FlushXforms();
+}
+
+
+/**
+ * Restore the rest of trk after its track_t was copied back.
+ */
+static void RestoredTrack( track_p trk )
+{
+	if ( (trk->bits&TB_CARATTACHED) != 0 )
+		needAttachTrains = TRUE;
+	trk->bits &= ~TB_TEMPBITS;
+	GridUpdateTrack( trk );
+	GridUpdateEndPts( trk );
+	HotUpdateTrack( trk );
+	UpdateTrackLists( trk );
+	if (!trk->deleted)
+		ClrTrkElev( trk );
+}
+
+
+static BOOL_T ReadXformObject( stream_p stream, char op, track_p trk, BOOL_T needRedo )
+{
+	track_t tempTrk;
+	if (!ReadStream( stream, &tempTrk, sizeof tempTrk ))
+		return FALSE;
+	if ( op == StaleOp ) {
+		stream->curr += tempTrk.endCnt * sizeof tempTrk.endPt[0] + tempTrk.extraSize;
+		return TRUE;
+	}
+	UASSERT( tempTrk.endCnt == trk->endCnt, tempTrk.endCnt );
+	UASSERT( tempTrk.extraSize == trk->extraSize, tempTrk.extraSize );
+	DYNARR_SET( trkEndPt_t, xformEndPts_da, trk->endCnt );
+	DYNARR_SET( char, xformExtra_da, trk->extraSize );
+	if (!ReadStream( stream, xformEndPts_da.ptr, trk->endCnt * sizeof trk->endPt[0] ) ||
+		!ReadStream( stream, xformExtra_da.ptr, trk->extraSize ))
+		return FALSE;
+	if (needRedo) {
+		if (!WriteXform( &redoStream, op, trk ))
+			return FALSE;
+	}
+	if (recordUndo) Rprintf( "Transform T%d @ %lx\n", trk->index, (long)trk );
+	CopyXform( trk, &tempTrk, &DYNARR_N( trkEndPt_t, xformEndPts_da, 0 ), xformExtra_da.ptr, TRUE );
+	RestoredTrack( trk );
+	return TRUE;
+}
+
+
 static BOOL_T ReadObject( stream_p stream, BOOL_T needRedo )
 {
 	track_p trk;
@@ -362,20 +955,24 @@ static BOOL_T ReadObject( stream_p stream, BOOL_T needRedo )
 		return FALSE;
 	if (!ReadStream( stream, &trk, sizeof trk ))
 		return FALSE;
+	if ( IsXformOp(op) )
+		return ReadXformObject( stream, op, trk, needRedo );
 	if (needRedo) {
 		if (!WriteObject( &redoStream, op, trk ))
 			return FALSE;
 	}
 	if (!ReadStream( stream, &tempTrk, sizeof tempTrk ))
 		return FALSE;
+	/* tempTrk is not in the grid: don't let RebuildTrackSegs register it */
+	tempTrk.grid.inGrid = FALSE;
 	if (tempTrk.endCnt != trk->endCnt)
-		tempTrk.endPt = MyRealloc( trk->endPt, tempTrk.endCnt * sizeof tempTrk.endPt[0] );
+		tempTrk.endPt = PoolRealloc( trk->endPt, trk->endCnt * sizeof trk->endPt[0], tempTrk.endCnt * sizeof tempTrk.endPt[0] );
 	else
 		tempTrk.endPt = trk->endPt;
 	if (!ReadStream( stream, tempTrk.endPt, tempTrk.endCnt * sizeof tempTrk.endPt[0] ))
 		return FALSE;
 	if (tempTrk.extraSize != trk->extraSize)
-		tempTrk.extraData = MyRealloc( trk->extraData, tempTrk.extraSize );
+		tempTrk.extraData = PoolRealloc( trk->extraData, trk->extraSize, tempTrk.extraSize );
 	else
 		tempTrk.extraData = trk->extraData;
 	if (!ReadStream( stream, tempTrk.extraData, tempTrk.extraSize ))
@@ -396,12 +993,13 @@ static BOOL_T ReadObject( stream_p stream, BOOL_T needRedo )
 	if (recordUndo) Rprintf( "Restore T%D(%d) @ %lx\n", trk->index, tempTrk.index, (long)trk );
 	tempTrk.index = trk->index;
 	tempTrk.next = trk->next;
-	if ( (tempTrk.bits&TB_CARATTACHED) != 0 )
-		needAttachTrains = TRUE;
-	tempTrk.bits &= ~TB_TEMPBITS;
+	tempTrk.seq = trk->seq;
+	tempTrk.grid = trk->grid;
+	tempTrk.hot = trk->hot;
+	tempTrk.sel = trk->sel;
+	tempTrk.lists = trk->lists;
 	*trk = tempTrk;
-	if (!trk->deleted)
-		ClrTrkElev( trk );
+	RestoredTrack( trk );
 	return TRUE;
 }
 
@@ -413,16 +1011,9 @@ static BOOL_T RedrawInStream( stream_p stream, long start, long end, BOOL_T draw
 	track_t tempTrk;
 	stream->curr = start;
 	while (stream->curr < end ) {
-		if (!ReadStream( stream, &op, sizeof op ) ||
-			!ReadStream( stream, &trk, sizeof trk ) ||
-			!ReadStream( stream, &tempTrk, sizeof tempTrk ) )
+		if (!NextObject( stream, &op, &trk, &tempTrk ))
 			return FALSE;
-		stream->curr += tempTrk.extraSize + tempTrk.endCnt*sizeof tempTrk.endPt[0];;
-		long Addsize;
-		if (!ReadStream( stream, &Addsize, sizeof Addsize ))
-				return FALSE;
-		stream->curr += Addsize;
-		if (!trk->deleted) {
+		if (op != StaleOp && !trk->deleted) {
 			if (draw)
 				DrawNewTrack( trk );
 			else
@@ -443,26 +1034,27 @@ static BOOL_T DeleteInStream( stream_p stream, long start, long end )
 LOG( log_undo, 3, ( "DeleteInSteam( , %ld, %ld )\n", start, end ) )
 	stream->curr = start;
 	while (stream->curr < end ) {
-		if (!ReadStream( stream, &op, sizeof op ))
+		if (!NextObject( stream, &op, &trk, &tempTrk ))
 			return FALSE;
-		UASSERT( op == ModifyOp || op == DeleteOp, (long)op );
-		if (!ReadStream( stream, &trk, sizeof trk ) ||
-			!ReadStream( stream, &tempTrk, sizeof tempTrk ))
-			return FALSE;
-		stream->curr += tempTrk.extraSize + tempTrk.endCnt*sizeof tempTrk.endPt[0];
-		long Addsize;
-		if (!ReadStream( stream, &Addsize, sizeof Addsize ))
-			return FALSE;
-		stream->curr += Addsize;
-		if (op == DeleteOp) {
+		if (op == DeleteOp || op == XformDeleteOp) {
 			if (recordUndo) Rprintf( "    Free T%D(%d) @ %lx\n", trk->index, tempTrk.index, (long)trk );
 			UASSERT( IsTrackDeleted(trk), (long)trk );
+			UnindexTrack( trk );
 			trk->index = -1;
 			delCount++;
 		}
 
 	}
 	if (delCount) {
+		for (ptrk=&graveyard; *ptrk; ) {
+			if ((*ptrk)->index == -1) {
+				trk = *ptrk;
+				*ptrk = trk->next;
+				FreeTrack(trk);
+			} else {
+				ptrk = &(*ptrk)->next;
+			}
+		}
 		for (ptrk=&to_first; *ptrk; ) {
 			if ((*ptrk)->index == -1) {
 				trk = *ptrk;
@@ -484,64 +1076,1262 @@ static BOOL_T SetDeleteOpInStream( stream_p stream, long start, long end, track_
 	char op;
 	track_p trk;
 	track_t tempTrk;
-	long binx, boff;
-	streamBlocks_p blk;
+	long off;
 
 	stream->curr = start;
 	while (stream->curr < end) {
-		binx = stream->curr/BSTREAM_SIZE;
-		binx -= stream->startBInx;
-		boff = stream->curr%BSTREAM_SIZE;
-		if (!ReadStream( stream, &op, sizeof op ))
+		off = stream->curr;
+		if (!NextObject( stream, &op, &trk, &tempTrk ))
 			return FALSE;
-		UASSERT( op == ModifyOp || op == DeleteOp, (long)op );
-		if (!ReadStream( stream, &trk, sizeof trk ) )
-			return FALSE;
-		if (trk == trk0) {
-			UASSERT( op == ModifyOp, (long)op );
-			blk = DYNARR_N( streamBlocks_p, stream->stream_da, binx );
-			memcpy( &(*blk)[boff], &DeleteOp, sizeof DeleteOp );
-			return TRUE;
+		if (trk == trk0 && op != StaleOp) {
+			UASSERT( op == ModifyOp || op == XformOp, (long)op );
+			op = (op == ModifyOp) ? DeleteOp : XformDeleteOp;
+			return PatchStream( stream, off, &op, sizeof op );
 		}
-		if (!ReadStream( stream, &tempTrk, sizeof tempTrk ))
-			return FALSE;
-		stream->curr += tempTrk.extraSize + tempTrk.endCnt*sizeof tempTrk.endPt[0];
-		long Addsize;
-		if (!ReadStream( stream, &Addsize, sizeof Addsize))
-				return FALSE;
-		stream->curr += Addsize;
 	}
 	UASSERT( "Cannot find undo record to convert to DeleteOp", 0 );
 	return FALSE;
 }
 
-
-static void SetButtons( BOOL_T undoSetting, BOOL_T redoSetting )
-{
-	static BOOL_T undoButtonEnabled = FALSE;
-	static BOOL_T redoButtonEnabled = FALSE;
-	int index;
-	static char undoHelp[STR_SHORT_SIZE];
-	static char redoHelp[STR_SHORT_SIZE];
 
-	if (undoButtonEnabled != undoSetting) {
-		wControlActive( (wControl_p)undoB, undoSetting );
-		undoButtonEnabled = undoSetting;
-	}
-	if (redoButtonEnabled != redoSetting) {
-		wControlActive( (wControl_p)redoB, redoSetting );
-		redoButtonEnabled = redoSetting;
-	}
-	if (undoSetting) {
-		sprintf( undoHelp, _("Undo: %s"), undoStack[undoHead].label );
+/*****************************************************************************
+ *
+ * JOURNAL
+ *
+ */
+
+/*
+ * Between two full checkpoint snapshots every completed undo group (and every
+ * undo) is appended to the journal as the text records of the tracks it
+ * touched, so a crash loses at most the command that was in progress.  The
+ * objects in the undo stream are raw copies of the tracks and only mean
+ * something in this process, so they are used to find the touched tracks and
+ * their current state is written with WriteTrack.  A group looks like:
+ *
+ *	#JOURNAL <n>
+ *	#DELETE <index>
+ *	#TRACK <index>
+ *	<the track in layout file format>
+ *	#JOURNAL END
+ *
+ * The records are keyed by track index.  When RenumberTracks gives the tracks
+ * new indices a group holds "#RENUMBER" and the old and new index of each
+ * track instead.  The journal is only given up when the tracks are reordered
+ * (see SequenceTracks); the next checkpoint then writes a full snapshot.
+ *
+ * Each group is flushed at once, but the disk is synced on a worker thread so
+ * the command does not wait for it.  One sync runs at a time; the groups
+ * written meanwhile are synced by the next one, or when the journal is closed.
+ */
+
+static FILE * journalF = NULL;
+static long journalGroups = 0;
+static BOOL_T journalBroken = FALSE;
+static dynArr_t journalTrks_da;
+static worker_p journalSyncer = NULL;
+static BOOL_T journalSyncAgain = FALSE;	/**< groups were written during the sync */
+
+#define JOURNAL_SYNC_WAIT	(5000)	/**< ms UndoJournalClose waits for a sync */
+
+typedef struct {
+		TRKINX_T from;
+		TRKINX_T to;
+		} journalRenum_t;
+static dynArr_t journalRenum_da;
+static dynArr_t journalRenumTrks_da;
+
+typedef struct {
+		track_p trk;
+		EPINX_T ep;
+		} journalLink_t;
+static dynArr_t journalLinks_da;
+
+
+/**
+ * Start a new, empty journal after a full snapshot was written.
+ *
+ * \param fileName IN the journal file
+ * \return FALSE if the file could not be created
+ */
+EXPORT BOOL_T UndoJournalOpen( const char * fileName )
+{
+	UndoJournalClose();
+	journalF = fopen( fileName, "w" );
+	journalGroups = 0;
+	journalBroken = FALSE;
+	if ( journalF == NULL )
+		return FALSE;
+	UndoLogState();
+	return TRUE;
+}
+
+
+/**
+ * Sync a duplicate of the journal's file descriptor to disk and close it.
+ * This runs on a worker thread.
+ */
+static void JournalSyncJob( void * data )
+{
+	int * fd = (int*)data;
+#ifdef WINDOWS
+	_commit( *fd );
+	_close( *fd );
+#else
+	fsync( *fd );
+	close( *fd );
+#endif
+	free( fd );
+}
+
+
+/**
+ * Flush the journal and start syncing it to disk, unless a sync is still
+ * running.  Without a worker the journal is synced here.
+ *
+ * \return FALSE on a write error
+ */
+static BOOL_T JournalSync( void )
+{
+	int * fd;
+
+	if ( fflush( journalF ) != 0 || ferror( journalF ) )
+		return FALSE;
+	if ( journalSyncer != NULL ) {
+		if ( !WaitWorker( journalSyncer, 0 ) ) {
+			journalSyncAgain = TRUE;
+			return TRUE;
+		}
+		journalSyncer = NULL;
+	}
+	journalSyncAgain = FALSE;
+	fd = (int*)malloc( sizeof *fd );
+	if ( fd == NULL )
+		return TRUE;
+#ifdef WINDOWS
+	*fd = _dup( _fileno( journalF ) );
+#else
+	*fd = dup( fileno( journalF ) );
+#endif
+	if ( *fd < 0 ) {
+		free( fd );
+		return TRUE;
+	}
+	journalSyncer = StartWorker( JournalSyncJob, fd );
+	if ( journalSyncer == NULL )
+		JournalSyncJob( fd );
+	return TRUE;
+}
+
+
+/**
+ * Stop journaling.  The groups not synced yet are synced first.
+ */
+EXPORT void UndoJournalClose( void )
+{
+	if ( journalF ) {
+		/* a sync which does not end is left to the end of the process */
+		if ( journalSyncer != NULL )
+			WaitWorker( journalSyncer, JOURNAL_SYNC_WAIT );
+		journalSyncer = NULL;
+		if ( journalSyncAgain && fflush( journalF ) == 0 ) {
+#ifdef WINDOWS
+			_commit( _fileno( journalF ) );
+#else
+			fsync( fileno( journalF ) );
+#endif
+		}
+		journalSyncAgain = FALSE;
+		fclose( journalF );
+		journalF = NULL;
+	}
+}
+
+
+/**
+ * Stop journaling until the next UndoJournalOpen because the track indices
+ * the journal refers to have changed.
+ */
+EXPORT void UndoJournalBreak( void )
+{
+	journalBroken = TRUE;
+}
+
+
+/**
+ * \return TRUE if the journal has recorded every change since it was opened
+ */
+EXPORT BOOL_T UndoJournalActive( void )
+{
+	return journalF != NULL && !journalBroken;
+}
+
+
+static void JournalTrack( track_p trk )
+{
+	if ( IsTrackDeleted(trk) ) {
+		fprintf( journalF, "#DELETE %d\n", trk->index );
+	} else {
+		fprintf( journalF, "#TRACK %d\n", trk->index );
+		WriteTrack( trk, journalF );
+	}
+}
+
+
+/**
+ * Append the tracks touched by an undo group in their current state.
+ */
+static void JournalGroup( undoStack_p us )
+{
+	char op;
+	track_p trk;
+	track_t tempTrk;
+	char * oldLocale;
+
+	if ( !UndoJournalActive() )
+		return;
+	if ( us->modCnt == 0 && us->delCnt == 0 && us->newCnt == 0 )
+		return;
+	oldLocale = SaveLocale( "C" );
+	fprintf( journalF, "#JOURNAL %ld\n", ++journalGroups );
+	undoStream.curr = us->undoStart;
+	while ( undoStream.curr < us->undoEnd ) {
+		if (!NextObject( &undoStream, &op, &trk, &tempTrk ))
+			break;
+		if ( op != StaleOp )
+			JournalTrack( trk );
+	}
+	for ( trk=us->newTrks; trk; trk=trk->next )
+		JournalTrack( trk );
+	fprintf( journalF, "#JOURNAL END\n" );
+	RestoreLocale( oldLocale );
+	if ( !JournalSync() ) {
+		UndoJournalBreak();
+		return;
+	}
+	UndoLogState();
+LOG( log_undo, 2, ( "    JournalGroup[%ld] M:%d N:%d D:%d\n", journalGroups, us->modCnt, us->newCnt, us->delCnt ) )
+}
+
+
+/**
+ * Note that RenumberTracks gives trk a new index.  The tracks created by the
+ * current command are left out: the journal gets them with their new index
+ * when the command ends.
+ */
+EXPORT void UndoJournalRenumber( track_p trk, TRKINX_T index )
+{
+	if ( !UndoJournalActive() || trk->index == index )
+		return;
+	if ( undoActive && trk->new )
+		return;
+	DYNARR_APPEND( journalRenum_t, journalRenum_da, 100 );
+	DYNARR_LAST( journalRenum_t, journalRenum_da ).from = trk->index;
+	DYNARR_LAST( journalRenum_t, journalRenum_da ).to = index;
+}
+
+
+/**
+ * Append the indices changed by RenumberTracks as a group.
+ */
+EXPORT void UndoJournalRenumberDone( void )
+{
+	journalRenum_t * r;
+	int inx;
+
+	if ( UndoJournalActive() && journalRenum_da.cnt > 0 ) {
+		fprintf( journalF, "#JOURNAL %ld\n#RENUMBER\n", ++journalGroups );
+		for ( inx=0; inx<journalRenum_da.cnt; inx++ ) {
+			r = &DYNARR_N( journalRenum_t, journalRenum_da, inx );
+			fprintf( journalF, "%d %d\n", r->from, r->to );
+		}
+		fprintf( journalF, "#JOURNAL END\n" );
+		if ( JournalSync() )
+			UndoLogState();
+		else
+			UndoJournalBreak();
+LOG( log_undo, 2, ( "    JournalGroup[%ld] R:%d\n", journalGroups, journalRenum_da.cnt ) )
+	}
+	DYNARR_RESET( journalRenum_t, journalRenum_da );
+}
+
+
+/**
+ * Take the track with the given index out of the layout before the journal
+ * replaces or deletes it.  It is freed by UndoJournalReplay.
+ */
+static void JournalRetire( const char * cp )
+{
+	track_p trk = FindTrack( (TRKINX_T)atol( cp ) );
+	if ( trk == NULL || IsTrackDeleted(trk) )
+		return;
+	trk->deleted = TRUE;
+	HotUpdateTrack( trk );
+	DYNARR_APPEND( track_p, journalTrks_da, 10 );
+	DYNARR_LAST( track_p, journalTrks_da ) = trk;
+}
+
+
+/**
+ * Free the tracks taken out by JournalRetire.  The end points of other tracks
+ * which were connected to them keep the index of the retired track and are
+ * listed in journalLinks_da, see ConnectRetiredLinks.
+ */
+static void FreeRetiredTracks( void )
+{
+	track_p trk, trk2, * ptrk;
+	EPINX_T ep, ep2;
+	int inx;
+
+	DYNARR_RESET( journalLink_t, journalLinks_da );
+	if ( journalTrks_da.cnt == 0 )
+		return;
+	for ( inx=0; inx<journalTrks_da.cnt; inx++ ) {
+		trk = DYNARR_N( track_p, journalTrks_da, inx );
+		for ( ep=0; ep<trk->endCnt; ep++ ) {
+			trk2 = trk->endPt[ep].track;
+			if ( trk2 == NULL || IsTrackDeleted(trk2) )
+				continue;
+			ep2 = GetEndPtConnectedToMe( trk2, trk );
+			if ( ep2 < 0 )
+				continue;
+			trk2->endPt[ep2].track = NULL;
+			trk2->endPt[ep2].index = trk->index;
+			DYNARR_APPEND( journalLink_t, journalLinks_da, 10 );
+			DYNARR_LAST( journalLink_t, journalLinks_da ).trk = trk2;
+			DYNARR_LAST( journalLink_t, journalLinks_da ).ep = ep2;
+		}
+	}
+	for ( ptrk=&to_first; *ptrk; ) {
+		trk = *ptrk;
+		if ( !IsTrackDeleted(trk) ) {
+			ptrk = &trk->next;
+			continue;
+		}
+		*ptrk = trk->next;
+		DecrementLayerObjects( trk->layer );
+		trackCount--;
+		FreeTrack( trk );
+	}
+	to_last = ptrk;
+}
+
+
+/**
+ * Give the tracks read so far the indices of a "#RENUMBER" group.  The
+ * references between the tracks are resolved first and their indices taken
+ * from the renumbered tracks afterwards.
+ *
+ * \param text IN the group, starting at its first line
+ */
+static void JournalApplyRenumber( char * text )
+{
+	char * cp, * cp1;
+	long from, to;
+	track_p trk, trk2;
+	EPINX_T ep;
+	int inx;
+
+	TRK_ITERATE( trk ) {
+		for ( ep=0; ep<trk->endCnt; ep++ ) {
+			trk2 = trk->endPt[ep].track;
+			if ( trk->endPt[ep].index < 0 ||
+				 ( trk2 != NULL && !IsTrackDeleted(trk2) &&
+				   trk2->index == trk->endPt[ep].index ) )
+				continue;
+			trk->endPt[ep].track = FindTrack( trk->endPt[ep].index );
+		}
+		ResolveBlockTrack( trk );
+		ResolveSwitchmotorTurnout( trk );
+	}
+	DYNARR_RESET( track_p, journalRenumTrks_da );
+	DYNARR_RESET( journalRenum_t, journalRenum_da );
+	cp = strchr( text, '\n' );
+	for ( cp=strchr( cp+1, '\n' ); cp && cp[1] != '#' && cp[1] != '\0'; cp=strchr( cp, '\n' ) ) {
+		from = strtol( cp+1, &cp1, 10 );
+		to = strtol( cp1, &cp, 10 );
+		/* all tracks are looked up before any is changed */
+		if ( (trk = FindTrack( (TRKINX_T)from )) == NULL )
+			continue;
+		DYNARR_APPEND( track_p, journalRenumTrks_da, 100 );
+		DYNARR_LAST( track_p, journalRenumTrks_da ) = trk;
+		DYNARR_APPEND( journalRenum_t, journalRenum_da, 100 );
+		DYNARR_LAST( journalRenum_t, journalRenum_da ).to = (TRKINX_T)to;
+	}
+	for ( inx=0; inx<journalRenumTrks_da.cnt; inx++ )
+		ReindexTrack( DYNARR_N( track_p, journalRenumTrks_da, inx ),
+					  DYNARR_N( journalRenum_t, journalRenum_da, inx ).to );
+	TRK_ITERATE( trk ) {
+		for ( ep=0; ep<trk->endCnt; ep++ )
+			if ( trk->endPt[ep].track != NULL )
+				trk->endPt[ep].index = trk->endPt[ep].track->index;
+		RenumberBlockTrack( trk );
+		RenumberSwitchmotorTurnout( trk );
+	}
+	DYNARR_RESET( track_p, journalRenumTrks_da );
+	DYNARR_RESET( journalRenum_t, journalRenum_da );
+}
+
+
+/**
+ * Apply the complete groups of a journal to the tracks just read from the
+ * checkpoint snapshot.  The tracks must not be connected yet (the caller
+ * runs ResolveIndex afterwards) so that replaced tracks can be freed.
+ * An incomplete group at the end, from a crash while it was written, is
+ * ignored.
+ *
+ * \param fileName IN the journal file
+ * \return FALSE if the journal could not be read
+ */
+EXPORT BOOL_T UndoJournalReplay( const char * fileName )
+{
+	FILE * f;
+	long size;
+	char * text, * cp, * line, * group, * groupEnd;
+	int groupCnt = 0;
+
+	f = fopen( fileName, "rb" );
+	if ( f == NULL )
+		return FALSE;
+	fseek( f, 0, SEEK_END );
+	size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	if ( size < 0 ) {
+		fclose( f );
+		return FALSE;
+	}
+	text = (char*)MyMalloc( size+1 );
+	if ( fread( text, 1, size, f ) != (size_t)size ) {
+		fclose( f );
+		MyFree( text );
+		return FALSE;
+	}
+	fclose( f );
+	text[size] = '\0';
+
+	DYNARR_RESET( track_p, journalTrks_da );
+	for ( group=text; strncmp( group, "#JOURNAL ", 9 ) == 0; group=cp ) {
+		groupEnd = strstr( group, "\n#JOURNAL END\n" );
+		if ( groupEnd == NULL )
+			break;
+		groupEnd++;
+		cp = groupEnd + 13;
+		line = strchr( group, '\n' ) + 1;
+		if ( strncmp( line, "#RENUMBER\n", 10 ) == 0 ) {
+			JournalApplyRenumber( group );
+			groupCnt++;
+			continue;
+		}
+		for ( line=group; ; ) {
+			line = strstr( line, "\n#" );
+			if ( line == NULL || line >= groupEnd )
+				break;
+			line++;
+			if ( strncmp( line, "#DELETE ", 8 ) == 0 )
+				JournalRetire( line+8 );
+			else if ( strncmp( line, "#TRACK ", 7 ) == 0 )
+				JournalRetire( line+7 );
+		}
+		*groupEnd = '\0';
+		if ( !ReadTrackText( group, groupEnd-group ) )
+			break;
+		groupCnt++;
+	}
+	MyFree( text );
+LOG( log_undo, 1, ( "UndoJournalReplay: %d groups, %d retired\n", groupCnt, journalTrks_da.cnt ) )
+
+	FreeRetiredTracks();
+	/* tracks created during the session have the highest indices */
+	SortTracksByIndex( &to_first );
+	InfoCount( trackCount );
+	return TRUE;
+}
+
+
+/*****************************************************************************
+ *
+ * UNDO LOG
+ *
+ */
+
+/*
+ * With undoLogEnable set the undo history is also kept in <layout>.undo, next
+ * to the layout file, so it survives closing the layout and crashes.  As in
+ * the journal the records are text, but they hold the tracks as they were
+ * before each command changed them:
+ *
+ *	#GROUP <label>
+ *	#BEFORE <index>
+ *	<the track in layout file format>
+ *	#NEW <index>
+ *	#END
+ *
+ * "#GROUP +" continues the last group.  #UNDO and #REDO move back and forth
+ * over the entries, #RENUMBER lists the old and new index of every track
+ * RenumberTracks changed, and #BREAK drops the history when the log no longer
+ * matches the layout.  #SAVED <size> <time> follows a save of the layout,
+ * #STATE a checkpoint (see JournalGroup) and #CLOSED the end of the session.
+ *
+ * When the layout is loaded the log is mapped and its markers are replayed up
+ * to the #SAVED which matches the layout file, or up to the last #STATE when
+ * the layout was recovered from a checkpoint; the rest is cut off.  Once the
+ * commands in memory are used up, UndoUndo reads the groups from the log one
+ * at a time and puts back the tracks they hold.  They can not be redone.
+ */
+
+typedef struct {
+		long start;			/**< offset of the first record */
+		long end;			/**< offset after the last record */
+		BOOL_T renumber;
+		char label[40];
+		} undoLogEntry_t;
+
+typedef struct {
+		track_p trk;
+		TRKINX_T from;
+		TRKINX_T to;
+		} undoLogRenum_t;
+
+EXPORT long undoLogEnable = 0;		/**< keep the undo log, a preference */
+
+static FILE * undoLogF = NULL;
+static char * undoLogName = NULL;
+static char * undoLogMap = NULL;		/**< the log when the layout was loaded */
+static long undoLogMapSize = 0;
+static long undoLogMapEnd = 0;			/**< the part of the map still in the log */
+static BOOL_T undoLogMapped = FALSE;
+static BOOL_T undoLogInGroup = FALSE;
+static dynArr_t undoLog_da;
+#define undoLog(N) DYNARR_N( undoLogEntry_t, undoLog_da, N )
+static int undoLogPos = 0;			/**< the entries before this one are done */
+static dynArr_t undoLogRenum_da;
+static dynArr_t undoLogSegs_da;
+
+
+static void UndoLogForget( void )
+{
+	int inx;
+	DYNARR_RESET( undoLogEntry_t, undoLog_da );
+	undoLogPos = 0;
+	for ( inx=0; inx<undoStack_da.cnt; inx++ )
+		undoStack(inx).logStart = undoStack(inx).logEnd = -1;
+}
+
+
+static void UndoLogUnmap( void )
+{
+	if ( undoLogMap == NULL )
+		return;
+#ifndef WINDOWS
+	if ( undoLogMapped )
+		munmap( undoLogMap, undoLogMapSize );
+	else
+#endif
+		MyFree( undoLogMap );
+	undoLogMap = NULL;
+	undoLogMapSize = undoLogMapEnd = 0;
+	undoLogMapped = FALSE;
+}
+
+
+/**
+ * Map the log file read only, or read it where it can not be mapped.
+ */
+static void UndoLogMap( void )
+{
+	FILE * f;
+	long size;
+
+	UndoLogUnmap();
+	f = fopen( undoLogName, "rb" );
+	if ( f == NULL )
+		return;
+	fseek( f, 0, SEEK_END );
+	size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	if ( size <= 0 ) {
+		fclose( f );
+		return;
+	}
+#ifndef WINDOWS
+	undoLogMap = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fileno( f ), 0 );
+	if ( undoLogMap == MAP_FAILED )
+		undoLogMap = NULL;
+	else
+		undoLogMapped = TRUE;
+#endif
+	if ( undoLogMap == NULL ) {
+		undoLogMap = (char*)MyMalloc( size );
+		if ( fread( undoLogMap, 1, size, f ) != (size_t)size ) {
+			MyFree( undoLogMap );
+			undoLogMap = NULL;
+		}
+	}
+	fclose( f );
+	if ( undoLogMap != NULL )
+		undoLogMapSize = undoLogMapEnd = size;
+}
+
+
+/**
+ * Give up the log after it could not be written.
+ */
+static void UndoLogDrop( void )
+{
+	if ( undoLogF ) {
+		fclose( undoLogF );
+		undoLogF = NULL;
+	}
+	UndoLogUnmap();
+	if ( undoLogName ) {
+		MyFree( undoLogName );
+		undoLogName = NULL;
+	}
+	undoLogInGroup = FALSE;
+	UndoLogForget();
+}
+
+
+static BOOL_T UndoLogFlush( void )
+{
+	if ( fflush( undoLogF ) != 0 || ferror( undoLogF ) ) {
+		UndoLogDrop();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+static BOOL_T UndoLogMark( const char * marker )
+{
+	if ( undoLogF == NULL )
+		return FALSE;
+	fprintf( undoLogF, "%s\n", marker );
+	return UndoLogFlush();
+}
+
+
+/**
+ * Drop the entries which were undone, before a new one is added.
+ */
+static void UndoLogTruncate( void )
+{
+	int inx;
+	DYNARR_SET( undoLogEntry_t, undoLog_da, undoLogPos );
+	for ( inx=undoHead+1; inx<undoStack_da.cnt; inx++ )
+		undoStack(inx).logStart = undoStack(inx).logEnd = -1;
+}
+
+
+static void UndoLogBreak( void )
+{
+	if ( undoLogF == NULL )
+		return;
+LOG( log_undo, 1, ( "    UndoLogBreak()\n" ) )
+	UndoLogForget();
+	UndoLogMark( "#BREAK" );
+}
+
+
+static void UndoLogGroupStart( undoStack_p us )
+{
+	undoLogEntry_t * e;
+	const char * label;
+	size_t len;
+
+	if ( undoLogInGroup )
+		return;
+	undoLogInGroup = TRUE;
+	if ( us->logEnd >= 0 && us->logEnd == undoLogPos &&
+		 undoLogPos == undoLog_da.cnt && !undoLog(undoLogPos-1).renumber ) {
+		fprintf( undoLogF, "#GROUP +\n" );
+		return;
+	}
+	UndoLogTruncate();
+	if ( us->logStart < 0 )
+		us->logStart = undoLogPos;
+	DYNARR_APPEND( undoLogEntry_t, undoLog_da, 10 );
+	e = &undoLog(undoLogPos);
+	e->start = e->end = ftell( undoLogF );
+	e->renumber = FALSE;
+	label = us->label ? us->label : "";
+	len = strcspn( label, "\n" );
+	if ( len >= sizeof e->label )
+		len = sizeof e->label - 1;
+	memcpy( e->label, label, len );
+	e->label[len] = '\0';
+	undoLogPos++;
+	fprintf( undoLogF, "#GROUP %s\n", e->label );
+}
+
+
+/**
+ * Write trk as it is before the current command changes it.
+ */
+static void UndoLogBefore( track_p trk )
+{
+	char * oldLocale;
+	if ( undoLogF == NULL )
+		return;
+	UndoLogGroupStart( &undoStack(undoHead) );
+	oldLocale = SaveLocale( "C" );
+	fprintf( undoLogF, "#BEFORE %d\n", trk->index );
+	WriteTrack( trk, undoLogF );
+	RestoreLocale( oldLocale );
+}
+
+
+/**
+ * Finish the records of the current command with the tracks it created.
+ */
+static void UndoLogGroupEnd( void )
+{
+	undoStack_p us;
+	track_p trk;
+
+	if ( undoLogF == NULL || undoHead < 0 )
+		return;
+	us = &undoStack(undoHead);
+	if ( !undoLogInGroup ) {
+		if ( us->newTrks == NULL || us->newCnt == us->logNewCnt )
+			return;
+		UndoLogGroupStart( us );
+	}
+	for ( trk=us->newTrks; trk; trk=trk->next )
+		fprintf( undoLogF, "#NEW %d\n", trk->index );
+	fprintf( undoLogF, "#END\n" );
+	undoLogInGroup = FALSE;
+	if ( !UndoLogFlush() || undoLogPos == 0 )
+		return;
+	undoLog(undoLogPos-1).end = ftell( undoLogF );
+	us->logEnd = undoLogPos;
+	us->logNewCnt = us->newCnt;
+}
+
+
+static void UndoLogState( void )
+{
+	UndoLogGroupEnd();
+	UndoLogMark( "#STATE" );
+}
+
+
+/**
+ * Note that RenumberTracks gives trk a new index.
+ */
+EXPORT void UndoLogRenumber( track_p trk, TRKINX_T index )
+{
+	if ( undoLogF == NULL || trk->index == index )
+		return;
+	/* the new tracks are listed by their old index */
+	if ( undoLogRenum_da.cnt == 0 )
+		UndoLogGroupEnd();
+	DYNARR_APPEND( undoLogRenum_t, undoLogRenum_da, 100 );
+	DYNARR_LAST( undoLogRenum_t, undoLogRenum_da ).from = trk->index;
+	DYNARR_LAST( undoLogRenum_t, undoLogRenum_da ).to = index;
+}
+
+
+/**
+ * Write the indices changed by RenumberTracks.
+ */
+EXPORT void UndoLogRenumberDone( void )
+{
+	undoLogEntry_t * e;
+	undoLogRenum_t * r;
+	int inx;
+
+	if ( undoLogF != NULL && undoLogRenum_da.cnt > 0 ) {
+		UndoLogTruncate();
+		DYNARR_APPEND( undoLogEntry_t, undoLog_da, 10 );
+		e = &undoLog(undoLogPos);
+		e->start = ftell( undoLogF );
+		e->renumber = TRUE;
+		e->label[0] = '\0';
+		fprintf( undoLogF, "#RENUMBER\n" );
+		for ( inx=0; inx<undoLogRenum_da.cnt; inx++ ) {
+			r = &DYNARR_N( undoLogRenum_t, undoLogRenum_da, inx );
+			fprintf( undoLogF, "%d %d\n", r->from, r->to );
+		}
+		fprintf( undoLogF, "#END\n" );
+		e->end = ftell( undoLogF );
+		undoLogPos++;
+		UndoLogFlush();
+	}
+	DYNARR_RESET( undoLogRenum_t, undoLogRenum_da );
+}
+
+
+/**
+ * \return a copy of the records of an entry, to be freed by the caller
+ */
+static char * UndoLogText( undoLogEntry_t * e )
+{
+	long size = e->end - e->start;
+	char * text = (char*)MyMalloc( size+1 );
+	BOOL_T ok;
+
+	if ( e->end <= undoLogMapEnd ) {
+		memcpy( text, undoLogMap+e->start, size );
+	} else {
+		ok = fflush( undoLogF ) == 0 &&
+			 fseek( undoLogF, e->start, SEEK_SET ) == 0 &&
+			 fread( text, 1, size, undoLogF ) == (size_t)size;
+		fseek( undoLogF, 0, SEEK_END );
+		if ( !ok ) {
+			MyFree( text );
+			return NULL;
+		}
+	}
+	text[size] = '\0';
+	return text;
+}
+
+
+/**
+ * Give the tracks the indices they had before (back) or after a renumbering.
+ */
+static BOOL_T UndoLogApplyRenumber( undoLogEntry_t * e, BOOL_T back )
+{
+	char * text, * cp, * cp1;
+	long from, to;
+	track_p trk;
+	int inx;
+
+	if ( (text = UndoLogText( e )) == NULL )
+		return FALSE;
+	DYNARR_RESET( undoLogRenum_t, undoLogRenum_da );
+	for ( cp=strchr( text, '\n' ); cp && cp[1] != '#' && cp[1] != '\0'; cp=strchr( cp, '\n' ) ) {
+		from = strtol( cp+1, &cp1, 10 );
+		to = strtol( cp1, &cp, 10 );
+		if ( back ) {
+			long tmp = from;
+			from = to;
+			to = tmp;
+		}
+		/* all tracks are looked up before any is changed */
+		if ( (trk = FindTrack( (TRKINX_T)from )) == NULL )
+			continue;
+		DYNARR_APPEND( undoLogRenum_t, undoLogRenum_da, 100 );
+		DYNARR_LAST( undoLogRenum_t, undoLogRenum_da ).trk = trk;
+		DYNARR_LAST( undoLogRenum_t, undoLogRenum_da ).to = (TRKINX_T)to;
+	}
+	for ( inx=0; inx<undoLogRenum_da.cnt; inx++ )
+		ReindexTrack( DYNARR_N( undoLogRenum_t, undoLogRenum_da, inx ).trk,
+					  DYNARR_N( undoLogRenum_t, undoLogRenum_da, inx ).to );
+	DYNARR_RESET( undoLogRenum_t, undoLogRenum_da );
+	MyFree( text );
+	return TRUE;
+}
+
+
+/**
+ * Move over one entry of the log.
+ */
+static BOOL_T UndoLogStep( BOOL_T back )
+{
+	undoLogEntry_t * e = &undoLog( back ? undoLogPos-1 : undoLogPos );
+	if ( e->renumber && !UndoLogApplyRenumber( e, back ) ) {
+		UndoLogBreak();
+		return FALSE;
+	}
+	undoLogPos += back ? -1 : 1;
+	return UndoLogMark( back ? "#UNDO" : "#REDO" );
+}
+
+
+/**
+ * \return the group in the log UndoUndo would read, or NULL
+ */
+static undoLogEntry_t * UndoLogPrev( void )
+{
+	int inx;
+	if ( undoLogF == NULL )
+		return NULL;
+	for ( inx=undoLogPos-1; inx>=0; inx-- )
+		if ( !undoLog(inx).renumber )
+			return &undoLog(inx);
+	return NULL;
+}
+
+
+/**
+ * Move the log back before us, which is about to be undone in memory.
+ */
+static void UndoLogUndone( undoStack_p us )
+{
+	if ( undoLogF == NULL )
+		return;
+	UndoLogGroupEnd();
+	if ( us->modCnt == 0 && us->delCnt == 0 && us->newCnt == 0 )
+		return;
+	if ( us->logStart < 0 ) {
+		UndoLogBreak();
+		return;
+	}
+	while ( undoLogF && undoLogPos > us->logEnd && undoLog(undoLogPos-1).renumber )
+		UndoLogStep( TRUE );
+	if ( undoLogF == NULL )
+		return;
+	if ( undoLogPos != us->logEnd ) {
+		UndoLogBreak();
+		return;
+	}
+	while ( undoLogF && undoLogPos > us->logStart )
+		UndoLogStep( TRUE );
+}
+
+
+/**
+ * Move the log forward over us, which is about to be redone in memory.
+ */
+static void UndoLogRedone( undoStack_p us )
+{
+	if ( undoLogF == NULL )
+		return;
+	UndoLogGroupEnd();
+	if ( us->modCnt == 0 && us->delCnt == 0 && us->newCnt == 0 )
+		return;
+	if ( us->logStart < 0 ) {
+		UndoLogBreak();
+		return;
+	}
+	while ( undoLogF && undoLogPos < us->logStart && undoLogPos < undoLog_da.cnt &&
+			undoLog(undoLogPos).renumber )
+		UndoLogStep( FALSE );
+	if ( undoLogF == NULL )
+		return;
+	if ( undoLogPos != us->logStart || us->logEnd > undoLog_da.cnt ) {
+		UndoLogBreak();
+		return;
+	}
+	while ( undoLogF && undoLogPos < us->logEnd )
+		UndoLogStep( FALSE );
+}
+
+
+/**
+ * Connect the tracks just read from the log, and the end points listed by
+ * FreeRetiredTracks.
+ *
+ * \param first IN the first track read
+ */
+static void ConnectRetiredLinks( track_p first )
+{
+	journalLink_t * link;
+	track_p trk;
+	EPINX_T ep;
+	int inx;
+
+	for ( inx=0; inx<journalLinks_da.cnt; inx++ ) {
+		link = &DYNARR_N( journalLink_t, journalLinks_da, inx );
+		trk = link->trk;
+		trk->endPt[link->ep].track = FindTrack( trk->endPt[link->ep].index );
+		GridUpdateEndPts( trk );
+	}
+	DYNARR_RESET( journalLink_t, journalLinks_da );
+	for ( trk=first; trk; trk=trk->next ) {
+		for ( ep=0; ep<trk->endCnt; ep++ )
+			if ( trk->endPt[ep].index >= 0 && trk->endPt[ep].track == NULL )
+				trk->endPt[ep].track = FindTrack( trk->endPt[ep].index );
+		GridUpdateEndPts( trk );
+	}
+}
+
+
+/**
+ * Undo the group before undoLogPos, once the commands in memory are used up.
+ * The tracks the group created or changed are replaced by the ones it holds,
+ * a segment (see "#GROUP +") at a time, last first.
+ */
+static BOOL_T UndoLogUndo( void )
+{
+	undoLogEntry_t * e;
+	char * text, * cp, * line, * end;
+	char * oldLocale;
+	long oldVersion = paramVersion;
+	track_p trk, * tail;
+	BOOL_T ok = TRUE;
+	int inx;
+
+	ConfirmReset( FALSE );
+	wDrawDelayUpdate( mainD.d, TRUE );
+	/* the log refers to every track */
+	LoadHiddenLayers( TRUE );
+	/* what was undone in memory can not be redone after this */
+	FreeUndoneTracks( undoHead+1 );
+	UndoClear();
+	UndoFreeGraveyard();
+	while ( undoLogF && undoLogPos > 0 && undoLog(undoLogPos-1).renumber )
+		UndoLogStep( TRUE );
+	e = UndoLogPrev();
+	text = e ? UndoLogText( e ) : NULL;
+	if ( text == NULL ) {
+		UndoLogBreak();
+		SetButtons( FALSE, FALSE );
+		wDrawDelayUpdate( mainD.d, FALSE );
+		ErrorMessage( MSG_NO_UNDO );
+		return FALSE;
+	}
+LOG( log_undo, 1, ( "    UndoLogUndo[%d] %s\n", undoLogPos, e->label ) )
+
+	DYNARR_RESET( char *, undoLogSegs_da );
+	for ( cp=text; cp; cp=strstr( cp, "\n#GROUP " ) ) {
+		if ( cp != text )
+			cp++;
+		DYNARR_APPEND( char *, undoLogSegs_da, 10 );
+		DYNARR_LAST( char *, undoLogSegs_da ) = cp;
+		cp = strchr( cp, '\n' );
+	}
+	oldLocale = SaveLocale( "C" );
+	paramVersion = iParamVersion;
+	end = text + strlen( text );
+	for ( inx=undoLogSegs_da.cnt-1; ok && inx>=0; inx-- ) {
+		cp = DYNARR_N( char *, undoLogSegs_da, inx );
+		*end = '\0';
+		DYNARR_RESET( track_p, journalTrks_da );
+		for ( line=cp; (line=strstr( line, "\n#" )) != NULL; ) {
+			line++;
+			if ( strncmp( line, "#NEW ", 5 ) == 0 )
+				JournalRetire( line+5 );
+			else if ( strncmp( line, "#BEFORE ", 8 ) == 0 )
+				JournalRetire( line+8 );
+		}
+		FreeRetiredTracks();
+		tail = to_last;
+		ok = ReadTrackText( cp, end-cp );
+		ConnectRetiredLinks( *tail );
+		end = cp;
+	}
+	paramVersion = oldVersion;
+	RestoreLocale( oldLocale );
+	MyFree( text );
+
+	TRK_ITERATE( trk ) {
+		ResolveBlockTrack( trk );
+		ResolveSwitchmotorTurnout( trk );
+	}
+	SortTracksByIndex( &to_first );
+	AttachTrains();
+	UpdateAllElevations();
+	if ( ok )
+		UndoLogStep( TRUE );
+	else
+		UndoLogBreak();
+	DoRedraw();
+	InfoCount( trackCount );
+	changed++;
+	SetWindowTitle();
+	AuditTracks( "undoLogUndo" );
+	SelectRecount();
+	SetButtons( UndoLogPrev() != NULL, FALSE );
+	wBalloonHelpUpdate();
+	wDrawDelayUpdate( mainD.d, FALSE );
+	return ok;
+}
+
+
+/**
+ * Replay the markers of the mapped log up to offset stop.
+ *
+ * \param stop IN where to stop
+ * \param anchor IN the marker to look for
+ * \return the offset after the last anchor, or -1
+ */
+static long UndoLogScan( long stop, const char * anchor )
+{
+	char * cp, * next, * end = undoLogMap + stop;
+	long found = -1;
+	long groupStart = -1;
+	BOOL_T more = FALSE;
+	size_t anchorLen = strlen( anchor );
+	size_t len;
+	undoLogEntry_t * e;
+
+	UndoLogForget();
+	for ( cp=undoLogMap; cp && cp<end; cp=next ) {
+		next = memchr( cp, '\n', end-cp );
+		if ( next == NULL )
+			break;
+		next++;
+		if ( *cp != '#' )
+			continue;
+		if ( strncmp( cp, "#GROUP +\n", 9 ) == 0 ) {
+			groupStart = cp - undoLogMap;
+			more = TRUE;
+		} else if ( strncmp( cp, "#GROUP ", 7 ) == 0 || strncmp( cp, "#RENUMBER\n", 10 ) == 0 ) {
+			groupStart = cp - undoLogMap;
+			more = FALSE;
+		} else if ( strncmp( cp, "#END\n", 5 ) == 0 ) {
+			if ( groupStart < 0 )
+				continue;
+			if ( more ) {
+				if ( undoLogPos > 0 && undoLogPos == undoLog_da.cnt )
+					undoLog(undoLogPos-1).end = next - undoLogMap;
+			} else {
+				DYNARR_SET( undoLogEntry_t, undoLog_da, undoLogPos+1 );
+				e = &undoLog(undoLogPos++);
+				e->start = groupStart;
+				e->end = next - undoLogMap;
+				e->renumber = ( undoLogMap[groupStart+1] == 'R' );
+				e->label[0] = '\0';
+				if ( !e->renumber ) {
+					len = strcspn( undoLogMap+groupStart+7, "\n" );
+					if ( len >= sizeof e->label )
+						len = sizeof e->label - 1;
+					memcpy( e->label, undoLogMap+groupStart+7, len );
+					e->label[len] = '\0';
+				}
+			}
+			groupStart = -1;
+		} else if ( strncmp( cp, "#UNDO\n", 6 ) == 0 ) {
+			if ( undoLogPos > 0 )
+				undoLogPos--;
+		} else if ( strncmp( cp, "#REDO\n", 6 ) == 0 ) {
+			if ( undoLogPos < undoLog_da.cnt )
+				undoLogPos++;
+		} else if ( strncmp( cp, "#BREAK\n", 7 ) == 0 ) {
+			UndoLogForget();
+		} else if ( strncmp( cp, "#CLOSED\n", 8 ) == 0 ) {
+			/* a checkpoint of this session is not the one being recovered */
+			if ( strcmp( anchor, "#STATE" ) == 0 )
+				found = -1;
+		} else if ( (size_t)(next-cp) == anchorLen+1 && strncmp( cp, anchor, anchorLen ) == 0 ) {
+			found = next - undoLogMap;
+		}
+	}
+	/* the undone entries can not be redone after loading */
+	DYNARR_SET( undoLogEntry_t, undoLog_da, undoLogPos );
+	return found;
+}
+
+
+/**
+ * Start keeping the undo history of a layout which was just loaded, with the
+ * history left in its log.
+ *
+ * \param fileName IN the layout file
+ * \param recovered IN the layout was recovered from a checkpoint
+ */
+EXPORT void UndoLogOpen( const char * fileName, BOOL_T recovered )
+{
+	struct stat st;
+	char anchor[80];
+	long anchorOff = -1;
+
+	UndoLogClose();
+	if ( !undoLogEnable || fileName == NULL || fileName[0] == '\0' )
+		return;
+	if ( recovered )
+		strcpy( anchor, "#STATE" );
+	else if ( stat( fileName, &st ) == 0 )
+		sprintf( anchor, "#SAVED %ld %ld", (long)st.st_size, (long)st.st_mtime );
+	else
+		return;
+	undoLogName = (char*)MyMalloc( strlen( fileName )+6 );
+	sprintf( undoLogName, "%s.undo", fileName );
+
+	UndoLogMap();
+	if ( undoLogMap != NULL )
+		anchorOff = UndoLogScan( undoLogMapSize, anchor );
+	if ( anchorOff >= 0 ) {
+		UndoLogScan( anchorOff, anchor );
+		undoLogMapEnd = anchorOff;
+		undoLogF = fopen( undoLogName, "r+b" );
+		if ( undoLogF != NULL ) {
+#ifdef WINDOWS
+			_chsize( _fileno( undoLogF ), anchorOff );
+#else
+			if ( ftruncate( fileno( undoLogF ), anchorOff ) != 0 )
+				UndoLogForget();
+#endif
+			fseek( undoLogF, 0, SEEK_END );
+		}
+	} else {
+		UndoLogUnmap();
+		UndoLogForget();
+		undoLogF = fopen( undoLogName, "w+b" );
+		if ( undoLogF != NULL ) {
+			fprintf( undoLogF, "# %s undo log\n", sProdName );
+			UndoLogMark( anchor );
+		}
+	}
+	if ( undoLogF == NULL ) {
+		UndoLogDrop();
+		return;
+	}
+LOG( log_undo, 1, ( "UndoLogOpen( %s ): %d groups\n", undoLogName, undoLogPos ) )
+	SetButtons( UndoLogPrev() != NULL, FALSE );
+}
+
+
+/**
+ * Stop keeping the undo history, when the layout is closed.
+ */
+EXPORT void UndoLogClose( void )
+{
+	if ( undoLogF == NULL )
+		return;
+	UndoLogGroupEnd();
+	UndoLogMark( "#CLOSED" );
+	UndoLogDrop();
+}
+
+
+/**
+ * Note that the layout was saved.  The history moves along to the log of a
+ * new file name, without the commands in memory.
+ *
+ * \param fileName IN the layout file
+ */
+EXPORT void UndoLogSaved( const char * fileName )
+{
+	struct stat st;
+	char marker[80];
+	char * name;
+
+	if ( !undoLogEnable ) {
+		UndoLogClose();
+		return;
+	}
+	name = (char*)MyMalloc( strlen( fileName )+6 );
+	sprintf( name, "%s.undo", fileName );
+	if ( undoLogF == NULL || strcmp( name, undoLogName ) != 0 ) {
+		MyFree( name );
+		UndoLogOpen( fileName, FALSE );
+		return;
+	}
+	MyFree( name );
+	UndoLogGroupEnd();
+	if ( stat( fileName, &st ) == 0 ) {
+		sprintf( marker, "#SAVED %ld %ld", (long)st.st_size, (long)st.st_mtime );
+		UndoLogMark( marker );
+	}
+}
+
+
+static void SetButtons( BOOL_T undoSetting, BOOL_T redoSetting )
+{
+	static BOOL_T undoButtonEnabled = FALSE;
+	static BOOL_T redoButtonEnabled = FALSE;
+	static char undoHelp[STR_SHORT_SIZE];
+	static char redoHelp[STR_SHORT_SIZE];
+
+	if (undoButtonEnabled != undoSetting) {
+		wControlActive( (wControl_p)undoB, undoSetting );
+		undoButtonEnabled = undoSetting;
+	}
+	if (redoButtonEnabled != redoSetting) {
+		wControlActive( (wControl_p)redoB, redoSetting );
+		redoButtonEnabled = redoSetting;
+	}
+	if (undoSetting) {
+		sprintf( undoHelp, _("Undo: %s"), doCount > 0 ? undoStack(undoHead).label : UndoLogPrev()->label );
 		wControlSetBalloonText( (wControl_p)undoB, undoHelp );
 	} else {
 		wControlSetBalloonText( (wControl_p)undoB, _("Undo last command") );
 	}
 	if (redoSetting) {
-		index = undoHead;
-		INC_UNDO_INX(index);
-		sprintf( redoHelp, _("Redo: %s"), undoStack[index].label );
+		sprintf( redoHelp, _("Redo: %s"), undoStack(undoHead+1).label );
 		wControlSetBalloonText( (wControl_p)redoB, redoHelp );
 	} else {
 		wControlSetBalloonText( (wControl_p)redoB, _("Redo last undo") );
@@ -573,10 +2363,9 @@ void UndoStart(
 {
 	static char buff[STR_SIZE];
 	va_list ap;
-	track_p trk, next;
-	undoStack_p us, us1;
+	track_p trk;
+	undoStack_p us;
 	int inx;
-	int usp;
 
 LOG( log_undo, 1, ( "UndoStart(%s) [%d] d:%d u:%d us:%ld\n", label, undoHead, doCount, undoCount, undoStream.end ) )
 	if (recordUndo) {
@@ -587,7 +2376,7 @@ LOG( log_undo, 1, ( "UndoStart(%s) [%d] d:%d u:%d us:%ld\n", label, undoHead, do
 	}
 
 	if ( undoHead >= 0 ) {
-		us = &undoStack[undoHead];
+		us = &undoStack(undoHead);
 		if ( us->modCnt == 0 && us->delCnt == 0 && us->newCnt == 0 ) {
 #ifndef WINDOWS
 #ifdef DEBUG
@@ -601,13 +2390,28 @@ LOG( log_undo, 1, ( "UndoStart(%s) [%d] d:%d u:%d us:%ld\n", label, undoHead, do
 		}
 	}
 
-	INC_UNDO_INX(undoHead);
-	us = &undoStack[undoHead];
+	UndoLogGroupEnd();
+	ClearXformRecs();
+	undoHead++;
+	if ( undoHead >= undoStack_da.cnt )
+		DYNARR_APPEND( undoStack_t, undoStack_da, 10 );
+	us = &undoStack(undoHead);
 	changed++;
 	SetWindowTitle();
-	if (doCount == UNDO_STACK_SIZE) {
-		if (recordUndo) Rprintf( "  Wrapped N:%d M:%d D:%d\n", us->newCnt, us->modCnt, us->delCnt );
-		/* wrapped around stack */
+	if (undoCount != 0) {
+		if (recordUndo) Rprintf( "  Undid N:%d M:%d D:%d\n", us->newCnt, us->modCnt, us->delCnt );
+		/* reusing an undid entry */
+		/* really delete all new tracks since this point */
+		FreeUndoneTracks( undoHead );
+		/* strip off unused tail of stream */
+		if (!TruncateStream( &undoStream, us->undoStart ))
+			return;
+	}
+	DYNARR_SET( undoStack_t, undoStack_da, undoHead+1 );
+	/* drop the oldest entries while over budget, but keep the last command */
+	while ( doCount > 1 && streamMemory > undoMemory*1024*1024 ) {
+		us = &undoStack(0);
+		if (recordUndo) Rprintf( "  Dropped N:%d M:%d D:%d\n", us->newCnt, us->modCnt, us->delCnt );
 		/* if track saved in undoStream is deleted then really deleted since
 		   we can't get it back */
 		if (!DeleteInStream( &undoStream, us->undoStart, us->undoEnd ))
@@ -615,46 +2419,37 @@ LOG( log_undo, 1, ( "UndoStart(%s) [%d] d:%d u:%d us:%ld\n", label, undoHead, do
 		/* strip off unused head of stream */
 		if (!TrimStream( &undoStream, us->undoEnd ))
 			return;
-	} else if (undoCount != 0) {
-		if (recordUndo) Rprintf( "  Undid N:%d M:%d D:%d\n", us->newCnt, us->modCnt, us->delCnt );
-		/* reusing an undid entry */
-		/* really delete all new tracks since this point */
-		for( inx=0,usp = undoHead; inx<undoCount; inx++ ) {
-			us1 = &undoStack[usp];
-			if (recordUndo) Rprintf("  U[%d] N:%d\n", usp, us1->newCnt );
-			for (trk=us1->newTrks; trk; trk=next) {
-				if (recordUndo) Rprintf( "    Free T%d @ %lx\n", trk->index, (long)trk );
-				/*ASSERT( IsTrackDeleted(trk) );*/
-				next = trk->next;
-				FreeTrack( trk );
-			}
-			INC_UNDO_INX(usp);
-		}
-		/* strip off unused tail of stream */
-		if (!TruncateStream( &undoStream, us->undoStart ))
-			return;
+		memmove( &undoStack(0), &undoStack(1), undoHead * sizeof *us );
+		undoStack_da.cnt--;
+		undoHead--;
+		doCount--;
 	}
+	/* keep the last command expanded, it is the most likely to be undone */
+	if ( undoHead > 0 )
+		CompressStream( &undoStream, undoStack(undoHead-1).undoStart );
+	us = &undoStack(undoHead);
 	us->label = label;
 	us->modCnt = 0;
 	us->newCnt = 0;
 	us->delCnt = 0;
 	us->undoStart = us->undoEnd = undoStream.end;
 	ClearStream( &redoStream );
-	for ( inx=0; inx<UNDO_STACK_SIZE; inx++ ) {
-		undoStack[inx].needRedo = TRUE;
-		undoStack[inx].oldTail = NULL;
-		undoStack[inx].newTail = NULL;
+	for ( inx=0; inx<undoStack_da.cnt; inx++ ) {
+		undoStack(inx).needRedo = TRUE;
+		undoStack(inx).oldTail = NULL;
+		undoStack(inx).newTail = NULL;
 	}
 	us->newTrks = NULL;
-	undoStack[undoHead].trackCount = trackCount;
+	us->logStart = us->logEnd = -1;
+	us->logNewCnt = 0;
+	us->trackCount = trackCount;
 	undoCount = 0;
 	undoActive = TRUE;
 	for (trk=to_first; trk; trk=trk->next ) {
 		trk->modified = FALSE;
 		trk->new = FALSE;
 	}
-	if (doCount < UNDO_STACK_SIZE)
-		doCount++;
+	doCount++;
 	SetButtons( TRUE, FALSE );
 }
 
@@ -662,20 +2457,28 @@ LOG( log_undo, 1, ( "UndoStart(%s) [%d] d:%d u:%d us:%ld\n", label, undoHead, do
 BOOL_T UndoModify( track_p trk )
 {
 	undoStack_p us;
+	xformRec_t * rec;
 
 	if ( !undoActive ) return TRUE;
 	if (trk == NULL) return TRUE;
 	UASSERT(undoCount==0, undoCount);
 	UASSERT(undoHead >= 0, undoHead);
 	UASSERT(!IsTrackDeleted(trk), (long)trk);
-	if (trk->modified || trk->new)
+	if (trk->modified) {
+		rec = FindXformRec( trk, FALSE );
+		if ( rec != NULL && rec->off >= 0 )
+			return PromoteXform( rec );
+		return TRUE;
+	}
+	if (trk->new)
 		return TRUE;
 LOG( log_undo, 2, ( "    UndoModify( T%d, E%d, X%ld )\n", trk->index, trk->endCnt, trk->extraSize ) )
 	if ( (GetTrkBits(trk)&TB_CARATTACHED)!=0 )
 		needAttachTrains = TRUE;
-	us = &undoStack[undoHead];
+	us = &undoStack(undoHead);
 	if (recordUndo)
 		Rprintf( " MOD T%d @ %lx\n", trk->index, (long)trk );
+	UndoLogBefore( trk );
 	if (!WriteObject( &undoStream, ModifyOp, trk ))
 		return FALSE;
 	us->undoEnd = undoStream.end;
@@ -685,6 +2488,42 @@ LOG( log_undo, 2, ( "    UndoModify( T%d, E%d, X%ld )\n", trk->index, trk->endCn
 }
 
 
+/**
+ * Record cnt tracks before each is moved, rotated or flipped.  Only the values
+ * those change are kept, see TRANSFORMS.
+ */
+BOOL_T UndoMoveTracks( int cnt, track_p * trks )
+{
+	return RecordXforms( cnt, trks, TRUE );
+}
+
+
+/**
+ * Record cnt tracks before a change which leaves the data StoreTrackData
+ * keeps alone, such as their layer, flags, width, scale or elevations.
+ */
+BOOL_T UndoChangeTracks( int cnt, track_p * trks )
+{
+	return RecordXforms( cnt, trks, FALSE );
+}
+
+
+/**
+ * Record trk before only its end points change, as ConnectTracks does.  An
+ * XformOp already recorded for trk covers them.
+ */
+BOOL_T UndoConnect( track_p trk )
+{
+	xformRec_t * rec;
+	if ( undoActive && trk != NULL && trk->modified ) {
+		rec = FindXformRec( trk, FALSE );
+		if ( rec != NULL && rec->off >= 0 )
+			return TRUE;
+	}
+	return UndoModify( trk );
+}
+
+
 BOOL_T UndoDelete( track_p trk )
 {
 	undoStack_p us;
@@ -692,7 +2531,7 @@ BOOL_T UndoDelete( track_p trk )
 LOG( log_undo, 2, ( "    UndoDelete( T%d, E%d, X%ld )\n", trk->index, trk->endCnt, trk->extraSize ) )
 	if ( (GetTrkBits(trk)&TB_CARATTACHED)!=0 )
 		needAttachTrains = TRUE;
-	us = &undoStack[undoHead];
+	us = &undoStack(undoHead);
 	if (recordUndo)
 		Rprintf( " DEL T%d @ %lx\n", trk->index, (long)trk );
 	UASSERT( !IsTrackDeleted(trk), (long)trk );
@@ -700,6 +2539,7 @@ LOG( log_undo, 2, ( "    UndoDelete( T%d, E%d, X%ld )\n", trk->index, trk->endCn
 		if (!SetDeleteOpInStream( &undoStream, us->undoStart, us->undoEnd, trk ))
 			return FALSE;
 	} else if ( !trk->new ) {
+		UndoLogBefore( trk );
 		if (!WriteObject( &undoStream, DeleteOp, trk ))
 			 return FALSE;
 		us->undoEnd = undoStream.end;
@@ -719,6 +2559,7 @@ LOG( log_undo, 2, ( "    UndoDelete( T%d, E%d, X%ld )\n", trk->index, trk->endCn
 		return TRUE;
 	}
 	trk->deleted = TRUE;
+	HotUpdateTrack( trk );
 	us->delCnt++;
 	return TRUE;
 }
@@ -736,7 +2577,7 @@ LOG( log_undo, 2, ( "    UndoNew( T%d )\n", trk->index ) )
 		Rprintf( " NEW T%d @%lx\n", trk->index, (long)trk );
 	UASSERT(undoCount==0, undoCount);
 	UASSERT(undoHead >= 0, undoHead);
-	us = &undoStack[undoHead];
+	us = &undoStack(undoHead);
 	trk->new = TRUE;
 	if (us->newTrks == NULL)
 		us->newTrks = trk;
@@ -750,27 +2591,79 @@ void UndoEnd( void )
 {
 	if (recordUndo) Rprintf( "End[%d] d:%d\n", undoHead, doCount );
 	/*undoActive = FALSE;*/
+	if ( undoHead >= 0 && undoStack(undoHead).delCnt > 0 )
+		BuryDeletedTracks();
 	if ( needAttachTrains ) {
 		AttachTrains();
 		needAttachTrains = FALSE;
 	}
 	UpdateAllElevations();
+	UndoLogGroupEnd();
+	if ( undoHead >= 0 )
+		JournalGroup( &undoStack(undoHead) );
 }
 
 
-void UndoClear( void )
+/*
+ * Tracks read by LoadHiddenLayers were in the layout all along and belong to
+ * no command.  Undo is off while they are read, and UndoLoadEnd moves them to
+ * the front of the track list, ahead of the tracks the commands created, so
+ * undoing a command does not take them with it.
+ */
+static BOOL_T undoLoadActive = FALSE;
+
+EXPORT void UndoLoadStart( void )
+{
+	undoLoadActive = undoActive;
+	undoActive = FALSE;
+}
+
+
+/**
+ * Move the tracks read since UndoLoadStart to the front of the track list
+ * and count them in every command.  The caller renumbers the tracks.
+ *
+ * \param start IN the slot which held the end of the track list when loading started
+ * \param cnt IN the number of tracks read
+ */
+EXPORT void UndoLoadEnd( track_p * start, wIndex_t cnt )
 {
+	track_p * tail = to_last;
 	int inx;
+
+	undoActive = undoLoadActive;
+	if ( *start == NULL )
+		return;
+	if ( start != &to_first ) {
+		*tail = to_first;
+		to_first = *start;
+		*start = NULL;
+		to_last = start;
+	}
+	/* a command undone on an empty layout put its tracks back at to_first */
+	for ( inx=0; inx<undoStack_da.cnt; inx++ ) {
+		if ( undoStack(inx).oldTail == &to_first )
+			undoStack(inx).oldTail = tail;
+		if ( undoStack(inx).newTail == &to_first )
+			undoStack(inx).newTail = tail;
+		undoStack(inx).trackCount += cnt;
+	}
+}
+
+
+void UndoClear( void )
+{
 LOG( log_undo, 2, ( "    UndoClear()\n" ) )
+	UndoLogGroupEnd();
 	undoActive = FALSE;
+	UndoJournalBreak();
 	undoHead = -1;
 	undoCount = 0;
 	doCount = 0;
 	ClearStream( &undoStream );
 	ClearStream( &redoStream );
-	for (inx=0; inx<UNDO_STACK_SIZE; inx++) {
-		undoStack[inx].undoStart = undoStack[inx].undoEnd = 0;
-	}
+	DYNARR_RESET( undoStack_t, undoStack_da );
+	ClearXformRecs();
 	SetButtons( FALSE, FALSE );
 }
 
@@ -783,13 +2676,15 @@ BOOL_T UndoUndo( void )
 	BOOL_T redrawAll;
 
 	if (doCount <= 0) {
+		if ( UndoLogPrev() != NULL )
+			return UndoLogUndo();
 		ErrorMessage( MSG_NO_UNDO );
 		return FALSE;
 	}
 
 	ConfirmReset( FALSE );
 	wDrawDelayUpdate( mainD.d, TRUE );
-	us = &undoStack[undoHead];
+	us = &undoStack(undoHead);
 LOG( log_undo, 1, ( "    undoUndo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doCount, undoCount, us->newCnt, us->modCnt, us->delCnt ) )
 	if (recordUndo) Rprintf( "Undo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doCount, undoCount, us->newCnt, us->modCnt, us->delCnt );
 
@@ -807,6 +2702,7 @@ LOG( log_undo, 1, ( "    undoUndo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 		if (recordUndo) Rprintf(" Deleting New Track T%d @ %lx\n", trk->index, (long)trk );
 		UASSERT( !IsTrackDeleted(trk), (long)trk );
 		trk->deleted = TRUE;
+		HotUpdateTrack( trk );
 	}
 	if (!(us->oldTail=FindParent(us->newTrks,__LINE__)))
 		return FALSE; 
@@ -814,12 +2710,16 @@ LOG( log_undo, 1, ( "    undoUndo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 	to_last = us->oldTail;
 	*to_last = NULL;
 
+	/* before the tracks are restored, they may take back their old indices */
+	UndoLogUndone( us );
 	needAttachTrains = FALSE;
 	undoStream.curr = us->undoStart;
 	while ( undoStream.curr < us->undoEnd ) {
 		if (!ReadObject( &undoStream, us->needRedo ))
 			return FALSE;
 	}
+	if (us->delCnt)
+		ResurrectTracks();
 	if (us->needRedo)
 		us->redoEnd = redoStream.end;
 	us->needRedo = FALSE;
@@ -829,6 +2729,7 @@ LOG( log_undo, 1, ( "    undoUndo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 		needAttachTrains = FALSE;
 	}
 	UpdateAllElevations();
+	JournalGroup( us );
 	if (!redrawAll)
 		RedrawInStream( &undoStream, us->undoStart, us->undoEnd, TRUE );
 	else
@@ -841,10 +2742,10 @@ LOG( log_undo, 1, ( "    undoUndo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 
 	doCount--;
 	undoCount++;
-	DEC_UNDO_INX( undoHead );
+	undoHead--;
 	AuditTracks( "undoUndo" );
 	SelectRecount();
-	SetButtons( doCount>0, TRUE );
+	SetButtons( doCount>0 || UndoLogPrev() != NULL, TRUE );
 	wBalloonHelpUpdate();
 	wDrawDelayUpdate( mainD.d, FALSE );
 	return TRUE;
@@ -865,10 +2766,11 @@ BOOL_T UndoRedo( void )
 
 	ConfirmReset( FALSE );
 	wDrawDelayUpdate( mainD.d, TRUE );
-	INC_UNDO_INX( undoHead );
-	us = &undoStack[undoHead];
+	undoHead++;
+	us = &undoStack(undoHead);
 LOG( log_undo, 1, ( "    undoRedo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doCount, undoCount, us->newCnt, us->modCnt, us->delCnt ) )
 	if (recordUndo) Rprintf( "Redo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doCount, undoCount, us->newCnt, us->modCnt, us->delCnt );
+	UndoLogRedone( us );
 
 	//redrawAll = (us->newCnt+us->modCnt) > incrementalDrawLimit;
     redrawAll = TRUE;
@@ -880,6 +2782,7 @@ LOG( log_undo, 1, ( "    undoRedo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 		if (recordUndo) Rprintf(" Undeleting New Track T%d @ %lx\n", trk->index, (long)trk );
 		UASSERT( IsTrackDeleted(trk), (long)trk );
 		trk->deleted = FALSE;
+		HotUpdateTrack( trk );
 	}
 	UASSERT( us->newTail != NULL, (long)us->newTail );
 	*to_last = us->newTrks;
@@ -893,6 +2796,8 @@ LOG( log_undo, 1, ( "    undoRedo[%d] d:%d u:%d N:%d M:%d D:%d\n", undoHead, doC
 		if (!ReadObject( &redoStream, FALSE ))
 			return FALSE;
 	}
+	if (us->delCnt)
+		BuryDeletedTracks();
 
 	if ( needAttachTrains ) {
 		AttachTrains();
@@ -26,15 +26,39 @@
 #include "common.h"
 #include "track.h"
 
+extern long undoMemory;
+extern long undoLogEnable;
+
 int UndoUndo( void );
 int UndoRedo( void );
 void UndoResume( void );
 void UndoSuspend( void );
 void UndoStart( char *, char *, ... );
 BOOL_T UndoModify( track_p );
+BOOL_T UndoConnect( track_p );
+BOOL_T UndoMoveTracks( int, track_p * );
+BOOL_T UndoChangeTracks( int, track_p * );
 BOOL_T UndoDelete( track_p );
 BOOL_T UndoNew( track_p );
 void UndoEnd( void );
 void UndoClear( void );
+void UndoLoadStart( void );
+void UndoLoadEnd( track_p *, wIndex_t );
+track_p UndoGraveyard( void );
+void UndoFreeGraveyard( void );
+void UndoSaveGraveyard( void );
+void UndoRestoreGraveyard( void );
+BOOL_T UndoJournalOpen( const char * fileName );
+void UndoJournalClose( void );
+void UndoJournalBreak( void );
+BOOL_T UndoJournalActive( void );
+void UndoJournalRenumber( track_p, TRKINX_T );
+void UndoJournalRenumberDone( void );
+BOOL_T UndoJournalReplay( const char * fileName );
+void UndoLogOpen( const char * fileName, BOOL_T recovered );
+void UndoLogClose( void );
+void UndoLogSaved( const char * fileName );
+void UndoLogRenumber( track_p, TRKINX_T );
+void UndoLogRenumberDone( void );
 
 #endif // !HAVE_CUNDO_H
@@ -69,8 +69,12 @@ char * sAboutProd = NULL;
 char * sCustomF = product ".cus";
 char * sCheckPointF = product Version ".ckp";
 char * sCheckPoint1F = product Version ".ck1";
+char * sCheckPointJF = product Version ".ckj";
+char * sCheckPointTF = product Version ".ckt";
+char * sCheckPointJTF = product Version ".cjt";
 
 char * sClipboardF = product ".clp";
+char * sClipboardTF = product ".clt";
 char * sParamQF = product ".xtq";
 char * sUndoF = product ".und";
 char * sAuditF = product ".aud";
@@ -174,12 +178,14 @@ void InitCustom( void )
 	}
 	if (sSourceFilePattern == NULL)
 	{
-		sprintf(buf, _("All %s Files (*.xtc,*.xtce)|*.xtc;*.xtce|"
+		sprintf(buf, _("All %s Files (*.xtc,*.xtce,*.xtcb)|*.xtc;*.xtce;*.xtcb|"
 					   "%s Trackplan (*.xtc)|*.xtc|"
 					   "%s Extended Trackplan (*.xtce)|*.xtce|"
+					   "%s Binary Trackplan (*.xtcb)|*.xtcb|"
 					   "All Files (*)|*"), 
 						Product,
 						Product, 
+						Product,
 						Product );
 		sSourceFilePattern = strdup(buf);
 	}
@@ -187,7 +193,9 @@ void InitCustom( void )
 	{
 		sprintf(buf, _("%s Trackplan (*.xtc)|*.xtc|"
 					   "%s Extended Trackplan (*.xtce)|*.xtce|"
+					   "%s Binary Trackplan (*.xtcb)|*.xtcb|"
 					   "All Files (*)|*"),
+						Product,
 						Product,
 						Product );
 		sSaveFilePattern = strdup(buf);
@@ -62,7 +62,11 @@ extern char * sAboutProd;
 extern char * sCustomF;
 extern char * sCheckPointF;
 extern char * sCheckPoint1F;
+extern char * sCheckPointJF;
+extern char * sCheckPointTF;
+extern char * sCheckPointJTF;
 extern char * sClipboardF;
+extern char * sClipboardTF;
 extern char * sParamQF;
 extern char * sUndoF;
 extern char * sAuditF;
@@ -33,6 +33,7 @@
 #include "ctrain.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "messages.h"
@@ -744,7 +745,7 @@ static BOOL_T CarProtoWrite(
 
 	long longCenterOffset = (long)(proto->dim.truckCenterOffset*1000);
 
-	rc &= fprintf( f, "CARPROTO \"%s\" %ld %ld %0.3f %0.3f 0 %ld %0.3f %0.3f\n",
+	rc &= FilePrintf( f, "CARPROTO \"%s\" %ld %ld %0.3f %0.3f 0 %ld %0.3f %0.3f\n",
 		PutTitle(proto->desc), proto->options, proto->type, proto->dim.carLength, proto->dim.carWidth, longCenterOffset, proto->dim.truckCenter, proto->dim.coupledLength )>0;
 	rc &= WriteSegs( f, proto->segCnt, proto->segPtr );
 
@@ -1138,8 +1139,8 @@ static BOOL_T CarPartWrite(
 		tabs[T_ROADNAME].len, tabs[T_ROADNAME].ptr,
 		tabs[T_REPMARK].len, tabs[T_REPMARK].ptr,
 		tabs[T_NUMBER].len, tabs[T_NUMBER].ptr );
-	rc &= fprintf( f, "CARPART %s \"%s\"", GetScaleName(partP->parent->scale), PutTitle(message) )>0;
-	rc &= fprintf( f, " %ld %ld %0.3f %0.3f 0 0 %0.3f %0.3f %ld\n",
+	rc &= FilePrintf( f, "CARPART %s \"%s\"", GetScaleName(partP->parent->scale), PutTitle(message) )>0;
+	rc &= FilePrintf( f, " %ld %ld %0.3f %0.3f 0 0 %0.3f %0.3f %ld\n",
 		partP->options, partP->type, partP->dim.carLength, partP->dim.carWidth, partP->dim.truckCenter, partP->dim.coupledLength, wDrawGetRGB(partP->color) )>0;
 
 	RestoreLocale(oldLocale);
@@ -1382,27 +1383,27 @@ static BOOL_T CarItemWrite(
 		options |= CAR_ITEM_HASNOTES;
 	if ( layout && item->car && !IsTrackDeleted(item->car) )
 		options |= CAR_ITEM_ONLAYOUT;
-	rc &= fprintf( f, "CAR %ld %s \"%s\" %ld %ld %0.3f %0.3f 0 %ld %0.3f %0.3f %ld %0.3f %0.3f %ld %ld %ld 0 0 0 0 0 0",
+	rc &= FilePrintf( f, "CAR %ld %s \"%s\" %ld %ld %0.3f %0.3f 0 %ld %0.3f %0.3f %ld %0.3f %0.3f %ld %ld %ld 0 0 0 0 0 0",
 		item->index, GetScaleName(item->scaleInx), PutTitle(item->title),
 		options, item->type,
 		item->dim.carLength, item->dim.carWidth, longCenterOffset, item->dim.truckCenter, item->dim.coupledLength, wDrawGetRGB(item->color),
 		item->data.purchPrice, item->data.currPrice, item->data.condition, item->data.purchDate, item->data.serviceDate )>0;
 	if ( (options&CAR_ITEM_HASNOTES) ) {
 		char * sEscapedNote = ConvertToEscapedText( item->data.notes );
-		rc &= fprintf( f, " \"%s\"", sEscapedNote )>0;
+		rc &= FilePrintf( f, " \"%s\"", sEscapedNote )>0;
 		MyFree( sEscapedNote );
 	} else {
-		rc &= fprintf( f, " \"\"" ) > 0;
+		rc &= FilePrintf( f, " \"\"" ) > 0;
 	}
 	if ( ( options&CAR_ITEM_ONLAYOUT) ) {
 		CarGetPos( item->car, &pos, &angle );
-		rc &= fprintf( f, " %d %u %0.3f %0.3f %0.3f\n",
+		rc &= FilePrintf( f, " %d %u %0.3f %0.3f %0.3f\n",
 				GetTrkIndex(item->car), GetTrkLayer(item->car), pos.x, pos.y, angle )>0;
 		rc &= WriteEndPt( f, item->car, 0 );
 		rc &= WriteEndPt( f, item->car, 1 );
-		rc &= fprintf( f, "\t%s\n", END_SEGS )>0;
+		rc &= FilePrintf( f, "\t%s\n", END_SEGS )>0;
 	} else {
-		rc &= fprintf( f, "\n" )>0;
+		rc &= FilePrintf( f, "\n" )>0;
 	}
 
 	RestoreLocale(oldLocale);
@@ -4549,66 +4550,66 @@ static int CarInvSaveText(
 		}
 		if ( item->data.serviceDate > 0 ) widths[8] = 8;
 	}
-	fprintf( f, "%-*.*s %-*.*s %-*.*s %-*.*s", widths[0], widths[0], "#", widths[1], widths[1], "Part", widths[2], widths[2], "Description", widths[3], widths[3], "Rep Mark" );
-	if ( widths[4] ) fprintf( f, " %-*.*s", widths[4], widths[4], "PurDate" );
-	if ( widths[5] ) fprintf( f, " %-*.*s", widths[5], widths[5], "PurPrice" );
-	if ( widths[6] ) fprintf( f, " %-*.*s", widths[6], widths[6], "Cond" );
-	if ( widths[7] ) fprintf( f, " %-*.*s", widths[7], widths[7], "CurPrice" );
-	if ( widths[8] ) fprintf( f, " %-*.*s", widths[8], widths[8], "SrvDate" );
-	fprintf( f, "\n" );
+	FilePrintf( f, "%-*.*s %-*.*s %-*.*s %-*.*s", widths[0], widths[0], "#", widths[1], widths[1], "Part", widths[2], widths[2], "Description", widths[3], widths[3], "Rep Mark" );
+	if ( widths[4] ) FilePrintf( f, " %-*.*s", widths[4], widths[4], "PurDate" );
+	if ( widths[5] ) FilePrintf( f, " %-*.*s", widths[5], widths[5], "PurPrice" );
+	if ( widths[6] ) FilePrintf( f, " %-*.*s", widths[6], widths[6], "Cond" );
+	if ( widths[7] ) FilePrintf( f, " %-*.*s", widths[7], widths[7], "CurPrice" );
+	if ( widths[8] ) FilePrintf( f, " %-*.*s", widths[8], widths[8], "SrvDate" );
+	FilePrintf( f, "\n" );
 
 	for ( inx=0; inx<carItemInfo_da.cnt; inx++ ) {
 		item = carItemInfo(inx);
 		TabStringExtract( item->title, 7, tabs );
 		sprintf( message, "%ld", item->index );
-		fprintf( f, "%.*s", widths[0], message );
+		FilePrintf( f, "%.*s", widths[0], message );
 		width = tabs[T_MANUF].len + 1 + tabs[T_PART].len;
 		sprintf( message, "%s %.*s %.*s", GetScaleName(item->scaleInx), tabs[T_MANUF].len, tabs[T_MANUF].ptr, tabs[T_PART].len, tabs[T_PART].ptr );
-		fprintf( f, " %-*s", widths[1], message );
-		fprintf( f, " %-*.*s", widths[2], tabs[T_PROTO].len, tabs[T_PROTO].ptr );
+		FilePrintf( f, " %-*s", widths[1], message );
+		FilePrintf( f, " %-*.*s", widths[2], tabs[T_PROTO].len, tabs[T_PROTO].ptr );
 		width = tabs[T_REPMARK].len + tabs[T_NUMBER].len;
 		sprintf( message, "%.*s%s%.*s", tabs[T_REPMARK].len, tabs[T_REPMARK].ptr, (tabs[T_REPMARK].len > 0 && tabs[T_NUMBER].len > 0)?" ":"", tabs[T_NUMBER].len, tabs[T_NUMBER].ptr );
-		fprintf( f, " %-*s", widths[3], message );
+		FilePrintf( f, " %-*s", widths[3], message );
 		if ( widths[4] > 0 ) {
 			if ( item->data.purchDate > 0 ) {
 				sprintf( message, "%ld", item->data.purchDate );
-				fprintf( f, " %*.*s", widths[4], widths[4], message );
+				FilePrintf( f, " %*.*s", widths[4], widths[4], message );
 			} else {
-				fprintf( f, " %*s", widths[4], " " );
+				FilePrintf( f, " %*s", widths[4], " " );
 			}
 		}
 		if ( widths[5] > 0 ) {
 			if ( item->data.purchPrice > 0 ) {
 				sprintf( message, "%0.2f", item->data.purchPrice );
-				fprintf( f, " %*.*s", widths[5], widths[5], message );
+				FilePrintf( f, " %*.*s", widths[5], widths[5], message );
 			} else {
-				fprintf( f, " %*s", widths[5], " " );
+				FilePrintf( f, " %*s", widths[5], " " );
 			}
 		}
 		if ( widths[6] > 0 ) {
 			if ( item->data.condition != 0 ) {
-				fprintf( f, " %-*.*s", widths[6], widths[6], condListMap[MapCondition(item->data.condition)].name );
+				FilePrintf( f, " %-*.*s", widths[6], widths[6], condListMap[MapCondition(item->data.condition)].name );
 			} else {
-				fprintf( f, " %*s", widths[6], " " );
+				FilePrintf( f, " %*s", widths[6], " " );
 			}
 		}
 		if ( widths[7] > 0 ) {
 			if ( item->data.purchPrice > 0 ) {
 				sprintf( message, "%0.2f", item->data.purchPrice );
-				fprintf( f, " %*.*s", widths[7], widths[7], message );
+				FilePrintf( f, " %*.*s", widths[7], widths[7], message );
 			} else {
-				fprintf( f, " %*s", widths[7], " " );
+				FilePrintf( f, " %*s", widths[7], " " );
 			}
 		}
 		if ( widths[8] > 0 ) {
 			if ( item->data.serviceDate > 0 ) {
 				sprintf( message, "%ld", item->data.serviceDate );
-				fprintf( f, " %*.*s", widths[8], widths[8], message );
+				FilePrintf( f, " %*.*s", widths[8], widths[8], message );
 			} else {
-				fprintf( f, " %*s", widths[8], " " );
+				FilePrintf( f, " %*s", widths[8], " " );
 			}
 		}
-		fprintf( f, "\n" );
+		FilePrintf( f, "\n" );
 		if ( item->data.notes ) {
 			cp0 = item->data.notes;
 			while ( 1 ) {
@@ -4620,7 +4621,7 @@ static int CarInvSaveText(
 					if ( len == 0 )
 						break;
 				}
-				fprintf( f, "%*.*s %*.*s\n", widths[0], widths[0], " ", len, len, cp0 );
+				FilePrintf( f, "%*.*s %*.*s\n", widths[0], widths[0], " ", len, len, cp0 );
 				if ( cp1 == NULL )
 					break;
 				cp0 = cp1+1;
@@ -4947,12 +4948,12 @@ static void CsvFormatString(
 					fputc( '"', f );
 				fputc( *str, f );
 			} else if ( *str == '\n' && str[1] && len > 1 ) {
-				fprintf( f, "<NL>" );
+				FilePrintf( f, "<NL>" );
 			}
 		}
 		fputc( '"', f );
 	}
-	fprintf( f, "%s", sep );
+	FilePrintf( f, "%s", sep );
 }
 
 
@@ -4962,8 +4963,8 @@ static void CsvFormatLong(
 		char * sep )
 {
 	if ( val != 0 )
-		fprintf( f, "%ld", val );
-	fprintf( f, "%s", sep );
+		FilePrintf( f, "%ld", val );
+	FilePrintf( f, "%s", sep );
 }
 
 
@@ -4974,8 +4975,8 @@ static void CsvFormatFloat(
 		char * sep )
 {
 	if ( val != 0.0 )
-		fprintf( f, "%0.*f", digits, val );
-	fprintf( f, "%s", sep );
+		FilePrintf( f, "%0.*f", digits, val );
+	FilePrintf( f, "%s", sep );
 }
 
 
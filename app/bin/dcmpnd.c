@@ -27,6 +27,7 @@
 #include "cundo.h"
 #include "custom.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "messages.h"
 #include "param.h"
@@ -465,9 +466,9 @@ EXPORT BOOL_T CompoundCustomSave(
 	for ( inx=0; inx<turnoutInfo_da.cnt; inx++ ) {
 		to = turnoutInfo(inx);
 		if (to->paramFileIndex == PARAM_CUSTOM && to->segCnt > 0) {
-			rc &= fprintf( f, "TURNOUT %s \"%s\"\n", GetScaleName(to->scaleInx), PutTitle(to->title) )>0;
+			rc &= FilePrintf( f, "TURNOUT %s \"%s\"\n", GetScaleName(to->scaleInx), PutTitle(to->title) )>0;
 			if ( to->customInfo )
-				rc &= fprintf( f, "\tU %s\n",to->customInfo )>0;
+				rc &= FilePrintf( f, "\tU %s\n",to->customInfo )>0;
 			 rc &= WriteCompoundPathsEndPtsSegs( f, to->paths, to->segCnt, to->segs,
 				to->endCnt, to->endPt );
 		}
@@ -475,9 +476,9 @@ EXPORT BOOL_T CompoundCustomSave(
 	for ( inx=0; inx<structureInfo_da.cnt; inx++ ) {
 		to = structureInfo(inx);
 		if (to->paramFileIndex == PARAM_CUSTOM && to->segCnt > 0) {
-			rc &= fprintf( f, "STRUCTURE %s \"%s\"\n", GetScaleName(to->scaleInx), PutTitle(to->title) )>0;
+			rc &= FilePrintf( f, "STRUCTURE %s \"%s\"\n", GetScaleName(to->scaleInx), PutTitle(to->title) )>0;
 			if ( to->customInfo )
-				rc &= fprintf( f, "\tU %s\n",to->customInfo )>0;
+				rc &= FilePrintf( f, "\tU %s\n",to->customInfo )>0;
 			rc &= WriteSegs( f, to->segCnt, to->segs );
 		}
 	}
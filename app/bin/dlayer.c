@@ -37,6 +37,7 @@
 #include "paths.h"
 #include "dynstring.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "messages.h"
@@ -291,6 +292,7 @@ static void FlipLayer(unsigned int layer)
 		}
 	}
 
+    LoadHiddenLayers(FALSE);
     RedrawLayer(layer, TRUE);
 }
 
@@ -341,6 +343,10 @@ void SetCurrLayer(wIndex_t inx, const char * name, wIndex_t op,
 		}
 	}
 
+    if (LoadHiddenLayers(FALSE)) {
+        DoRedraw();
+    }
+
     if (recordF) {
         fprintf(recordF, "SETCURRLAYER %d\n", inx);
     }
@@ -1051,6 +1057,7 @@ void DecrementLayerObjects(unsigned int layer)
 
 /**
  *	Count the number of objects on each layer and store result in layers data structure.
+ *	Tracks of a binary layout which have not been read yet are counted as well.
  */
 
 void LayerSetCounts(void)
@@ -1059,7 +1066,7 @@ void LayerSetCounts(void)
     track_p trk;
 
     for (inx=0; inx<NUM_LAYERS; inx++) {
-        layers[inx].objCount = 0;
+        layers[inx].objCount = HiddenLayerTrackCount(inx);
     }
 
     for (trk=NULL; TrackIterate(&trk);) {
@@ -1646,7 +1653,7 @@ BOOL_T WriteLayers(FILE * f)
 
     for (inx = 0; inx < NUM_LAYERS; inx++) {
         if (IsLayerConfigured(inx)) {
-            fprintf(f, "LAYERS %u %d %d %d %ld %d %d %d %d \"%s\"\n",
+            FilePrintf(f, "LAYERS %u %d %d %d %ld %d %d %d %d \"%s\"\n",
                     inx,
                     layers[inx].visible,
                     layers[inx].frozen,
@@ -1659,14 +1666,14 @@ BOOL_T WriteLayers(FILE * f)
         }
     }
 
-    fprintf(f, "LAYERS CURRENT %u\n", curLayer);
+    FilePrintf(f, "LAYERS CURRENT %u\n", curLayer);
 
     for (inx = 0; inx < NUM_LAYERS; inx++) {
     	GetLayerLinkString(inx,layerLinkList);
     	if (IsLayerConfigured(inx) && strlen(layerLinkList)>0)
-    		fprintf(f, "LAYERS LINK %u \"%s\"\n",inx,layerLinkList);
+    		FilePrintf(f, "LAYERS LINK %u \"%s\"\n",inx,layerLinkList);
     	if (IsLayerConfigured(inx) && layers[inx].settingsName[0])
-    		fprintf(f, "LAYERS SET %u \"%s\"\n",inx, layers[inx].settingsName);
+    		FilePrintf(f, "LAYERS SET %u \"%s\"\n",inx, layers[inx].settingsName);
     }
     return TRUE;
 }
@@ -23,6 +23,7 @@
 #include <ctype.h>
 
 #include "ccurve.h"
+#include "cundo.h"
 #include "cselect.h"
 #include "custom.h"
 #include "i18n.h"
@@ -299,6 +300,7 @@ static char * angleSystemLabels[] = { N_("Polar"), N_("Cartesian"), NULL };
 static char * enableBalloonHelpLabels[] = { N_("Balloon Help"), NULL };
 static char * enableFlexTrackLabels[] = { N_("Show FlexTrack in HotBar"), NULL };
 static char * startOptions[] = { N_("Load Last Layout"), N_("Start New Layout"), NULL };
+static char * undoLogLabels[] = { N_("Keep Undo History with the Layout"), NULL };
 
 static paramData_t prefPLs[] = {
 	{ PD_RADIO, &angleSystem, "anglesystem", PDO_NOPSHUPD, angleSystemLabels, N_("Angles"), BC_HORZ },
@@ -319,6 +321,8 @@ static paramData_t prefPLs[] = {
 	{ PD_LONG, &checkPtInterval, "checkpoint", PDO_NOPSHUPD|PDO_FILE, &i0_10000, N_("Check Point Frequency") },
 #define I_AUTOSAVE		(14)
 	{ PD_LONG, &autosaveChkPoints, "autosave", PDO_NOPSHUPD|PDO_FILE, &i0_99, N_("Autosave Checkpoint Frequency") },
+	{ PD_LONG, &undoMemory, "undo-memory", PDO_NOPSHUPD, &i1_1000, N_("Undo Memory (MB)") },
+	{ PD_TOGGLE, &undoLogEnable, "undo-log", PDO_NOPSHUPD, undoLogLabels, "", BC_HORZ },
 	{ PD_RADIO, &onStartup, "onstartup", PDO_NOPSHUPD, startOptions, N_("On Program Startup"), 0, NULL }
 	};
 static paramGroup_t prefPG = { "pref", PGO_RECORD|PGO_PREFMISC, prefPLs, sizeof prefPLs/sizeof prefPLs[0] };
@@ -1391,12 +1391,14 @@ if (wDrawDoTempDraw == FALSE) {
 	MainRedraw(); // TempRedraw - windows
 } else {
 	wDrawDelayUpdate( tempD.d, TRUE );
+	wDrawBeginSession( tempD.d );
 	wDrawSetTempMode( tempD.d, TRUE );
 	DrawMarkers();
 	DoCurCommand( C_REDRAW, zero );
 	RulerRedraw( FALSE );
 	RedrawPlaybackCursor();              //If in playback
 	wDrawSetTempMode( tempD.d, FALSE );
+	wDrawEndSession( tempD.d );
 	wDrawDelayUpdate( tempD.d, FALSE );
 }
 }
@@ -1412,6 +1414,7 @@ EXPORT void MainRedraw( void )
 	LOG( log_redraw, 1, ( "MainRedraw: %d\n", cMR++ ) );
 	if (delayUpdate)
 	wDrawDelayUpdate( mainD.d, TRUE );
+	wDrawBeginSession( mainD.d );
 
 	wDrawClear( mainD.d );
 
@@ -1430,7 +1433,8 @@ EXPORT void MainRedraw( void )
 	wPos_t back_width = (wPos_t)(GetLayoutBackGroundSize()/mainD.scale*mainD.dpi);
 
 	DrawRoomWalls( TRUE );
-	if (GetLayoutBackGroundScreen() < 100.0 && GetLayoutBackGroundVisible()) {
+	if (GetLayoutBackGroundScreen() < 100.0 && GetLayoutBackGroundVisible() &&
+			FetchBackGroundImage()) {
 		wDrawShowBackground( mainD.d, back_x, back_y, back_width, GetLayoutBackGroundAngle(), GetLayoutBackGroundScreen());
 	}
 	DrawSnapGrid( &mainD, mapD.size, TRUE );
@@ -1456,6 +1460,7 @@ EXPORT void MainRedraw( void )
 	RulerRedraw( FALSE );
 	RedrawPlaybackCursor();              //If in playback
 	wDrawSetTempMode( tempD.d, FALSE );
+	wDrawEndSession( mainD.d );
 	wDrawDelayUpdate( mainD.d, FALSE );
 }
 
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <sys/mman.h>
 #endif
 #include <math.h>
 #include <ctype.h>
@@ -57,6 +58,7 @@
 #include "directory.h"
 #include "draw.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "fcntl.h"
 #include "i18n.h"
 #include "layout.h"
@@ -66,9 +68,12 @@
 #include "param.h"
 #include "include/paramfile.h"
 #include "paths.h"
+#include "scannum.h"
 #include "track.h"
 #include "utility.h"
+#include "uthash.h"
 #include "version.h"
+#include "workers.h"
 #include "dynstring.h"
 
 #ifdef WINDOWS
@@ -166,7 +171,8 @@ RestoreLocale( char * locale )
 EXPORT FILE * paramFile = NULL;
 char *paramFileName;
 EXPORT wIndex_t paramLineNum = 0;
-EXPORT char paramLine[STR_HUGE_SIZE];
+static char paramLineBuf[STR_HUGE_SIZE];
+EXPORT char * paramLine = paramLineBuf;	/**< current line, in paramLineBuf or the file image */
 EXPORT char * curContents;
 EXPORT char * curSubContents;
 
@@ -187,13 +193,169 @@ EXPORT void Stripcr( char * line )
 		*cp = '\0';
 }
 
+/*
+ * Layout files are read from memory.  The file is mapped (read in one go on
+ * Windows or if mapping fails) and each line is terminated in place, so
+ * paramLine points into the file image and lines have no length limit.
+ * paramLine points back to paramLineBuf once the image is closed.
+ */
+static char * paramMap = NULL;			/**< file image, NULL when not open */
+static char * paramMapCurr;
+static char * paramMapEnd;
+static size_t paramMapSize;
+static BOOL_T paramMapMapped;			/**< image is mmap'd, not MyMalloc'd */
+static BOOL_T paramMapBorrowed;			/**< image belongs to the caller, see ReadTrackText */
+static char * paramMapTail = NULL;		/**< copy of an unterminated last line */
+
+
+/**
+ * Open a file as the current input image.
+ *
+ * \param pathName IN file to read
+ * \return FALSE if the file could not be read, errno is set
+ */
+static BOOL_T ParamMapOpen( const char * pathName )
+{
+	struct stat buf;
+	FILE * f;
+	f = fopen( pathName, "rb" );
+	if ( f == NULL )
+		return FALSE;
+	if ( fstat( fileno(f), &buf ) != 0 ) {
+		fclose( f );
+		return FALSE;
+	}
+	paramMapSize = (size_t)buf.st_size;
+	paramMap = NULL;
+#ifndef WINDOWS
+	if ( paramMapSize > 0 ) {
+		paramMap = mmap( NULL, paramMapSize, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno(f), 0 );
+		if ( paramMap == MAP_FAILED )
+			paramMap = NULL;
+		else
+			madvise( paramMap, paramMapSize, MADV_SEQUENTIAL );
+	}
+#endif
+	paramMapMapped = (paramMap != NULL);
+	if ( paramMap == NULL ) {
+		paramMap = MyMalloc( paramMapSize+1 );
+		if ( paramMapSize > 0 &&
+			 fread( paramMap, 1, paramMapSize, f ) != paramMapSize ) {
+			int err = errno;
+			MyFree( paramMap );
+			paramMap = NULL;
+			fclose( f );
+			errno = err;
+			return FALSE;
+		}
+		paramMap[paramMapSize] = '\0';
+	}
+	fclose( f );
+	paramMapBorrowed = FALSE;
+	paramMapCurr = paramMap;
+	paramMapEnd = paramMap + paramMapSize;
+	return TRUE;
+}
+
+
+/**
+ * Use a MyMalloc'd buffer as the current input image.  It is freed when the
+ * image is closed.
+ *
+ * \param image IN the image, followed by a NUL
+ * \param size IN size of the image without the NUL
+ */
+static void ParamMapAdopt( char * image, size_t size )
+{
+	paramMap = image;
+	paramMapSize = size;
+	paramMapMapped = FALSE;
+	paramMapBorrowed = FALSE;
+	paramMapCurr = paramMap;
+	paramMapEnd = paramMap + paramMapSize;
+}
+
+
+static void ParamMapClose( void )
+{
+	if ( paramMap == NULL )
+		return;
+	if ( !paramMapBorrowed ) {
+#ifndef WINDOWS
+		if ( paramMapMapped )
+			munmap( paramMap, paramMapSize );
+		else
+#endif
+			MyFree( paramMap );
+	}
+	paramMap = NULL;
+	if ( paramMapTail ) {
+		MyFree( paramMapTail );
+		paramMapTail = NULL;
+	}
+	paramLine = paramLineBuf;
+	paramLineBuf[0] = '\0';
+}
+
+
+/**
+ * Terminate the next line of the input image in place, dropping the CR/LF.
+ *
+ * \return the line, NULL at the end of the image
+ */
+static char * ParamMapNextLine( void )
+{
+	char * line = paramMapCurr;
+	char * eol;
+	size_t len;
+	if ( line >= paramMapEnd )
+		return NULL;
+	eol = memchr( line, '\n', paramMapEnd-line );
+	if ( eol == NULL ) {
+		/* no room to terminate the last line in a mapped image */
+		len = paramMapEnd-line;
+		paramMapCurr = paramMapEnd;
+		if ( paramMapMapped ) {
+			if ( paramMapTail )
+				MyFree( paramMapTail );
+			paramMapTail = MyMalloc( len+1 );
+			memcpy( paramMapTail, line, len );
+			paramMapTail[len] = '\0';
+			line = paramMapTail;
+		} else {
+			line[len] = '\0';
+		}
+		eol = line+len;
+	} else {
+		paramMapCurr = eol+1;
+		*eol = '\0';
+	}
+	if ( eol > line && eol[-1] == '\r' )
+		eol[-1] = '\0';
+	return line;
+}
+
+
 EXPORT char * GetNextLine( void )
 {
+	char * line;
+	if ( paramMap ) {
+		if ( (line = ParamMapNextLine()) == NULL ) {
+			sprintf( message, "INPUT ERROR: premature EOF on %s", paramFileName );
+			wNoticeEx( NT_ERROR, message, _("Ok"), NULL );
+			ParamMapClose();
+			return paramLine;
+		}
+		paramLine = line;
+		ParamCheckSumLine( paramLine );
+		paramLineNum++;
+		return paramLine;
+	}
 	if (!paramFile) {
 		paramLine[0] = '\0';
 		return NULL;
 	}
-	if (fgets( paramLine, sizeof paramLine, paramFile ) == NULL) {
+	if (fgets( paramLine, sizeof paramLineBuf, paramFile ) == NULL) {
 		sprintf( message, "INPUT ERROR: premature EOF on %s", paramFileName );
 		wNoticeEx( NT_ERROR, message, _("Ok"), NULL );
 		if ( paramFile ) {
@@ -236,7 +398,9 @@ EXPORT int InputError(
 	va_end( ap );
 	if (showLine) {
 		*mp++ = '\n';
-		strcpy( mp, paramLine );
+		/* lines read from an image can be of any length */
+		strncpy( mp, paramLine, STR_LONG_SIZE );
+		mp[STR_LONG_SIZE] = '\0';
 	}
 	strcat( mp, _("\nDo you want to continue?") );
 	if (!(ret = wNoticeEx( NT_ERROR, message, _("Continue"), _("Stop") ))) {
@@ -244,6 +408,7 @@ EXPORT int InputError(
 			fclose(paramFile);
 			paramFile = NULL;
 		}
+		ParamMapClose();
 		if ( paramFileName ) {
 			free( paramFileName );
 			paramFileName = NULL;
@@ -290,6 +455,53 @@ EXPORT void SyntaxError(
  * c - *qp = position of next non-space char or NULL
  */
 
+/*
+ * GetArgs formats are compiled once: each format string is checked and
+ * turned into an array of argument types, kept in a table keyed by the
+ * address of the format string.  A copy of the text is kept to notice a
+ * format which is not a literal and has changed.
+ */
+#define ARG_EOL_OK		(0x80)		/**< argument may be missing at the end of the line */
+
+typedef struct {
+		const char * format;
+		char * text;				/**< copy of the format string */
+		unsigned char * args;		/**< format chars, ARG_EOL_OK or'd in */
+		UT_hash_handle hh;
+		} argsFormat_t;
+static argsFormat_t * argsFormats = NULL;
+
+static const unsigned char * CompileArgs( const char * format )
+{
+	argsFormat_t * fmt;
+	const char * cp;
+	unsigned char * args;
+	HASH_FIND_PTR( argsFormats, &format, fmt );
+	if ( fmt && strcmp( fmt->text, format ) == 0 )
+		return fmt->args;
+	if ( fmt ) {
+		/* format text at this address has changed */
+		HASH_DEL( argsFormats, fmt );
+		MyFree( fmt->text );
+		MyFree( fmt->args );
+		MyFree( fmt );
+	}
+	args = (unsigned char*)MyMalloc( strlen(format)+1 );
+	for ( cp=format; *cp; cp++ ) {
+		if ( strchr( "0XZYLdwulfzpsqc", *cp ) == NULL )
+			AbortProg( "getArgs: bad format char: %c", *cp );
+		args[cp-format] = (unsigned char)*cp | ( strchr( "XZYzc", *cp ) ? ARG_EOL_OK : 0 );
+	}
+	args[cp-format] = '\0';
+	fmt = (argsFormat_t*)MyMalloc( sizeof *fmt );
+	fmt->format = format;
+	fmt->text = MyStrdup( format );
+	fmt->args = args;
+	HASH_ADD_PTR( argsFormats, format, fmt );
+	return args;
+}
+
+
 EXPORT BOOL_T GetArgs(
 		char * line,
 		char * format,
@@ -304,22 +516,22 @@ EXPORT BOOL_T GetArgs(
 	char * ps;
 	char ** qp;
 	va_list ap;
-	char *oldLocale = NULL;
 	char * sError = NULL;
+	const unsigned char * args;
 
-	oldLocale = SaveLocale("C");
-
+	/* the scanners ignore the locale, so there is no need to switch to "C" */
+	args = CompileArgs( format );
 	cp = line;
 	va_start( ap, format );
-	for ( ; sError==NULL && *format; format++ ) {
+	for ( ; sError==NULL && *args; args++ ) {
 		while (isspace((unsigned char)*cp)) cp++;
-		if (!*cp && strchr( "XZYzc", *format ) == NULL ) {
+		if (!*cp && ((*args)&ARG_EOL_OK) == 0 ) {
 			sError = "EOL unexpected";
 			break;
 		}
-		switch (*format) {
+		switch ((*args)&~ARG_EOL_OK) {
 		case '0':
-			(void)strtol( cp, &cq, 10 );
+			(void)ScanLong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
@@ -340,7 +552,7 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'L':
 			pi = va_arg( ap, int * );
-			*pi = (int)strtol( cp, &cq, 10 );
+			*pi = (int)ScanLong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
@@ -349,7 +561,7 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'd':
 			pi = va_arg( ap, int * );
-			*pi = (int)strtol( cp, &cq, 10 );
+			*pi = (int)ScanLong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
@@ -358,20 +570,20 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'w':
 			pf = va_arg( ap, FLOAT_T * );
-			*pf = (FLOAT_T)strtol( cp, &cq, 10 );
+			*pf = (FLOAT_T)ScanLong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
 			}
 			if (*cq == '.')
-				*pf = strtod( cp, &cq );
+				*pf = ScanDouble( cp, &cq );
 			else
 				*pf /= mainD.dpi;
 			cp = cq;
 			break;
 		case 'u':
 			pul = va_arg( ap, unsigned long * );
-			*pul = strtoul( cp, &cq, 10 );
+			*pul = ScanULong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
@@ -380,7 +592,7 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'l':
 			pl = va_arg( ap, long * );
-			*pl = strtol( cp, &cq, 10 );
+			*pl = ScanLong( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected integer";
 				break;
@@ -389,7 +601,7 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'f':
 			pf = va_arg( ap, FLOAT_T * );
-			*pf = strtod( cp, &cq );
+			*pf = ScanDouble( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected float";
 				break;
@@ -402,13 +614,13 @@ EXPORT BOOL_T GetArgs(
 			break;
 		case 'p':
 			pp = va_arg( ap, coOrd * );
-			p.x = strtod( cp, &cq );
+			p.x = ScanDouble( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected float";
 				break;
 			}
 			cp = cq;
-			p.y = strtod( cp, &cq );
+			p.y = ScanDouble( cp, &cq );
 			if (cp == cq) {
 				sError = "%s: expected float";
 				break;
@@ -466,12 +678,9 @@ EXPORT BOOL_T GetArgs(
 			else
 				*qp = NULL;
 			break;
-		default:
-			AbortProg( "getArgs: bad format char: %c", *format );
 		}
 	}
 	va_end( ap );
-	RestoreLocale(oldLocale);
 	if ( sError ) {
 		InputError( sError, TRUE, cp );
 		return FALSE;
@@ -654,75 +863,50 @@ static struct wFilSel_t * loadFile_fs = NULL;
 static struct wFilSel_t * saveFile_fs = NULL;
 static struct wFilSel_t * examplesFile_fs = NULL;
 
-static wWin_p checkPointingW;
-static paramData_t checkPointingPLs[] = {
-   {    PD_MESSAGE, N_("Check Pointing") } };
-static paramGroup_t checkPointingPG = { "checkpoint", 0, checkPointingPLs, sizeof checkPointingPLs/sizeof checkPointingPLs[0] };
-
 static char * checkPtFileName1;
 static char * checkPtFileName2;
 static char * checkPtFileNameBackup;
+static char * checkPtFileNameJournal;
+static char * checkPtFileNameTemp;			/**< the snapshot being written */
+static char * checkPtFileNameJournalTemp;	/**< the journal which goes with it */
 
-/** Read the layout design.
- *
- * \param IN pathName filename including directory
- * \param IN fileName pointer to filename part in pathName
- * \param IN full
- * \param IN noSetCurDir if FALSE current diurectory is changed to file location
- * \param IN complain  if FALSE error messages are supressed
- *
- * \return FALSE in case of load error
+/*
+ * State of the layout file being read, shared by ReadTrackLines and
+ * ReadTrackText
  */
+static BOOL_T readFull;
+static int readCount;
+static int readSkipLines;
+static BOOL_T readSkip;
+static BOOL_T readStop;				/**< END$TRACKS or an unusable VERSION was read */
+static BOOL_T readCheckPoint = FALSE;	/**< the journal may refer to tracks on any layer */
+static long readProgressTime;
 
-static BOOL_T ReadTrackFile(
-		const char * pathName,
-		const char * fileName,
-		BOOL_T full,
-		BOOL_T noSetCurDir,
-		BOOL_T complain )
+
+/**
+ * Read layout objects from the input image up to its end or END$TRACKS.
+ *
+ * \return FALSE if the user chose to stop after an error
+ */
+static BOOL_T ReadTrackLines( void )
 {
-	int count;
 	coOrd roomSize;
 	long scale;
 	char * cp;
-	char *oldLocale = NULL;
+	char * line;
 	int ret = TRUE;
 
-	oldLocale = SaveLocale( "C" );
-
-	paramFile = fopen( pathName, "r" );
-	if (paramFile == NULL) {
-		/* Reset the locale settings */
-		RestoreLocale( oldLocale );
-
-		if ( complain )
-			NoticeMessage( MSG_OPEN_FAIL, _("Continue"), NULL, sProdName, pathName, strerror(errno) );
-
-		return FALSE;
-	}
-
-	paramLineNum = 0;
-	paramFileName = strdup( fileName );
-
-	InfoMessage("0");
-	count = 0;
-	int skipLines = 0;
-	BOOL_T skip = FALSE;
-	while ( paramFile && ( fgets(paramLine, sizeof paramLine, paramFile) ) != NULL ) {
-		count++;
-		BOOL_T old_skip = skip;
-		skip = FALSE;
-		if (count%10 == 0) {
-			InfoMessage( "%d", count );
+	while ( paramMap && ( line = ParamMapNextLine() ) != NULL ) {
+		paramLine = line;
+		readCount++;
+		BOOL_T old_skip = readSkip;
+		readSkip = FALSE;
+		if ( wGetTimer() - readProgressTime >= 250 ) {
+			InfoMessage( "%d", readCount );
 			wFlush();
+			readProgressTime = wGetTimer();
 		}
 		paramLineNum++;
-		if (strlen(paramLine) == (sizeof paramLine) -1 &&
-			paramLine[(sizeof paramLine)-1] != '\n') {
-			if( !(ret = InputError( "Line too long", TRUE )))
-				break;
-		}
-		Stripcr( paramLine );
 		if (paramLine[0] == '#' ||
 			paramLine[0] == '\n' ||
 			paramLine[0] == '\0' ) {
@@ -733,6 +917,7 @@ static BOOL_T ReadTrackFile(
 		if (ReadTrack( paramLine )) {
 			continue;
 		} else if (IsEND( END_TRK_FILE ) ) {
+			readStop = TRUE;
 			break;
 		} else if (strncmp( paramLine, "VERSION ", 8 ) == 0) {
 			paramVersion = strtol( paramLine+8, &cp, 10 );
@@ -744,13 +929,15 @@ static BOOL_T ReadTrackFile(
 				} else {
 					NoticeMessage( MSG_UPGRADE_VERSION2, _("Ok"), NULL, paramVersion, iParamVersion, sProdName );
 				}
+				readStop = TRUE;
 				break;
 			}
 			if ( paramVersion < iMinParamVersion ) {
 				NoticeMessage( MSG_BAD_FILE_VERSION, _("Ok"), NULL, paramVersion, iMinParamVersion, sProdName );
+				readStop = TRUE;
 				break;
 			}
-		} else if (!full) {
+		} else if (!readFull) {
 			if( !(ret = InputError( "unknown command", TRUE )))
 				break;
 		} else if (strncmp( paramLine, "TITLE1 ", 7 ) == 0) {
@@ -788,40 +975,214 @@ static BOOL_T ReadTrackFile(
 			if (!old_skip) {
 				if (InputError(_("Unknown layout file object - skip until next good object?"), TRUE)) {   //OK to carry on
 					/* SKIP until next main line we recognize */
-					skip = TRUE;
-					skipLines++;
+					readSkip = TRUE;
+					readSkipLines++;
 					continue;
 				} else {
 					break;    //Close File
 				}
-			} else skip = TRUE;
-			skipLines++;
+			} else readSkip = TRUE;
+			readSkipLines++;
 		}
 	}
 
-	if (paramFile) {
-		fclose(paramFile);
-		paramFile = NULL;
+	return ret;
+}
+
+
+/**
+ * Read layout objects from a block of text in the same way as the lines of
+ * a layout file.  This is used for the text carried by binary layout files,
+ * see trkbin.c.  The text is modified in place and must be followed by a NUL.
+ * If no file is being read the text is used as the input image by itself.
+ *
+ * \param text IN the text, inside the input image if a file is being read
+ * \param len IN length of the text
+ * \return FALSE if reading should stop
+ */
+EXPORT BOOL_T ReadTrackText( char * text, size_t len )
+{
+	char * mapCurr = paramMapCurr;
+	char * mapEnd = paramMapEnd;
+	char * line = paramLine;
+	int lineNum = paramLineNum;
+	BOOL_T borrowed = ( paramMap == NULL );
+	BOOL_T ret;
+
+	if ( borrowed ) {
+		paramMap = text;
+		paramMapSize = len;
+		paramMapMapped = FALSE;
+		paramMapBorrowed = TRUE;
+		readFull = TRUE;
+	}
+	readStop = FALSE;
+	paramMapCurr = text;
+	paramMapEnd = text+len;
+	ret = ReadTrackLines();
+	if ( borrowed ) {
+		ParamMapClose();
+		paramLine = line;
+		paramLineNum = lineNum;
+		return ret && !readStop;
+	}
+	if ( paramMap == NULL )
+		return FALSE;
+	paramMapCurr = mapCurr;
+	paramMapEnd = mapEnd;
+	return ret && !readStop;
+}
+
+
+/**
+ * Tracks on hidden layers of binary layout files are read when they are
+ * needed, see LoadHiddenLayers.
+ */
+static BOOL_T HiddenLayer( unsigned int layer )
+{
+	return !GetLayerVisible( layer ) && layer != curLayer;
+}
+
+
+/**
+ * Read the layout design from the input image opened by the caller.  The
+ * image is closed afterwards.
+ *
+ * \param IN fileName filename for messages
+ * \param IN full
+ * \param IN noSetCurDir if FALSE current diurectory is changed to file location
+ *
+ * \return FALSE in case of load error
+ */
+
+static BOOL_T ReadTrackMap(
+		const char * fileName,
+		BOOL_T full,
+		BOOL_T noSetCurDir )
+{
+	int ret = TRUE;
+	long lazyLayers;
+
+	paramLineNum = 0;
+	paramFileName = strdup( fileName );
+
+	InfoMessage("0");
+	readFull = full;
+	readCount = 0;
+	readSkipLines = 0;
+	readSkip = FALSE;
+	readStop = FALSE;
+	readProgressTime = wGetTimer();
+	if ( IsTracksBinary( paramMap, paramMapSize ) ) {
+		if ( !full )
+			ret = InputError( _("Binary layout files can not be imported"), FALSE );
+		else {
+			wPrefGetInteger( "misc", "lazy-layers", &lazyLayers, 1 );
+			ret = ReadTracksBinary( paramMap, paramMapSize,
+						lazyLayers && !readCheckPoint ? HiddenLayer : NULL ) || readStop;
+		}
+	} else {
+		ret = ReadTrackLines();
 	}
+	ParamMapClose();
 
 	if( ret ) {
 		if (!noSetCurDir)
 			SetCurrentPath( LAYOUTPATHKEY, fileName );
 	}
 
-	 if (skipLines>0)
-		 NoticeMessage( MSG_LAYOUT_LINES_SKIPPED, _("Ok"), NULL, paramFileName, skipLines);
-
-	RestoreLocale( oldLocale );
+	 if (readSkipLines>0)
+		 NoticeMessage( MSG_LAYOUT_LINES_SKIPPED, _("Ok"), NULL, paramFileName, readSkipLines);
 
 	paramFile = NULL;
 
 	free(paramFileName);
     paramFileName = NULL;
-	InfoMessage( "%d", count );
+	InfoMessage( "%d", readCount );
 	return ret;
 }
 
+
+/** Read the layout design.
+ *
+ * \param IN pathName filename including directory
+ * \param IN fileName pointer to filename part in pathName
+ * \param IN full
+ * \param IN noSetCurDir if FALSE current diurectory is changed to file location
+ * \param IN complain  if FALSE error messages are supressed
+ *
+ * \return FALSE in case of load error
+ */
+
+static BOOL_T ReadTrackFile(
+		const char * pathName,
+		const char * fileName,
+		BOOL_T full,
+		BOOL_T noSetCurDir,
+		BOOL_T complain )
+{
+	char *oldLocale = NULL;
+	int ret;
+
+	oldLocale = SaveLocale( "C" );
+
+	if ( !ParamMapOpen( pathName ) ) {
+		/* Reset the locale settings */
+		RestoreLocale( oldLocale );
+
+		if ( complain )
+			NoticeMessage( MSG_OPEN_FAIL, _("Continue"), NULL, sProdName, pathName, strerror(errno) );
+
+		return FALSE;
+	}
+
+	ret = ReadTrackMap( fileName, full, noSetCurDir );
+	RestoreLocale( oldLocale );
+	return ret;
+}
+
+
+/**
+ * Read the layout design from an entry of a layout archive, without
+ * extracting it to a file first.
+ *
+ * \param IN za the archive
+ * \param IN entryName name of the layout in the archive
+ * \param IN fileName filename part of the archive
+ *
+ * \return FALSE in case of load error
+ */
+
+static BOOL_T ReadTrackArchive(
+		struct zip * za,
+		const char * entryName,
+		const char * fileName )
+{
+	char *oldLocale = NULL;
+	char * image;
+	size_t size;
+	int ret;
+
+#ifdef WINDOWS
+	/* ParseManifest converted the name to the system code page */
+	char * entry = Convert2UTF8( MyStrdup( entryName ) );
+	image = ReadArchiveEntry( za, entry, &size );
+	MyFree( entry );
+#else
+	image = ReadArchiveEntry( za, entryName, &size );
+#endif
+	if ( image == NULL ) {
+		NoticeMessage( MSG_ZIP_READ_FAIL, _("Continue"), NULL, fileName, entryName );
+		return FALSE;
+	}
+	oldLocale = SaveLocale( "C" );
+	ParamMapAdopt( image, size );
+	ret = ReadTrackMap( fileName, TRUE, TRUE );
+	RestoreLocale( oldLocale );
+	return ret;
+}
+
+
 int LoadTracks(
 		int cnt,
 		char **fileName,
@@ -862,44 +1223,31 @@ int LoadTracks(
 
 	BOOL_T zipped = FALSE;
 	BOOL_T loadXTC = TRUE;
+	struct zip * zipArchive = NULL;
 	char * full_path = strdup(fileName[0]);
 
 	if (extOfFile && (strcmp(extOfFile, ZIPFILETYPEEXTENSION )==0)) {
 
 		char * zip_input = GetZipDirectoryName(ARCHIVE_READ);
 
-		//If zipped unpack file into temporary input dir (cleared and re-created)
+		//The manifest and the layout are read straight from the archive.  Other
+		//files go to the temporary input dir (cleared and re-created) when needed.
 
 		DeleteDirectory(zip_input);
 		SafeCreateDir(zip_input);
 
-		if (UnpackArchiveFor(fileName[0], nameOfFile, zip_input, FALSE)) {
+		free(full_path);
+		full_path = NULL;
+		zipArchive = OpenArchive(fileName[0]);
+		if (zipArchive) {
 
-			char * manifest_file;
+			size_t length;
+			char * manifest = ReadArchiveEntry(zipArchive, "manifest.json", &length);
 
-			MakeFullpath(&manifest_file, zip_input, "manifest.json", NULL);
-
-			char * manifest = 0;
-			long length;
-
-			FILE * f = fopen (manifest_file, "rb");
-
-			if (f)
-			{
-			    fseek(f, 0, SEEK_END);
-			    length = ftell(f);
-			    fseek(f, 0, SEEK_SET);
-			    manifest = malloc(length + 1);
-			    if (manifest) {
-			        size_t siz = fread(manifest, 1, length, f);
-			        manifest[length] = '\0';
-			    }
-			    fclose(f);
-			} else
+			if (!manifest)
 			{
-			    NoticeMessage(MSG_MANIFEST_OPEN_FAIL, _("Continue"), NULL, manifest_file);
+			    NoticeMessage(MSG_MANIFEST_OPEN_FAIL, _("Continue"), NULL, "manifest.json");
 			}
-			free(manifest_file);
 
 			char * arch_file = NULL;
 
@@ -907,20 +1255,19 @@ int LoadTracks(
 			//Use the name inside manifest (this helps if a user renames the zip)
 			if (manifest)
 			{
-			    arch_file = ParseManifest(manifest, zip_input);
-				free(manifest);
+			    arch_file = ParseManifest(manifest, zip_input, fileName[0]);
+				MyFree(manifest);
 			}
 
-			free(full_path);
-			full_path = NULL;
 			// If no manifest value use same name as the archive
 			if (arch_file && arch_file[0])
 			{
-			    MakeFullpath(&full_path, zip_input, arch_file, NULL);
+			    full_path = strdup(arch_file);
 			} else
 			{
-			    MakeFullpath(&full_path, zip_input, nameOfFile, NULL);
+			    full_path = strdup(nameOfFile);
 			}
+			free(arch_file);
 
 			nameOfFile = FindFilename(full_path);
 			extOfFile = FindFileExtension(full_path);
@@ -935,7 +1282,7 @@ int LoadTracks(
 			    printf("File Path: %s \n", full_path);
 			#endif
 		} else {
-			loadXTC = FALSE; // when unzipping fails, don't attempt loading the trackplan
+			loadXTC = FALSE; // when the archive can't be opened, don't attempt loading the trackplan
 		}
 		zipped = TRUE;
 
@@ -953,7 +1300,13 @@ int LoadTracks(
 
 	char *copyOfFileName = MyStrdup(fileName[0]);
 
-	if (loadXTC && ReadTrackFile( full_path, FindFilename( fileName[0]), TRUE, TRUE, TRUE )) {
+	if (zipArchive) {
+		loadXTC = loadXTC && ReadTrackArchive( zipArchive, full_path, FindFilename( fileName[0]) );
+		zip_discard( zipArchive );
+	} else {
+		loadXTC = loadXTC && ReadTrackFile( full_path, FindFilename( fileName[0]), TRUE, TRUE, TRUE );
+	}
+	if (loadXTC) {
 
 		nameOfFile = NULL;
 		extOfFile = NULL;
@@ -979,6 +1332,8 @@ int LoadTracks(
 		DoUpdateTitles();
 		LoadLayerLists();
 		LayerSetCounts();
+		if ( ! bExample )
+			UndoLogOpen( copyOfFileName, FALSE );
 	}
 
 	MyFree(copyOfFileName);
@@ -1012,17 +1367,69 @@ EXPORT void DoFileList(
 		LoadTracks( 1, &pathName, NULL );
 }
 
+/**
+ * Write the layout settings, layers and main note which precede the tracks.
+ *
+ * \param f IN output file
+ * \return FALSE on a write error
+ */
+static BOOL_T WriteLayoutHeader(
+		FILE * f )
+{
+	time_t clock;
+	BOOL_T rc = TRUE;
+
+	time(&clock);
+	rc &= FilePrintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) )>0;
+	rc &= FilePrintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION )>0;
+	Stripcr( GetLayoutTitle() );
+	Stripcr( GetLayoutSubtitle() );
+	rc &= FilePrintf(f, "TITLE1 %s\n", GetLayoutTitle())>0;
+	rc &= FilePrintf(f, "TITLE2 %s\n", GetLayoutSubtitle())>0;
+	rc &= FilePrintf(f, "MAPSCALE %ld\n", (long)mapD.scale )>0;
+	rc &= FilePrintf(f, "ROOMSIZE %0.6f x %0.6f\n", mapD.size.x, mapD.size.y )>0;
+	rc &= FilePrintf(f, "SCALE %s\n", curScaleName )>0;
+	rc &= WriteLayers( f );
+	rc &= WriteMainNote( f );
+	return rc;
+}
+
+
+/**
+ * Write the whole layout in the text or binary format.
+ */
+static BOOL_T WriteLayout(
+		FILE * f,
+		BOOL_T binary )
+{
+	BOOL_T rc = TRUE;
+	if ( binary ) {
+		rc &= WriteTracksBinary( f, WriteLayoutHeader, TRUE );
+	} else {
+		rc &= WriteLayoutHeader( f );
+		rc &= WriteTracks( f, TRUE );
+		rc &= FilePrintf(f, "%s\n", END_TRK_FILE)>0;
+	}
+	return rc;
+}
+
+
 static BOOL_T DoSaveTracks(
 		const char * fileName )
 {
 	FILE * f;
-	time_t clock;
 	BOOL_T rc = TRUE;
 	char *oldLocale = NULL;
-
+	char * extOfFile;
+	BOOL_T binary;
+
+	extOfFile = FindFileExtension( (char*)fileName );
+	binary = ( extOfFile && strcmp( extOfFile, BINFILETYPEEXTENSION ) == 0 );
+	/* the binary format copies the layers which were not read */
+	if ( !binary )
+		LoadHiddenLayers( TRUE );
 	oldLocale = SaveLocale( "C" );
-
-	f = fopen( fileName, "w" );
+	f = fopen( fileName, binary?"wb":"w" );
 	if (f==NULL) {
 		RestoreLocale( oldLocale );
 
@@ -1030,24 +1437,12 @@ static BOOL_T DoSaveTracks(
 
 		return FALSE;
 	}
+	FileBuffer( f );
 	wSetCursor( mainD.d, wCursorWait );
-	time(&clock);
-	rc &= fprintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) )>0;
-	rc &= fprintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION )>0;
-	Stripcr( GetLayoutTitle() );
-	Stripcr( GetLayoutSubtitle() );
-	rc &= fprintf(f, "TITLE1 %s\n", GetLayoutTitle())>0;
-	rc &= fprintf(f, "TITLE2 %s\n", GetLayoutSubtitle())>0;
-	rc &= fprintf(f, "MAPSCALE %ld\n", (long)mapD.scale )>0;
-	rc &= fprintf(f, "ROOMSIZE %0.6f x %0.6f\n", mapD.size.x, mapD.size.y )>0;
-	rc &= fprintf(f, "SCALE %s\n", curScaleName )>0;
-	rc &= WriteLayers( f );
-	rc &= WriteMainNote( f );
-	rc &= WriteTracks( f, TRUE );
-	rc &= fprintf(f, "%s\n", END_TRK_FILE)>0;
+	rc &= WriteLayout( f, binary );
 	if ( !rc )
 		NoticeMessage( MSG_WRITE_FAILURE, _("Ok"), NULL, strerror(errno), fileName );
-	fclose(f);
+	FileClose(f);
 	bReadOnly = FALSE;
 
 	RestoreLocale( oldLocale );
@@ -1157,6 +1552,8 @@ static int SaveTracks(
 
 		SafeCreateDir(DependencyDir);
 
+		// A background from the archive the layout was loaded from is still in it
+		FetchBackGroundImage();
 		char * background = GetLayoutBackGroundFullPath();
 
 		if (background && background[0])
@@ -1199,6 +1596,7 @@ static int SaveTracks(
 	checkPtMark = changed = 0;
 
 	SetLayoutFullPath(fileName[0]);
+	UndoLogSaved( fileName[0] );
 
 	if (doAfterSave)
 		doAfterSave();
@@ -1266,27 +1664,63 @@ static wIndex_t generations_count = 0;
 wIndex_t max_generations_count = 10;
 static char sCheckPointBF[STR_LONG_SIZE];
 
+#define CHECKPOINT_SNAPSHOT_INTERVAL	(10)	/**< check points per full snapshot */
+#define CHECKPOINT_WRITER_TIMEOUT	(120)	/**< seconds before a snapshot writer is stopped */
+#define CHECKPOINT_WRITER_EXIT_WAIT	(5000)	/**< milliseconds to wait for it on exit */
+#define CHECKPOINT_WRITE_CHUNK		(256*1024)
+static int journalCheckPts = 0;
+
+
+/*
+ * A full snapshot is a binary layout file, so the sections of layers which
+ * were never read (see LoadHiddenLayers) are copied into it as they are.  It
+ * is formatted into memory on the main thread, and only writing it to a
+ * temporary file and syncing that to disk is left to a worker thread while
+ * editing goes on.  The track write functions use shared state, so the
+ * formatting itself can not move off the main thread.  Changes made
+ * meanwhile go to a new journal.  Only when the file is complete does it
+ * replace the check point file, and the new journal the old one; until then
+ * the old pair is there for recovery.  wAlarm has a single slot, which train animation and
+ * control triggers use, so the result is picked up at the next check point
+ * (and on exit) instead.  Where open_memstream is not available (WINDOWS)
+ * the snapshot is written on the main thread.
+ */
+typedef struct {
+		char * image;				/**< malloc'd by open_memstream */
+		size_t size;
+		const char * fileName;
+		volatile BOOL_T stop;		/**< set by the main thread to give up */
+		BOOL_T rc;
+		} checkPtSnapshot_t;
+static checkPtSnapshot_t checkPtSnapshot;
+static worker_p checkPtWriter = NULL;
+static time_t checkPtWriterStart;
 
-EXPORT void DoCheckPoint( void )
-{
-	int rc;
-
-	if (!checkPtFileNameBackup || (changed <= checkPtInterval+1)) {
-		sprintf(sCheckPointBF,"%s00.bkp",GetLayoutFilename());
-		MakeFullpath(&checkPtFileNameBackup, workingDir, sCheckPointBF, NULL);
-	}
 
-	if (checkPointingW == NULL) {
-		ParamRegister( &checkPointingPG );
-		checkPointingW = ParamCreateDialog( &checkPointingPG, MakeWindowTitle(_("Check Pointing")), NULL, NULL, NULL, FALSE, NULL, F_TOP|F_CENTER, NULL );
+/**
+ * Put the new check point file, written to checkPtFileNameTemp, in place
+ * and move the previous one to the next backup generation.  The old journal
+ * is removed first as it does not fit the new file.  If the new file could
+ * not be written the old one stays.
+ *
+ * \param rc IN the new file was written
+ * \return TRUE if the new file is in place
+ */
+static BOOL_T CheckPointWritten( BOOL_T rc )
+{
+	BOOL_T moved = FALSE;
+	if ( rc ) {
+		remove( checkPtFileNameJournal );
+		remove( checkPtFileName2 );
+#ifndef WINDOWS
+		/* keep the old file in place until the new one replaces it */
+		if ( link( checkPtFileName1, checkPtFileName2 ) != 0 )
+#endif
+			moved = ( rename( checkPtFileName1, checkPtFileName2 ) == 0 );
+		rc = ( rename( checkPtFileNameTemp, checkPtFileName1 ) == 0 );
 	}
-	rename( checkPtFileName1, checkPtFileName2 );
-	//wShow( checkPointingW );
-	rc = DoSaveTracks( checkPtFileName1 );
-
-	/* could the check point file be written ok? */
 	if( rc ) {
-		/* yes, archive/delete the backup copy of the checkpoint file */
+		/* archive/delete the backup copy of the checkpoint file */
 		if (checkPtFileNameBackup) {
 			char * spot = strrchr(checkPtFileNameBackup,'.');
 			if (spot && spot>checkPtFileNameBackup+3) {
@@ -1304,14 +1738,284 @@ EXPORT void DoCheckPoint( void )
 			remove(checkPtFileName2);
 		}
 	} else {
-		/* no, rename the backup copy back to the checkpoint file name */
-		rename( checkPtFileName2, checkPtFileName1 );
+		remove( checkPtFileNameTemp );
+		if ( moved )
+			rename( checkPtFileName2, checkPtFileName1 );
+	}
+	return rc;
+}
+
+
+/**
+ * Write a snapshot to the temporary file.  This runs on a worker thread, so it
+ * only uses stdio and the snapshot.
+ */
+static void CheckPointWriteJob( void * data )
+{
+	checkPtSnapshot_t * snap = (checkPtSnapshot_t*)data;
+	FILE * f;
+	size_t off, len;
+	BOOL_T rc;
+
+	f = fopen( snap->fileName, "wb" );
+	rc = ( f != NULL );
+	for ( off=0; rc && off<snap->size; off+=len ) {
+		len = snap->size-off;
+		if ( len > CHECKPOINT_WRITE_CHUNK )
+			len = CHECKPOINT_WRITE_CHUNK;
+		rc = !snap->stop && fwrite( snap->image+off, 1, len, f ) == len;
+	}
+	if ( f != NULL ) {
+		rc &= fflush( f ) == 0;
+#ifndef WINDOWS
+		rc &= fsync( fileno( f ) ) == 0;
+#endif
+		rc &= fclose( f ) == 0;
+	}
+	snap->rc = rc;
+}
+
+
+/**
+ * Collect the result of the check point writer if it has finished.
+ *
+ * \param wait IN milliseconds to wait for the writer to finish, 0 to poll
+ * \return TRUE if no writer is running anymore
+ */
+static BOOL_T CheckPointWriterDone( long wait )
+{
+	if ( checkPtWriter == NULL )
+		return TRUE;
+	if ( !WaitWorker( checkPtWriter, wait ) )
+		return FALSE;
+	checkPtWriter = NULL;
+	free( checkPtSnapshot.image );
+	checkPtSnapshot.image = NULL;
+	if ( CheckPointWritten( checkPtSnapshot.rc ) &&
+		 rename( checkPtFileNameJournalTemp, checkPtFileNameJournal ) == 0 )
+		return TRUE;
+	/* the next check point writes a snapshot again */
+	UndoJournalClose();
+	remove( checkPtFileNameJournalTemp );
+	return TRUE;
+}
+
+
+/**
+ * Format a snapshot in memory and start writing it to disk on a worker thread.
+ *
+ * \return FALSE if the snapshot could not be formatted or no thread started
+ */
+static BOOL_T StartCheckPointWriter( void )
+{
+#ifdef WINDOWS
+	return FALSE;
+#else
+	FILE * f;
+	char * oldLocale;
+	BOOL_T rc;
+
+	checkPtSnapshot.image = NULL;
+	checkPtSnapshot.size = 0;
+	f = open_memstream( &checkPtSnapshot.image, &checkPtSnapshot.size );
+	if ( f == NULL )
+		return FALSE;
+	oldLocale = SaveLocale( "C" );
+	/* this numbers the tracks as the snapshot has them, for the journal */
+	rc = WriteLayout( f, TRUE );
+	rc &= fclose( f ) == 0;
+	RestoreLocale( oldLocale );
+	checkPtSnapshot.fileName = checkPtFileNameTemp;
+	checkPtSnapshot.stop = FALSE;
+	checkPtSnapshot.rc = FALSE;
+	if ( rc )
+		checkPtWriter = StartWorker( CheckPointWriteJob, &checkPtSnapshot );
+	if ( checkPtWriter == NULL ) {
+		free( checkPtSnapshot.image );
+		checkPtSnapshot.image = NULL;
+		return FALSE;
+	}
+	checkPtWriterStart = time( NULL );
+	return TRUE;
+#endif
+}
+
+
+/**
+ * Write a snapshot to the temporary file on the main thread.
+ *
+ * \return FALSE on a write error
+ */
+static BOOL_T WriteCheckPoint( void )
+{
+	FILE * f;
+	char * oldLocale;
+	BOOL_T rc;
+
+	f = fopen( checkPtFileNameTemp, "wb" );
+	if ( f == NULL )
+		return FALSE;
+	oldLocale = SaveLocale( "C" );
+	FileBuffer( f );
+	wSetCursor( mainD.d, wCursorWait );
+	rc = WriteLayout( f, TRUE );
+	rc &= FileClose( f ) == 0;
+	wSetCursor( mainD.d, defaultCursor );
+	RestoreLocale( oldLocale );
+	return rc;
+}
+
+
+/**
+ * Save the layout for recovery after a crash.  Every change is appended to
+ * the journal by the undo system (see cundo.c) so most check points only
+ * have to note that.  A full snapshot is written, and the journal restarted,
+ * every CHECKPOINT_SNAPSHOT_INTERVAL check points or when the journal could
+ * not keep up.  The snapshot is written in the background where possible.
+ */
+EXPORT void DoCheckPoint( void )
+{
+	if ( !CheckPointWriterDone( 0 ) ) {
+		/* a writer which does not get on is stopped, and reports failure */
+		if ( time( NULL ) - checkPtWriterStart > CHECKPOINT_WRITER_TIMEOUT )
+			checkPtSnapshot.stop = TRUE;
+		return;
+	}
+	if ( UndoJournalActive() && ++journalCheckPts < CHECKPOINT_SNAPSHOT_INTERVAL )
+		return;
+	journalCheckPts = 0;
+	/* the old journal stays with the old snapshot */
+	UndoJournalClose();
+
+	if (!checkPtFileNameBackup || (changed <= checkPtInterval+1)) {
+		sprintf(sCheckPointBF,"%s00.bkp",GetLayoutFilename());
+		MakeFullpath(&checkPtFileNameBackup, workingDir, sCheckPointBF, NULL);
+	}
+
+	if ( StartCheckPointWriter() ) {
+		UndoJournalOpen( checkPtFileNameJournalTemp );
+		return;
+	}
+	if ( CheckPointWritten( WriteCheckPoint() ) )
+		UndoJournalOpen( checkPtFileNameJournal );
+}
+
+/*
+ * The clipboard is kept in memory as the text EditCopy writes, so paste does
+ * not go through the file system.  Every copy is also written to clipBoardN,
+ * for the next session and for other running instances.  It is written to a
+ * temporary file which is renamed over clipBoardN, so each copy gets a new
+ * file.  If clipBoardN is not the file our last copy left (its inode, size or
+ * time differ) another instance copied since, and its clipboard is pasted.
+ * Where open_memstream is not available the clipboard is the file.
+ */
+static char * clipBoardText = NULL;		/**< malloc'd by open_memstream, NUL terminated */
+static size_t clipBoardSize;
+static struct stat clipBoardStat;		/**< clipBoardN as our last copy left it */
+static BOOL_T clipBoardStatValid = FALSE;
+static char * clipBoardTempN;
+static char * clipBoardBuf;				/**< the stream being written */
+static size_t clipBoardBufSize;
+static BOOL_T clipBoardInMemory;
+
+
+static FILE * ClipBoardOpen( void )
+{
+	FILE * f;
+#ifndef WINDOWS
+	clipBoardBuf = NULL;
+	clipBoardBufSize = 0;
+	f = open_memstream( &clipBoardBuf, &clipBoardBufSize );
+	if ( f != NULL ) {
+		clipBoardInMemory = TRUE;
+		return f;
+	}
+#endif
+	clipBoardInMemory = FALSE;
+	f = fopen( clipBoardN, "w" );
+	if ( f != NULL )
+		FileBuffer( f );
+	return f;
+}
+
+
+/**
+ * Write the clipboard in memory to clipBoardN and note which file that is.
+ * If it can not be written the clipboard stays in memory, and only a file
+ * written later by another instance is pasted instead.
+ */
+static void ClipBoardSave( void )
+{
+	FILE * f;
+	BOOL_T rc;
+	f = fopen( clipBoardTempN, "w" );
+	if ( f != NULL ) {
+		rc = ( fwrite( clipBoardText, 1, clipBoardSize, f ) == clipBoardSize );
+		rc &= ( fclose( f ) == 0 );
+		if ( !rc || rename( clipBoardTempN, clipBoardN ) != 0 )
+			remove( clipBoardTempN );
+	}
+	clipBoardStatValid = ( stat( clipBoardN, &clipBoardStat ) == 0 );
+}
+
+
+static BOOL_T ClipBoardClose( FILE * f )
+{
+	BOOL_T rc = ( FileClose( f ) == 0 );
+	if ( !clipBoardInMemory ) {
+		/* the file is the clipboard now */
+		free( clipBoardText );
+		clipBoardText = NULL;
+		return rc;
+	}
+	if ( rc && clipBoardBuf != NULL ) {
+		free( clipBoardText );
+		clipBoardText = clipBoardBuf;
+		clipBoardSize = clipBoardBufSize;
+		ClipBoardSave();
+	} else {
+		free( clipBoardBuf );
+		rc = FALSE;
 	}
+	clipBoardBuf = NULL;
+	return rc;
+}
+
 
-	//wHide( checkPointingW );
-	wShow( mainW );
+/**
+ * TRUE if another instance wrote clipBoardN after our last copy.
+ */
+static BOOL_T ClipBoardFileNewer( void )
+{
+	struct stat buf;
+	if ( stat( clipBoardN, &buf ) != 0 )
+		return FALSE;
+	return !clipBoardStatValid ||
+		   buf.st_dev != clipBoardStat.st_dev ||
+		   buf.st_ino != clipBoardStat.st_ino ||
+		   buf.st_size != clipBoardStat.st_size ||
+		   buf.st_mtime != clipBoardStat.st_mtime;
 }
 
+
+/**
+ * Read the tracks on the clipboard.
+ *
+ * \return FALSE if the clipboard could not be read
+ */
+static BOOL_T ClipBoardRead( void )
+{
+	char * image;
+	if ( clipBoardText == NULL || ClipBoardFileNewer() )
+		return ReadTrackFile( clipBoardN, sClipboardF, FALSE, TRUE, FALSE );
+	/* the readers modify the image */
+	image = MyMalloc( clipBoardSize+1 );
+	memcpy( image, clipBoardText, clipBoardSize+1 );
+	ParamMapAdopt( image, clipBoardSize );
+	return ReadTrackMap( sClipboardF, FALSE, TRUE );
+}
+
+
 /**
  * Remove all temporary files before exiting. When the program terminates
  * normally through the exit choice, files and directories that were created
@@ -1326,6 +2030,17 @@ EXPORT void CleanupFiles( void )
 {
 	char *tempDir;
 
+	checkPtSnapshot.stop = TRUE;
+	if ( !CheckPointWriterDone( CHECKPOINT_WRITER_EXIT_WAIT ) ) {
+		/* the writer ends with the program */
+		UndoJournalClose();
+		remove( checkPtFileNameTemp );
+		remove( checkPtFileNameJournalTemp );
+	}
+	UndoLogClose();
+	UndoJournalClose();
+	if( checkPtFileNameJournal )
+		remove( checkPtFileNameJournal );
 	if( checkPtFileName1 ) {
 		if (checkPtFileNameBackup) {
 			remove( checkPtFileNameBackup );
@@ -1358,6 +2073,9 @@ EXPORT int ExistsCheckpoint( void )
 
 	MakeFullpath(&checkPtFileName1, workingDir, sCheckPointF, NULL);
 	MakeFullpath(&checkPtFileName2, workingDir, sCheckPoint1F, NULL);
+	MakeFullpath(&checkPtFileNameJournal, workingDir, sCheckPointJF, NULL);
+	MakeFullpath(&checkPtFileNameTemp, workingDir, sCheckPointTF, NULL);
+	MakeFullpath(&checkPtFileNameJournalTemp, workingDir, sCheckPointJTF, NULL);
 
 	if( !stat( checkPtFileName1, &fileStat ) ) {
 		return TRUE;
@@ -1378,6 +2096,7 @@ EXPORT int ExistsCheckpoint( void )
 EXPORT int LoadCheckpoint( BOOL_T sameName )
 {
 	char *search;
+	BOOL_T rc;
 
 	paramVersion = -1;
 	wSetCursor( mainD.d, wCursorWait );
@@ -1385,7 +2104,13 @@ EXPORT int LoadCheckpoint( BOOL_T sameName )
 	MakeFullpath(&search, workingDir, sCheckPointF, NULL);
 	UndoSuspend();
 
-	if (ReadTrackFile( search, search + strlen(search) - strlen( sCheckPointF ), TRUE, TRUE, TRUE )) {
+	readCheckPoint = TRUE;
+	rc = ReadTrackFile( search, search + strlen(search) - strlen( sCheckPointF ), TRUE, TRUE, TRUE );
+	readCheckPoint = FALSE;
+	if (rc) {
+		/* the changes made since the snapshot was written */
+		if ( checkPtFileNameJournal )
+			UndoJournalReplay( checkPtFileNameJournal );
 		ResolveIndex();
 		LayoutBackGroundInit(FALSE);    //Get Prior BackGround
 		LayoutBackGroundSave();		    //Save Background Values
@@ -1398,6 +2123,8 @@ EXPORT int LoadCheckpoint( BOOL_T sameName )
 			if (initialFile && strlen(initialFile)) {
 				SetCurrentPath( LAYOUTPATHKEY, initialFile );
 				SetLayoutFullPath(initialFile);
+				if ( ! bExample )
+					UndoLogOpen( initialFile, TRUE );
 			}
 		} else SetLayoutFullPath("");
 
@@ -1523,14 +2250,15 @@ static int DoExportTracks(
 
 	oldLocale = SaveLocale("C");
 
+	FileBuffer( f );
 	wSetCursor( mainD.d, wCursorWait );
 	time(&clock);
-	fprintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) );
-	fprintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION );
+	FilePrintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) );
+	FilePrintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION );
 	coOrd offset;
 	ExportTracks( f , &offset);
-	fprintf(f, "%s\n", END_TRK_FILE);
-	fclose(f);
+	FilePrintf(f, "%s\n", END_TRK_FILE);
+	FileClose(f);
 
 	RestoreLocale( oldLocale );
 
@@ -1560,12 +2288,13 @@ EXPORT BOOL_T EditCopy( void )
 	FILE * f;
 	time_t clock;
 	char *oldLocale = NULL;
+	BOOL_T rc;
 
 	if (selectedTrackCount <= 0) {
 		ErrorMessage( MSG_NO_SELECTED_TRK );
 		return FALSE;
 	}
-	f = fopen( clipBoardN, "w" );
+	f = ClipBoardOpen();
 	if (f == NULL) {
 		NoticeMessage( MSG_OPEN_FAIL, _("Continue"), NULL, _("Clipboard"), clipBoardN, strerror(errno) );
 		return FALSE;
@@ -1574,14 +2303,16 @@ EXPORT BOOL_T EditCopy( void )
 	oldLocale = SaveLocale("C");
 
 	time(&clock);
-	fprintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) );
-	fprintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION );
+	FilePrintf(f,"#%s Version: %s, Date: %s\n", sProdName, sVersion, ctime(&clock) );
+	FilePrintf(f, "VERSION %d %s\n", iParamVersion, PARAMVERSIONVERSION );
 	ExportTracks(f, &paste_offset);
-	fprintf(f, "%s\n", END_TRK_FILE );
+	FilePrintf(f, "%s\n", END_TRK_FILE );
 	RestoreLocale(oldLocale);
-	fclose(f);
+	rc = ClipBoardClose(f);
+	if ( !rc )
+		NoticeMessage( MSG_WRITE_FAILURE, _("Ok"), NULL, strerror(errno), clipBoardN );
 
-	return TRUE;
+	return rc;
 }
 
 
@@ -1595,8 +2326,8 @@ EXPORT BOOL_T EditCut( void )
 
 
 /**
- * Paste clipboard content. XTrackCAD uses a disk file as clipboard replacement. This file is read and the
- * content is inserted.
+ * Paste clipboard content. The clipboard is kept in memory, or in a disk file, see ClipBoardOpen. It is
+ * read and the content is inserted.
  *
  * \return    TRUE if success, FALSE on error (file not found)
  */
@@ -1622,7 +2353,7 @@ BOOL_T EditPastePlace( wBool_t inPlace )
 	ImportStart();
 	UndoStart( _("Paste"), "paste" );
 	useCurrentLayer = TRUE;
-	if ( !ReadTrackFile( clipBoardN, sClipboardF, FALSE, TRUE, FALSE ) ) {
+	if ( !ClipBoardRead() ) {
 		NoticeMessage( MSG_CANT_PASTE, _("Continue"), NULL );
 		rc = FALSE;
 	}
@@ -1669,5 +2400,6 @@ EXPORT void FileInit( void )
 
 	SetLayoutFullPath("");
 		MakeFullpath(&clipBoardN, workingDir, sClipboardF, NULL);
+		MakeFullpath(&clipBoardTempN, workingDir, sClipboardTF, NULL);
 
 }
@@ -30,7 +30,7 @@
 extern FILE * paramFile;
 extern char *paramFileName;
 extern wIndex_t paramLineNum;
-extern char paramLine[STR_HUGE_SIZE];
+extern char * paramLine;
 extern char * curContents;
 extern char * curSubContents;
 #define PARAM_DEMO (-1)
@@ -62,6 +62,7 @@ extern int curDemo;
 extern wMenuList_p fileList_ml;
 
 #define ZIPFILETYPEEXTENSION "xtce"
+#define BINFILETYPEEXTENSION "xtcb"
 
 #define PARAM_SUBDIR "params"
 
@@ -86,6 +87,7 @@ dynArr_t paramProc_da;
 
 void Stripcr( char * );
 char * GetNextLine( void );
+BOOL_T ReadTrackText( char *, size_t );
 
 #define END_TRK_FILE	"END$TRACKS"
 #define END_BLOCK	"END$BLOCK"
@@ -0,0 +1,544 @@
+/** \file fmtnum.c
+ * Locale independent, fast number formatting for writing layout files
+ *
+ * Saving a layout writes every coordinate with "%0.6f" or "%0.3f", and with
+ * fprintf most of the time goes into the general purpose formatter and stream
+ * locking.  FilePrintf understands the conversions the writers use, formats
+ * them itself into a local buffer and passes the result to the stream in one
+ * piece.  The output is the same as printf's in the "C" locale, anything it
+ * does not handle itself is passed on to snprintf.
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <locale.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmtnum.h"
+
+/* Powers of ten which are exact in a double */
+static const double pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+#define MAX_FAST_PRECISION	(9)
+#define MAX_FAST_VALUE		(4503599627370496.0)	/* 2^52 */
+
+#define OUT_SIZE		(1024)
+#define SPEC_SIZE		(32)
+#define FIELD_SIZE		(64)
+
+/**
+ * Replace the decimal point of the current locale with '.'.
+ */
+static void FixDecimalPoint( char * buf )
+{
+	const char * dp = localeconv()->decimal_point;
+	if ( dp == NULL || dp[0] == '.' || dp[0] == '\0' || dp[1] != '\0' )
+		return;
+	for ( ; *buf; buf++ )
+		if ( *buf == dp[0] )
+			*buf = '.';
+}
+
+
+/**
+ * Format a number like snprintf( buf, size, "%0.*f", precision, value ) in
+ * the "C" locale.  The result is exact: values which can not be rounded
+ * safely from a scaled binary product are passed to snprintf.
+ *
+ * \param buf OUT the text
+ * \param size IN size of buf
+ * \param value IN the number
+ * \param precision IN digits after the decimal point, 6 if negative
+ * \return the length of the text, which is truncated if it is size or more
+ */
+int FormatFixed( char * buf, size_t size, double value, int precision )
+{
+	char tmp[FIELD_SIZE];
+	char * cp;
+	double scaled, whole, frac;
+	uint64_t digits;
+	int len;
+
+	if ( precision < 0 )
+		precision = 6;
+	if ( precision > MAX_FAST_PRECISION || !isfinite( value ) )
+		goto slow;
+	scaled = fabs( value ) * pow10[precision];
+	if ( scaled >= MAX_FAST_VALUE )
+		goto slow;
+	whole = floor( scaled );
+	frac = scaled - whole;
+	/* The product is off by half an ulp at most; ties go to snprintf */
+	if ( fabs( frac - 0.5 ) <= scaled * 0x1p-51 )
+		goto slow;
+	digits = (uint64_t)whole + ( frac > 0.5 ? 1 : 0 );
+
+	cp = tmp + sizeof tmp;
+	len = 0;
+	do {
+		*--cp = '0' + (char)( digits % 10 );
+		digits /= 10;
+		if ( ++len == precision )
+			*--cp = '.';
+	} while ( digits != 0 || len <= precision );
+	if ( signbit( value ) )
+		*--cp = '-';
+	len = (int)( tmp + sizeof tmp - cp );
+	if ( size > 0 ) {
+		size_t n = (size_t)len < size ? (size_t)len : size-1;
+		memcpy( buf, cp, n );
+		buf[n] = '\0';
+	}
+	return len;
+
+slow:
+	len = snprintf( buf, size, "%0.*f", precision, value );
+	if ( size > 0 )
+		FixDecimalPoint( buf );
+	return len;
+}
+
+
+/*
+ * FilePrintf
+ */
+
+typedef struct {
+		FILE * f;
+		int len;
+		int cnt;
+		int err;
+		char buf[OUT_SIZE];
+		} out_t;
+
+static void OutFlush( out_t * out )
+{
+	if ( out->len > 0 &&
+		 fwrite( out->buf, 1, out->len, out->f ) != (size_t)out->len )
+		out->err = 1;
+	out->cnt += out->len;
+	out->len = 0;
+}
+
+static void OutPut( out_t * out, const char * str, size_t len )
+{
+	if ( out->len + len > OUT_SIZE ) {
+		OutFlush( out );
+		if ( len > OUT_SIZE ) {
+			if ( fwrite( str, 1, len, out->f ) != len )
+				out->err = 1;
+			out->cnt += (int)len;
+			return;
+		}
+	}
+	memcpy( out->buf+out->len, str, len );
+	out->len += (int)len;
+}
+
+static void OutPad( out_t * out, char c, int cnt )
+{
+	while ( cnt-- > 0 ) {
+		if ( out->len >= OUT_SIZE )
+			OutFlush( out );
+		out->buf[out->len++] = c;
+	}
+}
+
+/**
+ * Write a field padded to width.  Zero padding goes between the sign and the
+ * digits.
+ */
+static void OutField( out_t * out, const char * str, size_t len, int width, int left, int zero )
+{
+	int pad = width - (int)len;
+	if ( pad <= 0 ) {
+		OutPut( out, str, len );
+	} else if ( left ) {
+		OutPut( out, str, len );
+		OutPad( out, ' ', pad );
+	} else if ( zero ) {
+		if ( len > 0 && str[0] == '-' ) {
+			OutPut( out, str, 1 );
+			str++;
+			len--;
+		}
+		OutPad( out, '0', pad );
+		OutPut( out, str, len );
+	} else {
+		OutPad( out, ' ', pad );
+		OutPut( out, str, len );
+	}
+}
+
+/**
+ * Format an integer with at least precision digits.
+ */
+static int FormatInteger( char * buf, unsigned long long val, int neg, int base, int upper, int precision )
+{
+	const char * digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char tmp[FIELD_SIZE];
+	char * cp = tmp + sizeof tmp;
+	int len = 0;
+
+	if ( precision < 0 )
+		precision = 1;
+	if ( precision > FIELD_SIZE-2 )
+		precision = FIELD_SIZE-2;
+	while ( val != 0 ) {
+		*--cp = digits[val % base];
+		val /= base;
+		len++;
+	}
+	while ( len < precision ) {
+		*--cp = '0';
+		len++;
+	}
+	if ( neg ) {
+		*--cp = '-';
+		len++;
+	}
+	memcpy( buf, cp, len );
+	return len;
+}
+
+/**
+ * Format a field with snprintf.  Only used for conversions the writers do not
+ * use.
+ *
+ * \param out IN/OUT output buffer
+ * \param spec IN the '%' starting the field
+ * \param flagsEnd IN end of the flags
+ * \param cp IN start of the length modifiers
+ * \param width IN field width
+ * \param left IN left align, also when only a negative '*' width asked for it
+ * \param precision IN precision, negative if none
+ * \param ap IN/OUT the arguments
+ * \return the conversion character
+ */
+static const char * FallbackField( out_t * out, const char * spec, const char * flagsEnd, const char * cp, int width, int left, int precision, va_list * ap )
+{
+	char fmt[SPEC_SIZE];
+	char field[FIELD_SIZE];
+	char * buf = field;
+	const char * lenStart = cp;
+	int size = sizeof field;
+	int len = 0;
+	int inx;
+	char conv;
+	enum { A_INT, A_LONG, A_LLONG, A_DOUBLE, A_LDOUBLE, A_PTR } type;
+	long long i = 0;
+	double d = 0.0;
+	long double ld = 0.0;
+	void * p = NULL;
+
+	while ( *cp != '\0' && strchr( "hlzjtLq", *cp ) )
+		cp++;
+	conv = *cp;
+	if ( conv == '\0' || flagsEnd-spec + cp-lenStart + 6 > SPEC_SIZE ) {
+		OutPut( out, spec, cp-spec );
+		return cp;
+	}
+	inx = snprintf( fmt, sizeof fmt, "%.*s%s*.*", (int)( flagsEnd-spec ), spec, left ? "-" : "" );
+	inx += snprintf( fmt+inx, sizeof fmt - inx, "%.*s%c", (int)( cp-lenStart ), lenStart, conv );
+
+	switch ( conv ) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+		if ( strstr( fmt, "ll" ) || strchr( fmt, 'q' ) || strchr( fmt, 'j' ) ) {
+			type = A_LLONG;
+			i = va_arg( *ap, long long );
+		} else if ( strchr( fmt, 'l' ) || strchr( fmt, 'z' ) || strchr( fmt, 't' ) ) {
+			type = A_LONG;
+			i = va_arg( *ap, long );
+		} else {
+			type = A_INT;
+			i = va_arg( *ap, int );
+		}
+		break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+		if ( strchr( fmt, 'L' ) ) {
+			type = A_LDOUBLE;
+			ld = va_arg( *ap, long double );
+		} else {
+			type = A_DOUBLE;
+			d = va_arg( *ap, double );
+		}
+		break;
+	case 's': case 'p':
+		type = A_PTR;
+		p = va_arg( *ap, void * );
+		break;
+	default:
+		OutPut( out, spec, cp+1-spec );
+		return cp;
+	}
+
+	for ( ;; ) {
+		switch ( type ) {
+		case A_INT:		len = snprintf( buf, size, fmt, width, precision, (int)i ); break;
+		case A_LONG:	len = snprintf( buf, size, fmt, width, precision, (long)i ); break;
+		case A_LLONG:	len = snprintf( buf, size, fmt, width, precision, i ); break;
+		case A_DOUBLE:	len = snprintf( buf, size, fmt, width, precision, d ); break;
+		case A_LDOUBLE:	len = snprintf( buf, size, fmt, width, precision, ld ); break;
+		case A_PTR:		len = snprintf( buf, size, fmt, width, precision, p ); break;
+		}
+		if ( len < 0 || len < size || buf != field )
+			break;
+		size = len+1;
+		buf = malloc( size );
+		if ( buf == NULL )
+			break;
+	}
+	if ( buf == NULL || len < 0 ) {
+		out->err = 1;
+	} else {
+		if ( type == A_DOUBLE || type == A_LDOUBLE )
+			FixDecimalPoint( buf );
+		OutPut( out, buf, len );
+	}
+	if ( buf != field )
+		free( buf );
+	return cp;
+}
+
+/**
+ * Drop in replacement for fprintf.
+ *
+ * The flags '-' and '0', field width and precision (also as '*') and the
+ * lengths 'l' and 'll' are handled for the conversions d, i, u, x, X, c, s,
+ * f, F and %.  Other conversions and flags are formatted with snprintf.
+ * Floating point numbers are always written with a '.'.
+ *
+ * \param f IN the stream
+ * \param format IN printf format
+ * \return number of characters written, or a negative number on error
+ */
+int FilePrintf( FILE * f, const char * format, ... )
+{
+	out_t out;
+	va_list ap;
+	const char * cp;
+	char field[FIELD_SIZE];
+
+	out.f = f;
+	out.len = 0;
+	out.cnt = 0;
+	out.err = 0;
+	va_start( ap, format );
+	while ( *format ) {
+		const char * spec, * flagsEnd, * lenStart;
+		int left = 0, zero = 0, other = 0;
+		int width = 0, precision = -1;
+		int lng = 0;
+		int len;
+
+		for ( cp = format; *cp && *cp != '%'; cp++ );
+		if ( cp != format )
+			OutPut( &out, format, cp-format );
+		if ( *cp == '\0' )
+			break;
+		spec = cp++;
+
+		for ( ;; cp++ ) {
+			if ( *cp == '-' )
+				left = 1;
+			else if ( *cp == '0' )
+				zero = 1;
+			else if ( *cp == '+' || *cp == ' ' || *cp == '#' )
+				other = 1;
+			else
+				break;
+		}
+		flagsEnd = cp;
+		if ( *cp == '*' ) {
+			width = va_arg( ap, int );
+			if ( width < 0 ) {
+				left = 1;
+				width = -width;
+			}
+			cp++;
+		} else {
+			while ( *cp >= '0' && *cp <= '9' )
+				width = width*10 + (*cp++ - '0');
+		}
+		if ( *cp == '.' ) {
+			cp++;
+			precision = 0;
+			if ( *cp == '*' ) {
+				precision = va_arg( ap, int );
+				cp++;
+			} else {
+				while ( *cp >= '0' && *cp <= '9' )
+					precision = precision*10 + (*cp++ - '0');
+			}
+		}
+		lenStart = cp;
+		while ( *cp == 'l' ) {
+			lng++;
+			cp++;
+		}
+		if ( strchr( "hzjtLq", *cp ) && *cp != '\0' )
+			other = 1;
+		if ( strchr( "diuxXcsfF%", *cp ) == NULL )
+			other = 1;
+		if ( left )
+			zero = 0;
+
+		if ( other ) {
+			cp = FallbackField( &out, spec, flagsEnd, lenStart, width, left, precision, &ap );
+			if ( *cp == '\0' )
+				break;
+			format = cp+1;
+			continue;
+		}
+
+		switch ( *cp ) {
+		case 'd':
+		case 'i':
+			{
+				long long val;
+				if ( lng >= 2 )
+					val = va_arg( ap, long long );
+				else if ( lng == 1 )
+					val = va_arg( ap, long );
+				else
+					val = va_arg( ap, int );
+				len = FormatInteger( field, val<0 ? 0ULL-(unsigned long long)val : (unsigned long long)val,
+								val<0, 10, 0, precision );
+				OutField( &out, field, len, width, left, zero && precision < 0 );
+			}
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			{
+				unsigned long long val;
+				if ( lng >= 2 )
+					val = va_arg( ap, unsigned long long );
+				else if ( lng == 1 )
+					val = va_arg( ap, unsigned long );
+				else
+					val = va_arg( ap, unsigned int );
+				len = FormatInteger( field, val, 0, *cp=='u'?10:16, *cp=='X', precision );
+				OutField( &out, field, len, width, left, zero && precision < 0 );
+			}
+			break;
+		case 'c':
+			field[0] = (char)va_arg( ap, int );
+			OutField( &out, field, 1, width, left, 0 );
+			break;
+		case 's':
+			{
+				const char * str = va_arg( ap, const char * );
+				size_t slen;
+				if ( str == NULL )
+					str = "(null)";
+				if ( precision >= 0 ) {
+					const char * end = memchr( str, '\0', precision );
+					slen = end ? (size_t)( end-str ) : (size_t)precision;
+				} else {
+					slen = strlen( str );
+				}
+				OutField( &out, str, slen, width, left, 0 );
+			}
+			break;
+		case 'f':
+		case 'F':
+			{
+				double val = va_arg( ap, double );
+				char * buf = field;
+				len = FormatFixed( field, sizeof field, val, precision );
+				if ( len >= (int)sizeof field ) {
+					buf = malloc( len+1 );
+					if ( buf == NULL ) {
+						out.err = 1;
+						break;
+					}
+					FormatFixed( buf, len+1, val, precision );
+				}
+				if ( *cp == 'F' && !isfinite( val ) ) {
+					int inx;
+					for ( inx=0; inx<len; inx++ )
+						if ( buf[inx] >= 'a' && buf[inx] <= 'z' )
+							buf[inx] -= 'a'-'A';
+				}
+				OutField( &out, buf, len, width, left, zero && isfinite( val ) );
+				if ( buf != field )
+					free( buf );
+			}
+			break;
+		case '%':
+			OutPut( &out, "%", 1 );
+			break;
+		case '\0':
+			OutPut( &out, spec, cp-spec );
+			cp--;
+			break;
+		default:
+			OutPut( &out, spec, cp+1-spec );
+			break;
+		}
+		format = cp+1;
+	}
+	va_end( ap );
+	OutFlush( &out );
+	return out.err ? -1 : out.cnt;
+}
+
+
+/**
+ * Give a stream opened for writing a large buffer.  There is only one such
+ * buffer, a second stream opened while the first is still open keeps the
+ * default buffering.  The stream must be closed with FileClose.
+ *
+ * \param f IN the stream, just opened
+ */
+static char * fileBuffer = NULL;
+static FILE * fileBufferOwner = NULL;
+
+void FileBuffer( FILE * f )
+{
+	if ( f == NULL || fileBufferOwner != NULL )
+		return;
+	if ( fileBuffer == NULL ) {
+		fileBuffer = malloc( FMTNUM_FILE_BUFFER );
+		if ( fileBuffer == NULL )
+			return;
+	}
+	if ( setvbuf( f, fileBuffer, _IOFBF, FMTNUM_FILE_BUFFER ) == 0 )
+		fileBufferOwner = f;
+}
+
+
+/**
+ * Close a stream and release its buffer.
+ *
+ * \param f IN the stream
+ * \return as fclose
+ */
+int FileClose( FILE * f )
+{
+	int rc = fclose( f );
+	if ( f == fileBufferOwner )
+		fileBufferOwner = NULL;
+	return rc;
+}
@@ -0,0 +1,35 @@
+/** \file fmtnum.h
+ * Locale independent, fast number formatting for writing layout files
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HAVE_FMTNUM_H
+#define HAVE_FMTNUM_H
+
+#include <stdio.h>
+
+#define FMTNUM_FILE_BUFFER	(256*1024)
+
+int FormatFixed( char * buf, size_t size, double value, int precision );
+int FilePrintf( FILE * f, const char * format, ... );
+void FileBuffer( FILE * f );
+int FileClose( FILE * f );
+
+#endif // !HAVE_FMTNUM_H
@@ -25,7 +25,9 @@
 #include <dynstring.h>
 #include <assert.h>
 
+#include "archive.h"
 #include "custom.h"
+#include "directory.h"
 #include "i18n.h"
 #include "layout.h"
 #include "misc2.h"
@@ -425,6 +427,82 @@ EXPORT int LoadImageFile(
 		return FALSE;
 }
 
+/*
+ * A background image in a layout archive is only taken out of the archive
+ * and decoded when it is first shown, or when the layout is saved.
+ */
+static char * backgroundPending = NULL;		/**< file the image goes to */
+static char * backgroundArchive = NULL;
+static char * backgroundEntry = NULL;
+
+static void ClearPendingImage( void )
+{
+	MyFree(backgroundPending);
+	MyFree(backgroundArchive);
+	MyFree(backgroundEntry);
+	backgroundPending = backgroundArchive = backgroundEntry = NULL;
+}
+
+/*******************************************************
+* Use an image in a layout archive as the background, see
+* FetchBackGroundImage
+*
+* \param fileName IN the file the image will be extracted to
+* \param archive IN the archive
+* \param entry IN the name of the image in the archive
+*/
+EXPORT void LoadImageFromArchive(
+		const char * fileName,
+		const char * archive,
+		const char * entry )
+{
+		ClearPendingImage();
+		backgroundPending = MyStrdup(fileName);
+		backgroundArchive = MyStrdup(archive);
+		backgroundEntry = MyStrdup(entry);
+		SetLayoutBackGroundFullPath(fileName);
+		backgroundVisible = TRUE;
+		wControlActive((wControl_p)backgroundB, backgroundVisible);
+		wButtonSetBusy(backgroundB, backgroundVisible);
+
+		SetName();
+		file_changed = TRUE;
+		ParamLoadControl(layout_pg_p, 8);
+}
+
+/*******************************************************
+* Extract and load the background image given to LoadImageFromArchive if
+* that has not been done yet
+*
+* \return FALSE if the image could not be loaded
+*/
+EXPORT BOOL_T FetchBackGroundImage(void)
+{
+		BOOL_T rc = TRUE;
+		char * dir;
+
+		if (backgroundPending == NULL)
+			return TRUE;
+		/* unless another background was chosen meanwhile */
+		if (strcmp(GetLayoutBackGroundFullPath(), backgroundPending) == 0) {
+			dir = MyStrdup(backgroundPending);
+			*FindFilename(dir) = '\0';
+			rc = SafeCreateDir(dir) &&
+				 ExtractArchiveEntry(backgroundArchive, backgroundEntry, backgroundPending) &&
+				 LoadBackGroundImage();
+			MyFree(dir);
+			if (!rc) {
+				SetLayoutBackGroundFullPath(noname);
+				backgroundVisible = FALSE;
+				wControlActive((wControl_p)backgroundB, backgroundVisible);
+				wButtonSetBusy(backgroundB, backgroundVisible);
+				SetName();
+			}
+		}
+		ClearPendingImage();
+		return rc;
+}
+
 /**********************************************************
  * Save the Background Parms - forcing a write
  */
@@ -71,4 +71,6 @@ void LayoutBackGroundSave(void);
 void BackgroundToggleShow(void);
 void DoLayout(void * junk);
 int LoadImageFile(int files,char ** fileName,void * data );
+void LoadImageFromArchive(const char * fileName, const char * archive, const char * entry);
+BOOL_T FetchBackGroundImage(void);
 #endif
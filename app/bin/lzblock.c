@@ -0,0 +1,217 @@
+/** \file lzblock.c
+ * Fast compression of small blocks of memory
+ *
+ * A byte oriented LZ77 compressor in the style of LZ4, for data which is
+ * compressed once and seldom read back, such as old undo records.  Raw copies
+ * of tracks are mostly zeros, small integers and repeated pointers, which
+ * this handles well at memory speed.
+ *
+ * The output is a list of sequences:
+ *
+ *	token literals offset(2) [match length]
+ *
+ * The high nibble of the token is the number of literals and the low nibble
+ * the match length less LZ_MIN_MATCH.  A nibble of 15 is followed by bytes
+ * which are added to it, up to and including the first byte less than 255.
+ * The offset counts back from the current position.  The last sequence has
+ * only literals.
+ */
+
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lzblock.h"
+
+#define LZ_MIN_MATCH		(4)
+#define LZ_MAX_OFFSET		(65535)
+#define LZ_HASH_BITS		(12)
+#define LZ_HASH(V)			((uint32_t)((V)*2654435761U) >> (32-LZ_HASH_BITS))
+
+static uint32_t Get32( const unsigned char * p )
+{
+	uint32_t val;
+	memcpy( &val, p, sizeof val );
+	return val;
+}
+
+
+/* Write a length which did not fit into its nibble */
+static unsigned char * PutLength( unsigned char * op, unsigned char * oend, int len )
+{
+	for ( ; len >= 255; len -= 255 ) {
+		if ( op >= oend )
+			return NULL;
+		*op++ = 255;
+	}
+	if ( op >= oend )
+		return NULL;
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+
+static unsigned char * PutSequence(
+		unsigned char * op,
+		unsigned char * oend,
+		const unsigned char * lit,
+		int litLen,
+		int offset,
+		int matchLen )
+{
+	unsigned char * token;
+	if ( op >= oend )
+		return NULL;
+	token = op++;
+	*token = (unsigned char)( ( litLen < 15 ? litLen : 15 ) << 4 );
+	if ( litLen >= 15 && (op = PutLength( op, oend, litLen-15 )) == NULL )
+		return NULL;
+	if ( oend-op < litLen )
+		return NULL;
+	memcpy( op, lit, litLen );
+	op += litLen;
+	if ( matchLen == 0 )
+		return op;
+	if ( oend-op < 2 )
+		return NULL;
+	*op++ = (unsigned char)( offset & 0xFF );
+	*op++ = (unsigned char)( offset >> 8 );
+	matchLen -= LZ_MIN_MATCH;
+	*token |= (unsigned char)( matchLen < 15 ? matchLen : 15 );
+	if ( matchLen >= 15 && (op = PutLength( op, oend, matchLen-15 )) == NULL )
+		return NULL;
+	return op;
+}
+
+
+/**
+ * Compress a block.
+ *
+ * \param src IN the data
+ * \param srcSize IN size of the data
+ * \param dst OUT the compressed data
+ * \param dstSize IN size of dst
+ * \return the size of the compressed data, 0 if it does not fit in dst
+ */
+int LzCompress( const char * src, int srcSize, char * dst, int dstSize )
+{
+	const unsigned char * ip = (const unsigned char *)src;
+	const unsigned char * iend = ip + srcSize;
+	const unsigned char * mlimit = iend - LZ_MIN_MATCH;
+	const unsigned char * anchor = ip;
+	unsigned char * op = (unsigned char *)dst;
+	unsigned char * oend = op + dstSize;
+	int hash[1<<LZ_HASH_BITS];
+	int inx;
+
+	for ( inx=0; inx<(1<<LZ_HASH_BITS); inx++ )
+		hash[inx] = -1;
+	while ( ip <= mlimit ) {
+		uint32_t val = Get32( ip );
+		uint32_t h = LZ_HASH( val );
+		int cand = hash[h];
+		const unsigned char * ref;
+		const unsigned char * mp;
+		hash[h] = (int)( ip - (const unsigned char *)src );
+		if ( cand < 0 ) {
+			ip++;
+			continue;
+		}
+		ref = (const unsigned char *)src + cand;
+		if ( ip-ref > LZ_MAX_OFFSET || Get32( ref ) != val ) {
+			ip++;
+			continue;
+		}
+		for ( mp=ip+LZ_MIN_MATCH, ref+=LZ_MIN_MATCH; mp<iend && *mp==*ref; mp++, ref++ );
+		op = PutSequence( op, oend, anchor, (int)( ip-anchor ),
+						  (int)( mp-ref ), (int)( mp-ip ) );
+		if ( op == NULL )
+			return 0;
+		ip = anchor = mp;
+	}
+	op = PutSequence( op, oend, anchor, (int)( iend-anchor ), 0, 0 );
+	if ( op == NULL )
+		return 0;
+	return (int)( op - (unsigned char *)dst );
+}
+
+
+/* Read a length which did not fit into its nibble */
+static const unsigned char * GetLength( const unsigned char * ip, const unsigned char * iend, int * len )
+{
+	unsigned char b;
+	do {
+		if ( ip >= iend )
+			return NULL;
+		b = *ip++;
+		*len += b;
+	} while ( b == 255 );
+	return ip;
+}
+
+
+/**
+ * Decompress a block made by LzCompress.
+ *
+ * \param src IN the compressed data
+ * \param srcSize IN size of the compressed data
+ * \param dst OUT the data
+ * \param dstSize IN size of dst
+ * \return the size of the data, -1 if src is bad or dst is too small
+ */
+int LzDecompress( const char * src, int srcSize, char * dst, int dstSize )
+{
+	const unsigned char * ip = (const unsigned char *)src;
+	const unsigned char * iend = ip + srcSize;
+	unsigned char * op = (unsigned char *)dst;
+	unsigned char * oend = op + dstSize;
+	const unsigned char * ref;
+	int litLen, matchLen, offset;
+
+	while ( ip < iend ) {
+		unsigned char token = *ip++;
+		litLen = token >> 4;
+		if ( litLen == 15 && (ip = GetLength( ip, iend, &litLen )) == NULL )
+			return -1;
+		if ( iend-ip < litLen || oend-op < litLen )
+			return -1;
+		memcpy( op, ip, litLen );
+		ip += litLen;
+		op += litLen;
+		if ( ip == iend )
+			break;
+		if ( iend-ip < 2 )
+			return -1;
+		offset = ip[0] | (ip[1]<<8);
+		ip += 2;
+		matchLen = token & 15;
+		if ( matchLen == 15 && (ip = GetLength( ip, iend, &matchLen )) == NULL )
+			return -1;
+		matchLen += LZ_MIN_MATCH;
+		if ( offset == 0 || offset > op-(unsigned char *)dst || oend-op < matchLen )
+			return -1;
+		/* the match may overlap the output, so copy bytewise */
+		for ( ref=op-offset; matchLen>0; matchLen-- )
+			*op++ = *ref++;
+	}
+	return (int)( op - (unsigned char *)dst );
+}
@@ -850,6 +850,9 @@ static BOOL_T DoRegression( char * sFileName )
 		bWroteActualTracks = FALSE;
 		track_p to_first_save = to_first;
 		track_p* to_last_save = to_last;
+		// Expected tracks are indexed separately from the Actual tracks
+		dynArr_t trackIndex_save = trackIndex_da;
+		memset( &trackIndex_da, 0, sizeof trackIndex_da );
 		while ( GetNextLine() ) {
 			if ( paramLine[0] == '#' )
 				continue;
@@ -858,8 +861,11 @@ static BOOL_T DoRegression( char * sFileName )
 			to_last = &to_first;
 			paramVersion = regressVersion;
 			if ( !ReadTrack( paramLine ) ) {
-				if ( paramFile == NULL )
+				if ( paramFile == NULL ) {
+					DYNARR_FREE( track_p, trackIndex_da );
+					trackIndex_da = trackIndex_save;
 					return FALSE;
+				}
 				break;
 			}
 			if ( to_first == NULL ) {
@@ -869,7 +875,10 @@ static BOOL_T DoRegression( char * sFileName )
 			track_cp tExpected = to_first;
 			to_first = to_first_save;
 			// Find corresponding Actual track
+			dynArr_t trackIndexExpected = trackIndex_da;
+			trackIndex_da = trackIndex_save;
 			track_cp tActual = FindTrack( GetTrkIndex( tExpected ) );
+			trackIndex_da = trackIndexExpected;
 			strcat( message, "Regression " );
 			if ( ! CompareTrack( tActual, tExpected ) ) {
 				// Actual doesn't match Expected
@@ -913,6 +922,8 @@ static BOOL_T DoRegression( char * sFileName )
 		}
 		to_first = to_first_save;
 		to_last = to_last_save;
+		DYNARR_FREE( track_p, trackIndex_da );
+		trackIndex_da = trackIndex_save;
 		if ( strncmp( paramLine, "REGRESSION END", 14 ) != 0 )
 			InputError( "Expected REGRESSION END", TRUE );
 		paramVersion = oldParamVersion;
@@ -930,6 +941,91 @@ static BOOL_T DoRegression( char * sFileName )
 	return TRUE;
 }
 
+/*
+ * Round trip the current tracks through the binary layout format (trkbin.c)
+ * and compare what is read back with the originals.  Only done when
+ * regression checking is on.
+ */
+static BOOL_T DoRegressionBinary( char * sFileName )
+{
+	char * sBinaryFile = NULL;
+	char * sRegressionFile = NULL;
+	FILE * f;
+	FILE * fRegression;
+	char * image;
+	long size;
+	long oldParamVersion = paramVersion;
+	TRKINX_T oldMaxIndex = max_index;
+	long oldMaxSeq = max_seq;
+	int failCnt = 0;
+	track_p trk, next;
+
+	if ( log_regression <= 0 || logTable(log_regression).level <= 0 )
+		return TRUE;
+	MakeFullpath( &sBinaryFile, workingDir, "xtrkcad.regress.xtcb", NULL );
+	f = fopen( sBinaryFile, "w+b" );
+	if ( f == NULL ) {
+		NoticeMessage( MSG_OPEN_FAIL, _("Continue"), NULL, _("Regression"), sBinaryFile, strerror(errno) );
+		free( sBinaryFile );
+		return FALSE;
+	}
+	WriteTracksBinary( f, NULL, FALSE );
+	size = ftell( f );
+	rewind( f );
+	image = MyMalloc( size+1 );
+	if ( fread( image, 1, size, f ) != (size_t)size )
+		size = 0;
+	fclose( f );
+	remove( sBinaryFile );
+	free( sBinaryFile );
+
+	// Read tracks are indexed separately from the Actual tracks
+	track_p to_first_save = to_first;
+	track_p* to_last_save = to_last;
+	dynArr_t trackIndex_save = trackIndex_da;
+	memset( &trackIndex_da, 0, sizeof trackIndex_da );
+	to_first = NULL;
+	to_last = &to_first;
+	paramVersion = PARAMVERSION;
+	ReadTracksBinary( image, size, NULL );
+	MyFree( image );
+	MakeFullpath( &sRegressionFile, workingDir, "xtrkcad.regress", NULL );
+	for ( trk=to_first; trk; trk=trk->next ) {
+		dynArr_t trackIndexExpected = trackIndex_da;
+		trackIndex_da = trackIndex_save;
+		track_cp tActual = FindTrack( GetTrkIndex( trk ) );
+		trackIndex_da = trackIndexExpected;
+		strcpy( message, "Regression Binary " );
+		if ( CompareTrack( tActual, trk ) )
+			continue;
+		LOG( log_regression, 1, ("  FAIL: %s", message) );
+		failCnt++;
+		fRegression = fopen( sRegressionFile, "a" );
+		if ( fRegression ) {
+			fprintf( fRegression, "REGRESSION BINARY FAIL %d\n", PARAMVERSION );
+			fprintf( fRegression, "# %s - %d\n", sFileName, paramLineNum );
+			fprintf( fRegression, "# %s", message );
+			fclose( fRegression );
+		}
+	}
+	// Delete the read tracks
+	for ( trk=to_first; trk; trk=next ) {
+		next = trk->next;
+		FreeTrack( trk );
+	}
+	to_first = to_first_save;
+	to_last = to_last_save;
+	DYNARR_FREE( track_p, trackIndex_da );
+	trackIndex_da = trackIndex_save;
+	max_index = oldMaxIndex;
+	max_seq = oldMaxSeq;
+	paramVersion = oldParamVersion;
+	free( sRegressionFile );
+	LOG( log_regression, 1, ("REGRESSION BINARY %s:%d %d failed\n",
+				sFileName, paramLineNum, failCnt ) );
+	return failCnt == 0;
+}
+
 static void EnableButtons(
 		BOOL_T enable )
 {
@@ -1270,6 +1366,9 @@ static void Playback( void )
 			}
 		} else if ( strncmp( paramLine, "DEMOINIT", 8 ) == 0 ) {
 			DemoInitValues();
+		} else if ( strncmp( paramLine, "REGRESSION BINARY", 17 ) == 0 ) {
+			DoRegressionBinary( curDemo < 1 ? paramFileName :
+					            demoList(curDemo-1).fileName );
 		} else if ( strncmp( paramLine, "REGRESSION START", 16 ) == 0 ) {
 			DoRegression( curDemo < 1 ? paramFileName :
 					            demoList(curDemo-1).fileName );
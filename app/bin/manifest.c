@@ -99,11 +99,13 @@ char* CreateManifest(char* nameOfLayout, char* background,
  * Pull in a Manifest File and extract values from it
  * \param IN manifest - the full path to the mainifest.json file
  * \param IN zip_directory - the path to the directory for extracted objects
+ * \param IN archive - if not NULL the archive the objects are extracted from
+ *		when they are needed, else they have been extracted already
  *
  * \returns - the layout filename
  */
 
-char* ParseManifest(char* manifest, char* zip_directory)
+char* ParseManifest(char* manifest, char* zip_directory, char* archive)
 {
 	char* background_file[1] = { NULL };
 	char* layoutname;
@@ -136,6 +138,8 @@ char* ParseManifest(char* manifest, char* zip_directory)
 			cJSON* archpath = cJSON_GetObjectItemCaseSensitive(dependency, "arch-path");
 			file = MyStrdup(cJSON_GetStringValue(filename));
 			path = MyStrdup(cJSON_GetStringValue(archpath));
+			char *entry = MyMalloc(strlen(path) + strlen(file) + 2);
+			sprintf(entry, "%s/%s", path, file);
 #ifdef WINDOWS
 			ConvertUTF8ToSystem(file);
 			ConvertUTF8ToSystem(path);
@@ -147,7 +151,12 @@ char* ParseManifest(char* manifest, char* zip_directory)
 #if DEBUG
 			printf("Link to background image %s \n", background_file[0]);
 #endif
-			LoadImageFile(1, &background_file[0], NULL);
+			if (archive) {
+				LoadImageFromArchive(background_file[0], archive, entry);
+			} else {
+				LoadImageFile(1, &background_file[0], NULL);
+			}
+			MyFree(entry);
 			cJSON* size = cJSON_GetObjectItemCaseSensitive(dependency, "size");
 			SetLayoutBackGroundSize(size->valuedouble);
 			cJSON* posx = cJSON_GetObjectItemCaseSensitive(dependency, "pos-x");
@@ -2,5 +2,5 @@
 #define HAVE_MANIFEST_H
 	char* CreateManifest(char* nameOfLayout, char* background,
 						 char* DependencyDir);
-	char* ParseManifest(char* manifest, char* zip_directory);
+	char* ParseManifest(char* manifest, char* zip_directory, char* archive);
 #endif
@@ -251,11 +251,18 @@ EXPORT void * MyRealloc(void * old, long size) {
 		free((char*) old - sizeof *(long*) 0 - sizeof *(size_t*) 0);
 		return NULL;
 	}
-	new = MyMalloc(size);
-	if (new == NULL && size)
+	/* let the C library extend the block in place when it can */
+	new = realloc((char*) old - sizeof(unsigned long) - sizeof(size_t),
+			(size_t) size + sizeof(size_t) + 2 * sizeof(unsigned long));
+	if (new == NULL)
 		AbortProg("No memory");
-	memcpy(new, old, min((size_t )size, oldSize));
-	MyFree(old);
+	*(size_t*) new = (size_t) size;
+	new = (char*) new + sizeof(size_t) + sizeof(unsigned long);
+	*(unsigned long*) ((char*) new + size) = guard1;
+	if ((size_t) size > oldSize)
+		memset((char*) new + oldSize, 0, (size_t) size - oldSize);
+	totalMalloced += size;
+	totalFreeed += oldSize;
 	return new;
 }
 
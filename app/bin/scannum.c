@@ -0,0 +1,234 @@
+/** \file scannum.c
+ * Locale independent replacements for strtol, strtoul and strtod
+ *
+ * Layout and parameter files always use '.' as the decimal point.  These
+ * scanners read base 10 numbers without consulting the locale so the caller
+ * does not have to switch to the "C" locale for every line.
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scannum.h"
+
+#define IS_DIGIT(C)		((C) >= '0' && (C) <= '9')
+#define IS_SPACE(C)		isspace((unsigned char)(C))
+
+/* Powers of ten which are exact in a double */
+static const double pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+#define MAX_POW10		(22)
+#define MAX_MANTISSA	(((uint64_t)1)<<53)
+#define MAX_DIGITS		(19)
+
+/**
+ * Scan a signed decimal integer like strtol( str, endptr, 10 ).
+ *
+ * \param str IN text to scan, leading white space is skipped
+ * \param endptr OUT first unused character, str if there was no number
+ * \return the value, clamped to LONG_MIN..LONG_MAX
+ */
+long ScanLong( const char * str, char ** endptr )
+{
+	const char * cp = str;
+	unsigned long val = 0;
+	unsigned long limit;
+	int neg = 0;
+	int overflow = 0;
+	while ( IS_SPACE(*cp) ) cp++;
+	if ( *cp == '-' || *cp == '+' )
+		neg = (*cp++ == '-');
+	if ( !IS_DIGIT(*cp) ) {
+		if ( endptr ) *endptr = (char*)str;
+		return 0;
+	}
+	limit = neg ? (unsigned long)LONG_MAX+1 : (unsigned long)LONG_MAX;
+	for ( ; IS_DIGIT(*cp); cp++ ) {
+		unsigned long digit = *cp - '0';
+		if ( val > (limit-digit)/10 )
+			overflow = 1;
+		else
+			val = val*10 + digit;
+	}
+	if ( endptr ) *endptr = (char*)cp;
+	if ( overflow )
+		return neg ? LONG_MIN : LONG_MAX;
+	if ( neg )
+		return ( val == (unsigned long)LONG_MAX+1 ) ? LONG_MIN : -(long)val;
+	return (long)val;
+}
+
+
+/**
+ * Scan an unsigned decimal integer like strtoul( str, endptr, 10 ).
+ *
+ * \param str IN text to scan, leading white space is skipped
+ * \param endptr OUT first unused character, str if there was no number
+ * \return the value, ULONG_MAX on overflow
+ */
+unsigned long ScanULong( const char * str, char ** endptr )
+{
+	const char * cp = str;
+	unsigned long val = 0;
+	int neg = 0;
+	int overflow = 0;
+	while ( IS_SPACE(*cp) ) cp++;
+	if ( *cp == '-' || *cp == '+' )
+		neg = (*cp++ == '-');
+	if ( !IS_DIGIT(*cp) ) {
+		if ( endptr ) *endptr = (char*)str;
+		return 0;
+	}
+	for ( ; IS_DIGIT(*cp); cp++ ) {
+		unsigned long digit = *cp - '0';
+		if ( val > (ULONG_MAX-digit)/10 )
+			overflow = 1;
+		else
+			val = val*10 + digit;
+	}
+	if ( endptr ) *endptr = (char*)cp;
+	if ( overflow )
+		return ULONG_MAX;
+	return neg ? -val : val;
+}
+
+
+/*
+ * strtod for the numbers the fast path can not round exactly.  The '.' is
+ * replaced by the decimal point of the current locale.
+ */
+static double ScanDoubleSlow( const char * str, char ** endptr )
+{
+	char buff[80];
+	const char * point = localeconv()->decimal_point;
+	const char * cp;
+	char * bp = buff;
+	char * ep;
+	double val;
+	size_t len;
+
+	while ( IS_SPACE(*str) ) str++;
+	for ( cp = str; *cp && !IS_SPACE(*cp) && bp < buff+sizeof buff-8; cp++ ) {
+		if ( *cp == '.' && point[0] != '.' ) {
+			len = strlen( point );
+			memcpy( bp, point, len );
+			bp += len;
+		} else {
+			*bp++ = *cp;
+		}
+	}
+	*bp = '\0';
+	val = strtod( buff, &ep );
+	if ( endptr ) {
+		/* map the end back onto str */
+		const char * sp = str;
+		for ( bp = buff; bp < ep; sp++ ) {
+			if ( *sp == '.' && point[0] != '.' )
+				bp += strlen( point );
+			else
+				bp++;
+		}
+		*endptr = (char*)( ep == buff ? str : sp );
+	}
+	return val;
+}
+
+
+/**
+ * Scan a floating point number like strtod, always using '.' as the decimal
+ * point.  Numbers with at most 19 significant digits whose value is exact
+ * before the final scaling by a power of ten (which covers everything the
+ * program writes) are converted directly and correctly rounded; anything
+ * else is passed on to strtod.
+ *
+ * \param str IN text to scan, leading white space is skipped
+ * \param endptr OUT first unused character, str if there was no number
+ * \return the value
+ */
+double ScanDouble( const char * str, char ** endptr )
+{
+	const char * cp = str;
+	uint64_t mant = 0;
+	int digits = 0;
+	int anyDigits = 0;
+	int exp10 = 0;
+	int neg = 0;
+	double val;
+
+	while ( IS_SPACE(*cp) ) cp++;
+	if ( *cp == '-' || *cp == '+' )
+		neg = (*cp++ == '-');
+	if ( cp[0] == '0' && (cp[1] == 'x' || cp[1] == 'X') )
+		return ScanDoubleSlow( str, endptr );
+	for ( ; IS_DIGIT(*cp); cp++ ) {
+		anyDigits = 1;
+		if ( mant == 0 && *cp == '0' )
+			continue;
+		if ( ++digits > MAX_DIGITS )
+			return ScanDoubleSlow( str, endptr );
+		mant = mant*10 + (*cp - '0');
+	}
+	if ( *cp == '.' ) {
+		for ( cp++; IS_DIGIT(*cp); cp++ ) {
+			anyDigits = 1;
+			exp10--;
+			if ( mant == 0 && *cp == '0' )
+				continue;
+			if ( ++digits > MAX_DIGITS )
+				return ScanDoubleSlow( str, endptr );
+			mant = mant*10 + (*cp - '0');
+		}
+	}
+	if ( !anyDigits )
+		/* inf, nan or no number at all */
+		return ScanDoubleSlow( str, endptr );
+	if ( *cp == 'e' || *cp == 'E' ) {
+		const char * ep = cp+1;
+		int eneg = 0;
+		int e = 0;
+		if ( *ep == '-' || *ep == '+' )
+			eneg = (*ep++ == '-');
+		if ( IS_DIGIT(*ep) ) {
+			for ( ; IS_DIGIT(*ep); ep++ )
+				if ( e < 10000 )
+					e = e*10 + (*ep - '0');
+			exp10 += eneg ? -e : e;
+			cp = ep;
+		}
+	}
+	if ( mant > MAX_MANTISSA || exp10 > MAX_POW10 || exp10 < -MAX_POW10 ) {
+		if ( mant != 0 )
+			return ScanDoubleSlow( str, endptr );
+		exp10 = 0;
+	}
+	val = (double)mant;
+	if ( exp10 > 0 )
+		val *= pow10[exp10];
+	else if ( exp10 < 0 )
+		val /= pow10[-exp10];
+	if ( endptr ) *endptr = (char*)cp;
+	return neg ? -val : val;
+}
@@ -24,6 +24,7 @@
 
 #include "shrtpath.h"
 #include "track.h"
+#include "uthash.h"
 
 EXPORT int log_shortPath;
 static int log_shortPathInitted;
@@ -43,10 +44,23 @@ typedef struct {
 		int inxBack;			/* Previous node on shortest path */
 		int inxTracks;			/* List of tracks along this path */
 		int numTracks;
+		int inxNextOnTrk;		/* Next node continuing on the same track */
 		} pathNode_t, *pathNode_p;
 
 static dynArr_t pathNode_da;
 #define pathNode(N) DYNARR_N( pathNode_t, pathNode_da, N )
+
+/* Working nodes, as a binary heap ordered by dist (and index on ties) */
+static dynArr_t frontier_da;
+#define frontier(N) DYNARR_N( int, frontier_da, N )
+
+/* First node continuing on each track, the rest are chained by inxNextOnTrk */
+typedef struct {
+		track_p trk;
+		int inxFirst;
+		UT_hash_handle hh;
+		} pathTrk_t, *pathTrk_p;
+static pathTrk_p pathTrk_hash;
 typedef struct {
 		track_p trk;
 		EPINX_T ep1, ep2;
@@ -59,6 +73,87 @@ static track_p shortPathTrk0, shortPathTrk1;
 static EPINX_T shortPathEP0, shortPathEP1;
 
 
+static BOOL_T FrontierLess( int inx1, int inx2 )
+{
+	DIST_T dist1 = pathNode(inx1).dist;
+	DIST_T dist2 = pathNode(inx2).dist;
+	return dist1 < dist2 || ( dist1 == dist2 && inx1 < inx2 );
+}
+
+
+static void FrontierPush( int inx )
+{
+	int pos, parent;
+	DYNARR_APPEND( int, frontier_da, 100 );
+	pos = frontier_da.cnt-1;
+	while ( pos > 0 ) {
+		parent = (pos-1)/2;
+		if ( !FrontierLess( inx, frontier(parent) ) )
+			break;
+		frontier(pos) = frontier(parent);
+		pos = parent;
+	}
+	frontier(pos) = inx;
+}
+
+
+static int FrontierPop( void )
+{
+	int inx, last, pos, child;
+	if ( frontier_da.cnt <= 0 )
+		return -1;
+	inx = frontier(0);
+	last = frontier(frontier_da.cnt-1);
+	frontier_da.cnt--;
+	pos = 0;
+	while ( (child = 2*pos+1) < frontier_da.cnt ) {
+		if ( child+1 < frontier_da.cnt && FrontierLess( frontier(child+1), frontier(child) ) )
+			child++;
+		if ( !FrontierLess( frontier(child), last ) )
+			break;
+		frontier(pos) = frontier(child);
+		pos = child;
+	}
+	if ( frontier_da.cnt > 0 )
+		frontier(pos) = last;
+	return inx;
+}
+
+
+static void PathTrkAdd( int inx )
+{
+	pathTrk_p pTrk;
+	track_p trk = pathNode(inx).contTrk;
+	HASH_FIND_PTR( pathTrk_hash, &trk, pTrk );
+	if ( pTrk == NULL ) {
+		pTrk = (pathTrk_p)PoolAlloc( sizeof *pTrk );
+		pTrk->trk = trk;
+		pTrk->inxFirst = -1;
+		HASH_ADD_PTR( pathTrk_hash, trk, pTrk );
+	}
+	pathNode(inx).inxNextOnTrk = pTrk->inxFirst;
+	pTrk->inxFirst = inx;
+}
+
+
+static int PathTrkFirst( track_p trk )
+{
+	pathTrk_p pTrk;
+	HASH_FIND_PTR( pathTrk_hash, &trk, pTrk );
+	return pTrk ? pTrk->inxFirst : -1;
+}
+
+
+static void PathTrkClear( void )
+{
+	pathTrk_p pTrk, pTmp;
+	HASH_ITER( hh, pathTrk_hash, pTrk, pTmp ) {
+		HASH_DEL( pathTrk_hash, pTrk );
+		PoolFree( pTrk, sizeof *pTrk );
+	}
+}
+
+
 static int DoShortPathFunc( shortestPathFunc_p func, char * title, SPTF_CMD cmd, track_p trk, EPINX_T ep1, EPINX_T ep2, DIST_T dist, void * data )
 {
 	int rc;
@@ -213,8 +308,10 @@ LOG( log_shortPath, 2, ( " t%d D=%0.3f\n", startTrack, dist ) )
 	pNode->inxBack = inxCurr; 
 	pNode->inxTracks = startTrack;
 	pNode->numTracks = trackep_da.cnt-startTrack;
+	pNode->inxNextOnTrk = -1;
+	FrontierPush( pathNode_da.cnt-1 );
 	if ( trk )
-		SetTrkBits( trk, TB_SHRTPATH );
+		PathTrkAdd( pathNode_da.cnt-1 );
 	return TRUE;
 
 skipNode:
@@ -236,15 +333,18 @@ int FindShortestPath(
 	pathNode_p pCurr;
 	pathNode_p pNext;
 	int pinx=0;
-	DIST_T minDist;
 	int count;
+	int expanded = 0;
 	int rc = 0;
+	long time0 = wGetTimer();
 	EPINX_T ep2, epCnt, ep3;
 	static dynArr_t ep_da;
 	#define ep(N) DYNARR_N( pathNode_p, ep_da, N )
 
 	DYNARR_RESET( pathNode_t, pathNode_da );
 	DYNARR_RESET( trackep_t, trackep_da );
+	DYNARR_RESET( int, frontier_da );
+	PathTrkClear();
 	count = 0;
 
 	if ( !log_shortPathInitted ) {
@@ -253,7 +353,6 @@ int FindShortestPath(
 	}
 
 LOG( log_shortPath, 1, ( "FindShortestPath( T%d:%d, %s, ... )\n", GetTrkIndex(trkN), epN, bidirectional?"bidir":"unidir" ) )
-	ClrAllTrkBits( TB_SHRTPATH );
 	/* Note: trkN:epN is not tested for MATCH */
 	shortPathTrk0 = trkN;
 	shortPathEP0 = epN;
@@ -268,18 +367,10 @@ LOG( log_shortPath, 1, ( "FindShortestPath( T%d:%d, %s, ... )\n", GetTrkIndex(tr
 		InfoMessage( "%d", ++count );
 
 		/* select next final node */
-		minDist = 0.0;
-		inxCurr = -1;
-		for (pinx=0; pinx<pathNode_da.cnt; pinx++) {
-			 pNext = &pathNode(pinx);
-			 if (pNext->state == Working &&
-				(inxCurr < 0 || pNext->dist < minDist) ) {
-				minDist = pathNode(pinx).dist;
-				inxCurr = pinx;
-			}
-		}
+		inxCurr = FrontierPop();
 		if ( inxCurr < 0 )
 			break;
+		expanded++;
 if (log_shortPath>=4) DumpPaths(inxCurr);
 		pCurr = &pathNode(inxCurr);
 		pCurr->state = Final;
@@ -294,13 +385,11 @@ if (log_shortPath>=4) DumpPaths(inxCurr);
 			epCnt = GetTrkEndPtCnt(pCurr->contTrk);
 			DYNARR_SET( pathNode_p, ep_da, epCnt );
 			memset( ep_da.ptr, 0, epCnt * sizeof pNext );
-			if ( (GetTrkBits(pCurr->contTrk) & TB_SHRTPATH) ) {
-				for ( pinx=0; pinx<pathNode_da.cnt; pinx++ ) {
-					pNext = &pathNode(pinx);
-					if ( pNext->contTrk == pCurr->contTrk ) {
-						ep(pNext->contEP) = pNext;
-					}
-				}
+			for ( pinx=PathTrkFirst(pCurr->contTrk); pinx>=0; pinx=pNext->inxNextOnTrk ) {
+				pNext = &pathNode(pinx);
+				/* newest first: keep the latest node for each ep */
+				if ( ep(pNext->contEP) == NULL )
+					ep(pNext->contEP) = pNext;
 			}
 			for ( ep2=0; ep2<epCnt; ep2++ ) {
 				pCurr = &pathNode(inxCurr);
@@ -325,7 +414,8 @@ if (log_shortPath>=4) DumpPaths(inxCurr);
 	}
 
 if (log_shortPath>=1) DumpPaths(inxCurr);
-	ClrAllTrkBits( TB_SHRTPATH );
+LOG( log_shortPath, 1, ( "FindShortestPath: %d nodes, %d expanded, %d found (%ld ms)\n", pathNode_da.cnt, expanded, rc, wGetTimer()-time0 ) )
+	PathTrkClear();
 	return rc;
 }
 
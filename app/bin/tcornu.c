@@ -54,6 +54,7 @@
 #include "cundo.h"
 #include "layout.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "assert.h"
 
 EXPORT TRKTYP_T T_CORNU = -1;
@@ -583,7 +584,7 @@ static BOOL_T WriteCornu( track_p t, FILE * f )
 	BOOL_T track =(GetTrkType(t)==T_CORNU);
 	options = GetTrkWidth(t) & 0x0F;
 	if ( ( GetTrkBits(t) & TB_HIDEDESC ) == 0 ) options |= 0x80;
-	rc &= fprintf(f, "%s %d %d %ld 0 0 %s %d %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f \n",
+	rc &= FilePrintf(f, "%s %d %d %ld 0 0 %s %d %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f %0.6f \n",
 		"CORNU",GetTrkIndex(t), GetTrkLayer(t), (long)options,
                   GetTrkScaleName(t), GetTrkVisible(t)|(GetTrkNoTies(t)?1<<2:0)|(GetTrkBridge(t)?1<<3:0),
 				  xx->cornuData.pos[0].x, xx->cornuData.pos[0].y,
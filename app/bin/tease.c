@@ -71,6 +71,7 @@ do 'testjoin psplot 10 10 40 1 | lpr -Ppostscript'
 #include "cjoin.h"
 #include "cundo.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "messages.h"
@@ -952,13 +953,13 @@ static BOOL_T WriteJoint(
 	long options = (long)GetTrkWidth(t);
 	if ( ( ( GetTrkBits(t) & TB_HIDEDESC ) != 0 ) )
 			options |= 0x80;
-	rc &= fprintf(f, "JOINT %d %d %ld 0 0 %s %d %0.6f %0.6f %0.6f %0.6f %d %d %d %0.6f %0.6f 0 %0.6f\n",
+	rc &= FilePrintf(f, "JOINT %d %d %ld 0 0 %s %d %0.6f %0.6f %0.6f %0.6f %d %d %d %0.6f %0.6f 0 %0.6f\n",
 		GetTrkIndex(t), GetTrkLayer(t), options,
 		GetTrkScaleName(t), GetTrkVisible(t), xx->l0, xx->l1, xx->R, xx->L,
 		xx->flip, xx->negate, xx->Scurve, xx->pos.x, xx->pos.y, xx->angle )>0;
 	rc &= WriteEndPt( f, t, 0 );
 	rc &= WriteEndPt( f, t, 1 );
-	rc &= fprintf(f, "\t%s\n", END_SEGS )>0;
+	rc &= FilePrintf(f, "\t%s\n", END_SEGS )>0;
 	return rc;
 }
 
@@ -36,6 +36,7 @@
 #include "custom.h"
 #include "draw.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "messages.h"
@@ -165,28 +166,19 @@ EXPORT track_p OnTrack2( coOrd * fp, BOOL_T complain, BOOL_T track, BOOL_T ignor
 	track_p trk;
 	DIST_T distance, closestDistance = 1000000;
 	track_p closestTrack = NULL;
-	coOrd p, closestPos, q0, q1;
-
-	q0 = q1 = * fp;
-	q0.x -= 1.0;
-	q1.x += 1.0;
-	q0.y -= 1.0;
-	q1.y += 1.0;
-	TRK_ITERATE( trk ) {
+	coOrd p, closestPos;
+	dynArr_t trks_da;
+	int inx;
+
+	memset( &trks_da, 0, sizeof trks_da );
+	GridFindTracksNear( *fp, 1.0, ignoreHidden ? GetLayerVisible : NULL, &trks_da );
+	for ( inx=0; inx<trks_da.cnt; inx++ ) {
+		trk = DYNARR_N( track_p, trks_da, inx );
 		if ( track && !IsTrack(trk) )
 			continue;
 		if (trk == t) continue;
-		if (trk->hi.x < q0.x ||
-			trk->lo.x > q1.x ||
-			trk->hi.y < q0.y ||
-			trk->lo.y > q1.y )
+		if ( ignoreHidden && (!GetTrkVisible(trk)) && drawTunnel == DRAW_TUNNEL_NONE)
 			continue;
-		if ( ignoreHidden ) {
-			if ( (!GetTrkVisible(trk)) && drawTunnel == DRAW_TUNNEL_NONE)
-				continue;
-			if ( !GetLayerVisible( GetTrkLayer( trk ) ) )
-				continue;
-		}
 		p = *fp;
 		distance = trackCmds( GetTrkType(trk) )->distance( trk, &p );
 		if (fabs(distance) <= fabs(closestDistance)) { //Make the last (highest) preferred
@@ -195,6 +187,7 @@ EXPORT track_p OnTrack2( coOrd * fp, BOOL_T complain, BOOL_T track, BOOL_T ignor
 			closestPos = p;
 		}
 	}
+	DYNARR_FREE( track_p, trks_da );
 	if (closestTrack && closestDistance <0 ) closestDistance = 0.0;  //Turntable was closest - inside well
 	if (closestTrack && ((closestDistance <= mainD.scale*0.25) || (closestDistance <= trackGauge*2.0) )) {
 		*fp = closestPos;
@@ -259,6 +252,9 @@ EXPORT void EnumerateTracks( void )
 
 	enumerateMaxDescLen = strlen("Description");
 
+	/* the parts list covers the whole layout */
+	if ( selectedTrackCount == 0 )
+		LoadHiddenLayers( TRUE );
 	TRK_ITERATE( trk ) {
 		/* 
 		 *	process track piece if none are selected (list all) or if it is one of the
@@ -330,6 +326,311 @@ EXPORT void InitTrkTrack( void )
 	log_readTracks = LogFindIndex( "readTracks" );
 }
 
+/*****************************************************************************
+ *
+ * SELECTED TRACKS
+ *
+ */
+
+/**
+ * The selected tracks (TB_SELECTED set and not deleted) are kept in a vector
+ * so the selection can be counted and walked without visiting every track.
+ * A track is added or dropped whenever its bits or deleted flag change (see
+ * HotUpdateTrack), which also keeps selectedTrackCount current.  A dropped
+ * track keeps its slot, so deselecting and reselecting it does not move it;
+ * unused slots are squeezed out, and the vector put back in track list order,
+ * when an iteration starts and at no other time.
+ * trk->sel is the slot of a track; it is only trusted if the slot points back.
+ * An iteration keeps the slot and seq of the track it returned last in the
+ * caller's trkSelIter_t, as that track may be freed by the loop body.  If an
+ * iteration nested in it squeezed the vector, it goes on after that seq.
+ */
+typedef struct {
+		track_p trk;				/**< NULL once the track is freed */
+		BOOL_T in;					/**< the track is selected */
+		} trkSelSlot_t;
+
+typedef struct {
+		dynArr_t slots_da;
+		int unused;					/**< slots with in == FALSE */
+		BOOL_T sorted;				/**< the slots are in trk->seq order */
+		long lastSeq;
+		long tidyCnt;				/**< times the slots were squeezed */
+		} trkSel_t;
+
+static trkSel_t trkSel = { { 0, 0, NULL }, 0, TRUE, 0, 0 };
+
+#define SelSlot(N)		DYNARR_N( trkSelSlot_t, trkSel.slots_da, N )
+#define SelValid(TRK) \
+		((TRK)->sel >= 0 && (TRK)->sel < trkSel.slots_da.cnt && SelSlot((TRK)->sel).trk == (TRK))
+
+static int CompareSelSeq( const void * a, const void * b )
+{
+	long seq1 = ((trkSelSlot_t*)a)->trk->seq;
+	long seq2 = ((trkSelSlot_t*)b)->trk->seq;
+	return ( seq1 < seq2 ) ? -1 : ( seq1 > seq2 ) ? 1 : 0;
+}
+
+
+static void SelTidy( void )
+{
+	int inx, cnt = 0;
+	if ( trkSel.unused == 0 && trkSel.sorted )
+		return;
+	for ( inx=0; inx<trkSel.slots_da.cnt; inx++ )
+		if ( SelSlot(inx).in )
+			SelSlot(cnt++) = SelSlot(inx);
+	trkSel.slots_da.cnt = cnt;
+	trkSel.unused = 0;
+	if ( !trkSel.sorted )
+		qsort( trkSel.slots_da.ptr, cnt, sizeof (trkSelSlot_t), CompareSelSeq );
+	trkSel.sorted = TRUE;
+	trkSel.lastSeq = 0;
+	trkSel.tidyCnt++;
+	for ( inx=0; inx<cnt; inx++ ) {
+		SelSlot(inx).trk->sel = inx;
+		trkSel.lastSeq = SelSlot(inx).trk->seq;
+	}
+}
+
+
+static void SelRemove( track_p trk )
+{
+	trkSelSlot_t * slot;
+	if ( !SelValid( trk ) )
+		return;
+	slot = &SelSlot( trk->sel );
+	if ( slot->in ) {
+		slot->in = FALSE;
+		trkSel.unused++;
+		selectedTrackCount--;
+	}
+	slot->trk = NULL;
+}
+
+
+static void SelUpdate( track_p trk )
+{
+	BOOL_T selected = (trk->bits&TB_SELECTED) != 0 && !trk->deleted;
+	trkSelSlot_t * slot;
+	if ( SelValid( trk ) ) {
+		slot = &SelSlot( trk->sel );
+		if ( slot->in == selected )
+			return;
+		slot->in = selected;
+		trkSel.unused += selected ? -1 : 1;
+		selectedTrackCount += selected ? 1 : -1;
+		return;
+	}
+	if ( !selected )
+		return;
+	if ( trk->seq < trkSel.lastSeq )
+		trkSel.sorted = FALSE;
+	else
+		trkSel.lastSeq = trk->seq;
+	DYNARR_APPEND( trkSelSlot_t, trkSel.slots_da, 256 );
+	trk->sel = trkSel.slots_da.cnt-1;
+	SelSlot( trk->sel ).trk = trk;
+	SelSlot( trk->sel ).in = TRUE;
+	selectedTrackCount++;
+}
+
+
+/**
+ * Step through the selected tracks in track list order, see TrackIterate.
+ * Tracks may be deselected or deleted while iterating.
+ *
+ * \param iter IN OUT state of the iteration, set up when *trk is NULL
+ * \param trk IN OUT NULL to start, then the previous track
+ * \return FALSE at the end of the selection
+ */
+EXPORT BOOL_T SelectedTrackIterate( trkSelIter_t * iter, track_p * trk )
+{
+	int inx;
+	if ( *trk == NULL ) {
+		SelTidy();
+		inx = 0;
+	} else if ( iter->tidyCnt == trkSel.tidyCnt ) {
+		inx = iter->inx+1;
+	} else {
+		/* the slots were squeezed by a nested iteration */
+		for ( inx=0; inx<trkSel.slots_da.cnt; inx++ )
+			if ( SelSlot(inx).trk && SelSlot(inx).trk->seq > iter->seq )
+				break;
+	}
+	for ( ; inx<trkSel.slots_da.cnt; inx++ ) {
+		if ( SelSlot(inx).in ) {
+			*trk = SelSlot(inx).trk;
+			iter->inx = inx;
+			iter->seq = (*trk)->seq;
+			iter->tidyCnt = trkSel.tidyCnt;
+			return TRUE;
+		}
+	}
+	*trk = NULL;
+	return FALSE;
+}
+
+
+/*****************************************************************************
+ *
+ * HOT FIELDS
+ *
+ */
+
+/**
+ * The fields the whole-layout scans look at (bounding box, layer, type, bits)
+ * are copied into parallel arrays so the scans read contiguous memory instead
+ * of chasing the track list.  Slots are kept in track list order: new tracks
+ * are appended and the arrays are rebuilt whenever the list is renumbered or
+ * rearranged.  Freed tracks leave an empty slot behind until the next rebuild.
+ * trk->hot is the slot of a track; it is only trusted if the slot points back.
+ */
+#define HOT_DELETED		(1<<16)		/**< flags: track is deleted or freed */
+
+typedef struct {
+		int cnt;
+		int max;
+		int dead;					/**< slots of freed tracks */
+		float * loX;
+		float * loY;
+		float * hiX;
+		float * hiY;
+		unsigned int * layer;		/**< NUM_LAYERS for any layer past the last */
+		TRKTYP_T * type;
+		unsigned int * flags;		/**< trk->bits and HOT_DELETED */
+		track_p * trk;
+		} trkHot_t;
+
+static trkHot_t trkHot;
+
+#define HotValid(TRK) \
+		((TRK)->hot >= 0 && (TRK)->hot < trkHot.cnt && trkHot.trk[(TRK)->hot] == (TRK))
+
+static void HotSet( int slot, track_p trk )
+{
+	trkHot.loX[slot] = trk->lo.x;
+	trkHot.loY[slot] = trk->lo.y;
+	trkHot.hiX[slot] = trk->hi.x;
+	trkHot.hiY[slot] = trk->hi.y;
+	trkHot.layer[slot] = trk->layer < NUM_LAYERS ? trk->layer : NUM_LAYERS;
+	trkHot.type[slot] = trk->type;
+	trkHot.flags[slot] = trk->bits | (trk->deleted?HOT_DELETED:0);
+}
+
+
+static void HotAppend( track_p trk )
+{
+	if ( trkHot.cnt >= trkHot.max ) {
+		trkHot.max = (trkHot.max < 256) ? 256 : trkHot.max*2;
+		trkHot.loX = MyRealloc( trkHot.loX, trkHot.max * sizeof trkHot.loX[0] );
+		trkHot.loY = MyRealloc( trkHot.loY, trkHot.max * sizeof trkHot.loY[0] );
+		trkHot.hiX = MyRealloc( trkHot.hiX, trkHot.max * sizeof trkHot.hiX[0] );
+		trkHot.hiY = MyRealloc( trkHot.hiY, trkHot.max * sizeof trkHot.hiY[0] );
+		trkHot.layer = MyRealloc( trkHot.layer, trkHot.max * sizeof trkHot.layer[0] );
+		trkHot.type = MyRealloc( trkHot.type, trkHot.max * sizeof trkHot.type[0] );
+		trkHot.flags = MyRealloc( trkHot.flags, trkHot.max * sizeof trkHot.flags[0] );
+		trkHot.trk = MyRealloc( trkHot.trk, trkHot.max * sizeof trkHot.trk[0] );
+	}
+	trk->hot = trkHot.cnt++;
+	trkHot.trk[trk->hot] = trk;
+	HotSet( trk->hot, trk );
+	SelUpdate( trk );
+}
+
+
+/**
+ * Rebuild the hot field arrays from the track list.
+ */
+EXPORT void HotRebuild( void )
+{
+	track_p trk;
+	trkHot.cnt = 0;
+	trkHot.dead = 0;
+	for (trk=to_first; trk!=NULL; trk=trk->next)
+		HotAppend( trk );
+}
+
+
+static void HotRemove( track_p trk )
+{
+	if ( !HotValid( trk ) )
+		return;
+	trkHot.trk[trk->hot] = NULL;
+	trkHot.flags[trk->hot] = HOT_DELETED;
+	trkHot.dead++;
+}
+
+
+/* Drop the slots of freed tracks once they are the majority */
+static void HotCompact( void )
+{
+	if ( trkHot.dead > 64 && trkHot.dead > trkHot.cnt/2 )
+		HotRebuild();
+}
+
+
+static void HotFree( trkHot_t * hot )
+{
+	MyFree( hot->loX );
+	MyFree( hot->loY );
+	MyFree( hot->hiX );
+	MyFree( hot->hiY );
+	MyFree( hot->layer );
+	MyFree( hot->type );
+	MyFree( hot->flags );
+	MyFree( hot->trk );
+	memset( hot, 0, sizeof *hot );
+}
+
+
+/**
+ * Copy the hot fields of a track after its bounding box, layer, bits or
+ * deleted flag changed, and add it to or remove it from the selection.
+ *
+ * \param trk IN the track
+ */
+EXPORT void HotUpdateTrack( track_p trk )
+{
+	SelUpdate( trk );
+	if ( HotValid( trk ) )
+		HotSet( trk->hot, trk );
+}
+
+
+/**
+ * Find the tracks whose bounding box intersects a rectangle by scanning the
+ * hot field arrays.  The tracks are returned in track list order.  layerTest
+ * is asked once per layer, the tracks are then filtered by their hot layer.
+ *
+ * \param lo IN lower left corner of the rectangle
+ * \param hi IN upper right corner of the rectangle
+ * \param layerTest IN only tracks on layers it accepts, NULL for all layers
+ * \param trks_da OUT array of track_p, reset before use
+ */
+EXPORT void HotFindTracks( coOrd lo, coOrd hi, layerTest_p layerTest, dynArr_t * trks_da )
+{
+	int slot;
+	unsigned int layer;
+	char skipLayer[NUM_LAYERS+1];
+	DYNARR_RESET( track_p, *trks_da );
+	HotCompact();
+	for ( layer=0; layer<=NUM_LAYERS; layer++ )
+		skipLayer[layer] = layerTest != NULL && !layerTest( layer );
+	for ( slot=0; slot<trkHot.cnt; slot++ ) {
+		/* no short circuit: keeps the loop free of branches per test */
+		if ( (trkHot.hiX[slot] < lo.x) | (trkHot.loX[slot] > hi.x) |
+			 (trkHot.hiY[slot] < lo.y) | (trkHot.loY[slot] > hi.y) |
+			 ((trkHot.flags[slot] & HOT_DELETED) != 0) |
+			 skipLayer[trkHot.layer[slot]] )
+			continue;
+		DYNARR_APPEND( track_p, *trks_da, 256 );
+		DYNARR_LAST( track_p, *trks_da ) = trkHot.trk[slot];
+	}
+}
+
+
+
 /*****************************************************************************
  *
  * TRACK FIELD ACCESS
@@ -373,6 +674,8 @@ EXPORT void SetBoundingBox( track_p trk, coOrd hi, coOrd lo )
 	trk->hi.y = (float)hi.y;
 	trk->lo.x = (float)lo.x;
 	trk->lo.y = (float)lo.y;
+	GridUpdateTrack( trk );
+	HotUpdateTrack( trk );
 }
 
 
@@ -402,6 +705,7 @@ EXPORT void SetTrkEndPoint( track_p trk, EPINX_T ep, coOrd pos, ANGLE_T angle )
 	}
 	trk->endPt[ep].pos = pos;
 	trk->endPt[ep].angle = angle;
+	GridUpdateEndPts( trk );
 }
 
 EXPORT coOrd GetTrkEndPos( track_p trk, EPINX_T e )
@@ -462,6 +766,7 @@ EXPORT int SetTrkBits( track_p trk, int bits )
 {
 	int oldBits = trk->bits;
 	trk->bits |= bits;
+	HotUpdateTrack( trk );
 	return oldBits;
 }
 
@@ -469,6 +774,7 @@ EXPORT int ClrTrkBits( track_p trk, int bits )
 {
 	int oldBits = trk->bits;
 	trk->bits &= ~bits;
+	HotUpdateTrack( trk );
 	return oldBits;
 }
 
@@ -562,11 +868,12 @@ EXPORT void SetTrkEndPtCnt( track_p trk, EPINX_T cnt )
 {
 	EPINX_T oldCnt = trk->endCnt;
 	trk->endCnt = cnt;
-	if ((trk->endPt = MyRealloc( trk->endPt, trk->endCnt * sizeof trk->endPt[0] )) == NULL) {
+	if ((trk->endPt = PoolRealloc( trk->endPt, oldCnt * sizeof trk->endPt[0], trk->endCnt * sizeof trk->endPt[0] )) == NULL && cnt > 0) {
 		AbortProg("setTrkEndPtCnt: No memory" );
 	}
 	if (oldCnt < cnt)
 		memset( &trk->endPt[oldCnt], 0, (cnt-oldCnt) * sizeof *trk->endPt );
+	GridUpdateEndPts( trk );
 }
 
 /**
@@ -585,6 +892,8 @@ void SetTrkLayer( track_p trk, int layer )
 		trk->layer = (unsigned int)layer;
 
 	IncrementLayerObjects(trk->layer);
+	UpdateTrackLists( trk );
+	HotUpdateTrack( trk );
 }
 
 
@@ -599,13 +908,19 @@ EXPORT int ClrAllTrkBitsRedraw( int bits, wBool_t bRedraw )
 {
 	track_p trk;
 	int cnt = 0;
-	TRK_ITERATE( trk ) {
-		if (trk->bits&bits) {
-			cnt++;
-			trk->bits &= ~bits;
-			if ( bRedraw )
-				DrawNewTrack( trk );
-		}
+	int slot;
+	HotCompact();
+	for ( slot=0; slot<trkHot.cnt; slot++ ) {
+		if ( (trkHot.flags[slot] & HOT_DELETED) != 0 ||
+			 (trkHot.flags[slot] & bits) == 0 )
+			continue;
+		trk = trkHot.trk[slot];
+		cnt++;
+		trk->bits &= ~bits;
+		trkHot.flags[slot] &= ~bits;
+		SelUpdate( trk );
+		if ( bRedraw )
+			DrawNewTrack( trk );
 	}
 	return cnt;
 }
@@ -661,6 +976,8 @@ EXPORT void CopyAttributes( track_p src, track_p dst )
 	dst->bits = (dst->bits&TB_HIDEDESC) | (src->bits&~TB_HIDEDESC);
 	SetTrkWidth( dst, GetTrkWidth( src ) );
 	dst->layer = GetTrkLayer( src );
+	UpdateTrackLists( dst );
+	HotUpdateTrack( dst );
 }
 
 /*****************************************************************************
@@ -678,40 +995,40 @@ EXPORT BOOL_T WriteEndPt( FILE * f, track_cp trk, EPINX_T ep )
 
 	assert ( endPt != NULL );
 	if (bWriteEndPtDirectIndex && endPt->index > 0) {
-		rc &= fprintf( f, "\tT4 %d ", endPt->index )>0;
+		rc &= FilePrintf( f, "\tT4 %d ", endPt->index )>0;
 	} else if (endPt->track == NULL ||
 		( exportingTracks && !GetTrkSelected(endPt->track) ) ) {
-		rc &= fprintf( f, "\tE4 " )>0;
+		rc &= FilePrintf( f, "\tE4 " )>0;
 	} else {
-		rc &= fprintf( f, "\tT4 %d ", endPt->track->index )>0;
+		rc &= FilePrintf( f, "\tT4 %d ", endPt->track->index )>0;
 	}
-	rc &= fprintf( f, "%0.6f %0.6f %0.6f", endPt->pos.x, endPt->pos.y, endPt->angle )>0; 
+	rc &= FilePrintf( f, "%0.6f %0.6f %0.6f", endPt->pos.x, endPt->pos.y, endPt->angle )>0; 
 	option = (endPt->option<<8) | (endPt->elev.option&0xFF);
 	if ( option != 0 ) {
-		rc &= fprintf( f, " %ld %0.6f %0.6f", option, endPt->elev.doff.x, endPt->elev.doff.y )>0;
+		rc &= FilePrintf( f, " %ld %0.6f %0.6f", option, endPt->elev.doff.x, endPt->elev.doff.y )>0;
 		switch ( endPt->elev.option&ELEV_MASK ) {
 		case ELEV_DEF:
-			rc &= fprintf( f, " %0.6f ", endPt->elev.u.height )>0;
+			rc &= FilePrintf( f, " %0.6f ", endPt->elev.u.height )>0;
 			break;
 		case ELEV_STATION:
-			rc &= fprintf( f, " \"%s\" ", PutTitle( endPt->elev.u.name ) )>0;
+			rc &= FilePrintf( f, " \"%s\" ", PutTitle( endPt->elev.u.name ) )>0;
 			break;
 		default:
-			rc &= fprintf( f, " 0.0 ")>0;
+			rc &= FilePrintf( f, " 0.0 ")>0;
 		}
 	} else {
-		rc &= fprintf( f, " 0 0.0 0.0 0.0 ")>0;
+		rc &= FilePrintf( f, " 0 0.0 0.0 0.0 ")>0;
 	}
 	if ((endPt->elev.option&ELEV_MASK) == ELEV_DEF)
-		rc &= fprintf( f, "%0.6f ",endPt->elev.u.height)>0;
+		rc &= FilePrintf( f, "%0.6f ",endPt->elev.u.height)>0;
 	else
-		rc &= fprintf( f, "0.0 ")>0;
+		rc &= FilePrintf( f, "0.0 ")>0;
 	long elevVisible = (endPt->elev.option&ELEV_VISIBLE)?1:0;
 	long elevType = endPt->elev.option&ELEV_MASK;
 	long gapType = endPt->option;
-	rc &= fprintf( f, "%ld %ld %ld ", elevVisible, elevType, gapType)>0;
-	rc &= fprintf( f, "%0.6f ", trk->elev)>0;
-	rc &= fprintf( f, "\n" )>0;
+	rc &= FilePrintf( f, "%ld %ld %ld ", elevVisible, elevType, gapType)>0;
+	rc &= FilePrintf( f, "%0.6f ", trk->elev)>0;
+	rc &= FilePrintf( f, "\n" )>0;
 	return rc;
 }
 
@@ -822,11 +1139,8 @@ LOG1( log_readTracks, ( "SetEndPts( T%d, %d )\n", trk->index, cnt ) )
 		InputError( "Incorrect number of End Points for track, read %d, expected %d.\n", FALSE, tempEndPts_da.cnt, cnt );
 		return;
 	}
-	if (tempEndPts_da.cnt) {
-		trk->endPt = (trkEndPt_p)MyMalloc( tempEndPts_da.cnt * sizeof *trk->endPt );
-	} else {
-		trk->endPt = NULL;
-	}
+	PoolFree( trk->endPt, trk->endCnt * sizeof *trk->endPt );
+	trk->endPt = (trkEndPt_p)PoolAlloc( tempEndPts_da.cnt * sizeof *trk->endPt );
 	for ( inx=0; inx<tempEndPts_da.cnt; inx++ ) {
 		trk->endPt[inx].index = tempEndPts(inx).index;
 		trk->endPt[inx].pos = tempEndPts(inx).pos;
@@ -835,6 +1149,7 @@ LOG1( log_readTracks, ( "SetEndPts( T%d, %d )\n", trk->index, cnt ) )
 		trk->endPt[inx].option = tempEndPts(inx).option;
 	}
 	trk->endCnt = tempEndPts_da.cnt;
+	GridUpdateEndPts( trk );
 }
 
 
@@ -846,6 +1161,7 @@ EXPORT void MoveTrack( track_p trk, coOrd orig )
 		trk->endPt[ep].pos.y += orig.y;
 	}
 	trackCmds( trk->type )->move( trk, orig );
+	GridUpdateEndPts( trk );
 }
 
 
@@ -859,6 +1175,16 @@ EXPORT void RotateTrack( track_p trk, coOrd orig, ANGLE_T angle )
 		trk->endPt[ep].angle = NormalizeAngle( trk->endPt[ep].angle + angle );
 	}
 	trackCmds( trk->type )->rotate( trk, orig, angle );
+	GridUpdateEndPts( trk );
+}
+
+
+/**
+ * \return FALSE if RotateTrack leaves trk alone
+ */
+EXPORT BOOL_T CanRotateTrack( track_p trk )
+{
+	return trackCmds( trk->type )->rotate != NULL;
 }
 
 
@@ -906,6 +1232,7 @@ EXPORT void FlipTrack(
 		trk->endPt[0] = trk->endPt[1];
 		trk->endPt[1] = endPt;
 	}
+	GridUpdateEndPts( trk );
 }
 
 
@@ -987,6 +1314,12 @@ EXPORT BOOL_T StoreTrackData(
 			return FALSE;
 }
 
+EXPORT BOOL_T HasTrackData(
+		track_p trk)
+{
+	return trackCmds(trk->type)->storeData != NULL;
+}
+
 
 
 /*****************************************************************************
@@ -1001,6 +1334,161 @@ EXPORT track_p to_first = NULL;
 
 EXPORT TRKINX_T max_index = 0;
 EXPORT track_p * to_last = &to_first;
+EXPORT long max_seq = 0;
+
+/**
+ * Direct lookup table from track index to track.  Entries are kept current by
+ * NewTrack, FreeTrack, RenumberTracks and ClearTracks so FindTrack does not
+ * have to walk the track list.  If two tracks share an index (during Import)
+ * the most recently created one is found.
+ */
+EXPORT dynArr_t trackIndex_da;
+#define trackIndex(N) DYNARR_N( track_p, trackIndex_da, N )
+
+/**
+ * Every track is also on a list of the tracks of its type and a list of the
+ * tracks on its layer, so passes over one kind of object (cars, blocks,
+ * signals) or one layer don't have to skip everything else.  The lists are
+ * kept by NewTrack, SetTrkLayer and FreeTrack and are in order of creation
+ * (or of moving to the layer).  Deleted tracks stay on the lists until they
+ * are freed; the iterators skip them.
+ */
+typedef struct {
+		track_p first;
+		track_p last;
+		} trkListHead_t;
+
+static dynArr_t typeLists_da;
+static dynArr_t layerLists_da;
+
+static trkListHead_t * TrackListHead( dynArr_t * lists_da, int inx )
+{
+	int oldCnt;
+	if ( inx >= lists_da->cnt ) {
+		oldCnt = lists_da->cnt;
+		DYNARR_SET( trkListHead_t, *lists_da, inx+1 );
+		memset( &DYNARR_N( trkListHead_t, *lists_da, oldCnt ), 0,
+				(inx+1-oldCnt) * sizeof (trkListHead_t) );
+	}
+	return &DYNARR_N( trkListHead_t, *lists_da, inx );
+}
+
+
+static void LinkTrackType( track_p trk )
+{
+	trkListHead_t * head = TrackListHead( &typeLists_da, trk->type );
+	trk->lists.typeNext = NULL;
+	trk->lists.typePrev = head->last;
+	if ( head->last )
+		head->last->lists.typeNext = trk;
+	else
+		head->first = trk;
+	head->last = trk;
+}
+
+
+static void UnlinkTrackType( track_p trk )
+{
+	trkListHead_t * head = TrackListHead( &typeLists_da, trk->type );
+	if ( trk->lists.typePrev )
+		trk->lists.typePrev->lists.typeNext = trk->lists.typeNext;
+	else
+		head->first = trk->lists.typeNext;
+	if ( trk->lists.typeNext )
+		trk->lists.typeNext->lists.typePrev = trk->lists.typePrev;
+	else
+		head->last = trk->lists.typePrev;
+	trk->lists.typeNext = trk->lists.typePrev = NULL;
+}
+
+
+static void LinkTrackLayer( track_p trk )
+{
+	trkListHead_t * head = TrackListHead( &layerLists_da, trk->layer );
+	trk->lists.layer = trk->layer;
+	trk->lists.layerNext = NULL;
+	trk->lists.layerPrev = head->last;
+	if ( head->last )
+		head->last->lists.layerNext = trk;
+	else
+		head->first = trk;
+	head->last = trk;
+}
+
+
+static void UnlinkTrackLayer( track_p trk )
+{
+	trkListHead_t * head = TrackListHead( &layerLists_da, trk->lists.layer );
+	if ( trk->lists.layerPrev )
+		trk->lists.layerPrev->lists.layerNext = trk->lists.layerNext;
+	else
+		head->first = trk->lists.layerNext;
+	if ( trk->lists.layerNext )
+		trk->lists.layerNext->lists.layerPrev = trk->lists.layerPrev;
+	else
+		head->last = trk->lists.layerPrev;
+	trk->lists.layerNext = trk->lists.layerPrev = NULL;
+}
+
+
+/**
+ * Move a track to the list of its current layer.  Called after the layer of
+ * the track was changed.
+ *
+ * \param trk IN the track
+ */
+EXPORT void UpdateTrackLists( track_p trk )
+{
+	if ( trk->lists.layer == trk->layer )
+		return;
+	UnlinkTrackLayer( trk );
+	LinkTrackLayer( trk );
+}
+
+
+/**
+ * Step through the tracks of one type.  Works like TrackIterate.
+ *
+ * \param type IN the track type
+ * \param trk IN/OUT NULL to start, then the previous track
+ * \return FALSE when there are no more tracks
+ */
+EXPORT BOOL_T TrackIterateType( TRKTYP_T type, track_p * trk )
+{
+	track_p trk1;
+	if (!*trk)
+		trk1 = ( type >= 0 && type < typeLists_da.cnt ) ?
+				DYNARR_N( trkListHead_t, typeLists_da, type ).first : NULL;
+	else
+		trk1 = (*trk)->lists.typeNext;
+	while (trk1 && IsTrackDeleted(trk1))
+		trk1 = trk1->lists.typeNext;
+	*trk = trk1;
+	return trk1 != NULL;
+}
+
+
+/**
+ * Step through the tracks on one layer.  Works like TrackIterate.
+ *
+ * \param layer IN the layer
+ * \param trk IN/OUT NULL to start, then the previous track
+ * \return FALSE when there are no more tracks
+ */
+EXPORT BOOL_T TrackIterateLayer( unsigned int layer, track_p * trk )
+{
+	track_p trk1;
+	if (!*trk)
+		trk1 = ( layer < (unsigned int)layerLists_da.cnt ) ?
+				DYNARR_N( trkListHead_t, layerLists_da, layer ).first : NULL;
+	else
+		trk1 = (*trk)->lists.layerNext;
+	while (trk1 && IsTrackDeleted(trk1))
+		trk1 = trk1->lists.layerNext;
+	*trk = trk1;
+	return trk1 != NULL;
+}
+
 
 static struct {
 		track_p first;
@@ -1008,16 +1496,234 @@ static struct {
 		wIndex_t count;
 		wIndex_t changed;
 		TRKINX_T max_index;
+		long max_seq;
+		dynArr_t trackIndex_da;
+		trkHot_t trkHot;
+		trkSel_t trkSel;
+		long selectedTrackCount;
+		dynArr_t typeLists_da;
+		dynArr_t layerLists_da;
 		} savedTrackState;
 
 
-EXPORT void RenumberTracks( void )
+static void IndexTrack( track_p trk )
+{
+	TRKINX_T inx = trk->index;
+	int oldCnt, newCnt;
+	if ( inx <= 0 )
+		return;
+	if ( inx >= trackIndex_da.cnt ) {
+		oldCnt = trackIndex_da.cnt;
+		newCnt = 2*oldCnt;
+		if ( newCnt <= inx )
+			newCnt = inx+1;
+		DYNARR_SET( track_p, trackIndex_da, newCnt );
+		memset( &trackIndex(oldCnt), 0, (newCnt-oldCnt) * sizeof trackIndex(0) );
+	}
+	trackIndex(inx) = trk;
+}
+
+
+/**
+ * Remove a track from the index table.  Only the entry pointing to this track
+ * is cleared, so a track sharing the index is not affected.
+ *
+ * \param trk IN the track which is about to be freed
+ */
+EXPORT void UnindexTrack( track_p trk )
+{
+	TRKINX_T inx = trk->index;
+	if ( inx > 0 && inx < trackIndex_da.cnt && trackIndex(inx) == trk )
+		trackIndex(inx) = NULL;
+}
+
+
+/**
+ * Give a track another index, see UndoLogRenumber.  The track which had the
+ * new index before must be given its own before it is looked up again.
+ *
+ * \param trk IN the track
+ * \param index IN the new index
+ */
+EXPORT void ReindexTrack( track_p trk, TRKINX_T index )
+{
+	UnindexTrack( trk );
+	trk->index = index;
+	if ( max_index < index )
+		max_index = index;
+	IndexTrack( trk );
+}
+
+
+/*
+ * Live tracks are numbered SEQ_GAP apart so the tracks on the undo graveyard
+ * (see cundo.c) can be given a seq between their live neighbours.
+ */
+#define SEQ_GAP			(1024)
+
+typedef struct {
+		long seq;
+		track_p trk;
+		} trkSeq_t;
+static dynArr_t liveSeq_da;
+static dynArr_t deadSeq_da;
+
+static int CompareTrkSeq( const void * a, const void * b )
+{
+	long seq1 = ((trkSeq_t*)a)->seq;
+	long seq2 = ((trkSeq_t*)b)->seq;
+	return ( seq1 < seq2 ) ? -1 : ( seq1 > seq2 ) ? 1 : 0;
+}
+
+
+/**
+ * Number the tracks in list order.  A track on the graveyard follows the live
+ * track that preceded it before, so undo can put it back in the same place.
+ *
+ * \param renumber IN also assign new indexes
+ */
+static void SequenceTracks( BOOL_T renumber )
 {
 	track_p trk;
-	max_index = 0;
+	track_p graveyard = UndoGraveyard();
+	long seq = 0;
+	long base = -1;
+	long rank = 0;
+	int inx, live;
+
+	/* the checkpoint journal records new indexes, but not a new order */
+	if ( !renumber )
+		UndoJournalBreak();
+	DYNARR_RESET( trkSeq_t, liveSeq_da );
+	DYNARR_RESET( trkSeq_t, deadSeq_da );
+	if ( renumber ) {
+		/* the tracks not read yet keep their indexes, see trkbin.c */
+		max_index = HiddenLayerMaxIndex();
+		if ( trackIndex_da.cnt > 0 )
+			memset( trackIndex_da.ptr, 0, trackIndex_da.cnt * sizeof trackIndex(0) );
+	}
 	for (trk=to_first; trk!=NULL; trk=trk->next) {
-		trk->index = ++max_index;
+		if ( graveyard ) {
+			DYNARR_APPEND( trkSeq_t, liveSeq_da, 1000 );
+			DYNARR_LAST( trkSeq_t, liveSeq_da ).seq = trk->seq;
+			DYNARR_LAST( trkSeq_t, liveSeq_da ).trk = trk;
+		}
+		seq += SEQ_GAP;
+		trk->seq = seq;
+		if ( renumber ) {
+			UndoLogRenumber( trk, max_index+1 );
+			UndoJournalRenumber( trk, max_index+1 );
+			trk->index = ++max_index;
+			IndexTrack( trk );
+		}
+	}
+	max_seq = seq + SEQ_GAP;
+	trkSel.sorted = FALSE;
+	if ( graveyard ) {
+		for (trk=graveyard; trk!=NULL; trk=trk->next) {
+			DYNARR_APPEND( trkSeq_t, deadSeq_da, 100 );
+			DYNARR_LAST( trkSeq_t, deadSeq_da ).seq = trk->seq;
+			DYNARR_LAST( trkSeq_t, deadSeq_da ).trk = trk;
+		}
+		qsort( liveSeq_da.ptr, liveSeq_da.cnt, sizeof (trkSeq_t), CompareTrkSeq );
+		qsort( deadSeq_da.ptr, deadSeq_da.cnt, sizeof (trkSeq_t), CompareTrkSeq );
+		live = 0;
+		for ( inx=0; inx<deadSeq_da.cnt; inx++ ) {
+			trkSeq_t * dead = &DYNARR_N( trkSeq_t, deadSeq_da, inx );
+			while ( live < liveSeq_da.cnt &&
+					DYNARR_N( trkSeq_t, liveSeq_da, live ).seq < dead->seq )
+				live++;
+			seq = (live>0) ? DYNARR_N( trkSeq_t, liveSeq_da, live-1 ).trk->seq : 0;
+			if ( seq != base ) {
+				base = seq;
+				rank = 0;
+			}
+			if ( rank < SEQ_GAP-1 )
+				rank++;
+			dead->trk->seq = base + rank;
+			if ( renumber ) {
+				UndoLogRenumber( dead->trk, max_index+1 );
+				dead->trk->index = ++max_index;
+				IndexTrack( dead->trk );
+			}
+		}
+	}
+	if ( renumber ) {
+		UndoLogRenumberDone();
+		UndoJournalRenumberDone();
+	}
+	HotRebuild();
+}
+
+
+EXPORT void RenumberTracks( void )
+{
+	SequenceTracks( TRUE );
+}
+
+
+/**
+ * Number the tracks in list order after the list has been rearranged.
+ * The order is used to sort the results of spatial queries (GridFindTracks).
+ */
+static void ResequenceTracks( void )
+{
+	SequenceTracks( FALSE );
+}
+
+
+static dynArr_t sortTrk_da;
+static dynArr_t sortHot_da;
+
+static int CompareTrkIndex( const void * a, const void * b )
+{
+	TRKINX_T inx1 = (*(track_p*)a)->index;
+	TRKINX_T inx2 = (*(track_p*)b)->index;
+	return ( inx1 < inx2 ) ? -1 : ( inx1 > inx2 ) ? 1 : 0;
+}
+
+
+/**
+ * Put the tracks from *start to the end of the list into index order after
+ * they were read in another order, see trkbin.c.  The seqs and hot field
+ * slots of these tracks are ascending in list order, so the tracks trade them
+ * among themselves and the rest of the list is left alone.
+ *
+ * \param start IN link to the first track to sort
+ */
+EXPORT void SortTracksByIndex( track_p * start )
+{
+	track_p trk;
+	int inx;
+
+	DYNARR_RESET( track_p, sortTrk_da );
+	DYNARR_RESET( trkSeq_t, liveSeq_da );
+	DYNARR_RESET( int, sortHot_da );
+	for (trk=*start; trk!=NULL; trk=trk->next) {
+		DYNARR_APPEND( track_p, sortTrk_da, 1000 );
+		DYNARR_LAST( track_p, sortTrk_da ) = trk;
+		DYNARR_APPEND( trkSeq_t, liveSeq_da, 1000 );
+		DYNARR_LAST( trkSeq_t, liveSeq_da ).seq = trk->seq;
+		DYNARR_APPEND( int, sortHot_da, 1000 );
+		DYNARR_LAST( int, sortHot_da ) = HotValid( trk ) ? trk->hot : -1;
 	}
+	if ( sortTrk_da.cnt < 2 )
+		return;
+	qsort( sortTrk_da.ptr, sortTrk_da.cnt, sizeof (track_p), CompareTrkIndex );
+	for ( inx=0; inx<sortTrk_da.cnt; inx++ ) {
+		trk = DYNARR_N( track_p, sortTrk_da, inx );
+		*start = trk;
+		start = &trk->next;
+		trk->seq = DYNARR_N( trkSeq_t, liveSeq_da, inx ).seq;
+		trk->hot = DYNARR_N( int, sortHot_da, inx );
+		if ( trk->hot >= 0 ) {
+			trkHot.trk[trk->hot] = trk;
+			HotSet( trk->hot, trk );
+		}
+	}
+	*start = NULL;
+	to_last = start;
+	trkSel.sorted = FALSE;
 }
 
 
@@ -1025,7 +1731,7 @@ EXPORT track_p NewTrack( TRKINX_T index, TRKTYP_T type, EPINX_T endCnt, CSIZE_T
 {
 	track_p trk;
 	EPINX_T ep;
-	trk = (track_p ) MyMalloc( sizeof *trk );
+	trk = (track_p ) PoolAlloc( sizeof *trk );
 	*to_last = trk;
 	to_last = &trk->next;
 	trk->next = NULL;
@@ -1036,6 +1742,7 @@ EXPORT track_p NewTrack( TRKINX_T index, TRKTYP_T type, EPINX_T endCnt, CSIZE_T
 	}
 LOG( log_track, 1, ( "NewTrack( T%d, t%d, E%d, X%ld)\n", index, type, endCnt, extraSize ) )
 	trk->index = index;
+	IndexTrack( trk );
 	trk->type = type;
 	trk->layer = curLayer;
 	trk->scale = (char)GetLayoutCurScale();
@@ -1044,16 +1751,15 @@ LOG( log_track, 1, ( "NewTrack( T%d, t%d, E%d, X%ld)\n", index, type, endCnt, ex
 	trk->elev = 0;
 	trk->endCnt = endCnt;
 	trk->hi.x = trk->hi.y = trk->lo.x = trk->lo.y = (float)0.0;
-	if (endCnt) {
-		trk->endPt = (trkEndPt_p)MyMalloc( endCnt * sizeof *trk->endPt );
-		for ( ep = 0; ep < endCnt; ep++ )
-			trk->endPt[ep].index = -1;
-	} else
-		trk->endPt = NULL;
-	if (extraSize) {
-		trk->extraData = MyMalloc( extraSize );
-	} else
-		trk->extraData = NULL;
+	trk->seq = ++max_seq;
+	GridAddTrack( trk );
+	HotAppend( trk );
+	LinkTrackType( trk );
+	LinkTrackLayer( trk );
+	trk->endPt = (trkEndPt_p)PoolAlloc( endCnt * sizeof *trk->endPt );
+	for ( ep = 0; ep < endCnt; ep++ )
+		trk->endPt[ep].index = -1;
+	trk->extraData = PoolAlloc( extraSize );
 	trk->extraSize = extraSize;
 	UndoNew( trk );
 	trackCount++;
@@ -1065,27 +1771,44 @@ LOG( log_track, 1, ( "NewTrack( T%d, t%d, E%d, X%ld)\n", index, type, endCnt, ex
 
 EXPORT void FreeTrack( track_p trk )
 {
+	UnindexTrack( trk );
+	GridDeleteTrack( trk );
+	HotRemove( trk );
+	SelRemove( trk );
+	UnlinkTrackType( trk );
+	UnlinkTrackLayer( trk );
 	trackCmds(trk->type)->delete( trk );
-	if (trk->endPt)
-		MyFree(trk->endPt);
-	if (trk->extraData)
-		MyFree(trk->extraData);
-	MyFree(trk);
+	PoolFree( trk->endPt, trk->endCnt * sizeof *trk->endPt );
+	PoolFree( trk->extraData, trk->extraSize );
+	PoolFree( trk, sizeof *trk );
 }
 
 
 EXPORT void ClearTracks( void )
 {
 	track_p curr, next;
+	UndoLogClose();
 	UndoClear();
 	ClearNote();
 	for (curr = to_first; curr; curr=next) {
 		next = curr->next;
 		FreeTrack( curr );
 	}
+	UndoFreeGraveyard();
+	FreeHiddenLayers();
 	to_first = NULL;
 	to_last = &to_first;
 	max_index = 0;
+	max_seq = 0;
+	DYNARR_RESET( track_p, trackIndex_da );
+	trkHot.cnt = trkHot.dead = 0;
+	DYNARR_RESET( trkSelSlot_t, trkSel.slots_da );
+	trkSel.unused = 0;
+	trkSel.sorted = TRUE;
+	trkSel.lastSeq = 0;
+	selectedTrackCount = 0;
+	DYNARR_RESET( trkListHead_t, typeLists_da );
+	DYNARR_RESET( trkListHead_t, layerLists_da );
 	changed = checkPtMark = 0;
 	trackCount = 0;
 	ClearCars();
@@ -1096,10 +1819,12 @@ EXPORT void ClearTracks( void )
 EXPORT track_p FindTrack( TRKINX_T index )
 {
 	track_p trk;
-	TRK_ITERATE(trk) {
-		if (trk->index == index) return trk;
-	}
-	return NULL;
+	if ( index <= 0 || index >= trackIndex_da.cnt )
+		return NULL;
+	trk = trackIndex(index);
+	if ( trk == NULL || trk->deleted )
+		return NULL;
+	return trk;
 }
 
 
@@ -1111,6 +1836,10 @@ EXPORT void ResolveIndex( void )
 		LOG (log_track, 1, ( "ResNextTrack( T%d, t%d, E%d, X%ld)\n", trk->index, trk->type, trk->endCnt, trk->extraSize ));
 		for (ep=0; ep<trk->endCnt; ep++)
 			if (trk->endPt[ep].index >= 0) {
+				/* binary layout files carry their links resolved, see trkbin.c */
+				if (trk->endPt[ep].track != NULL &&
+					trk->endPt[ep].track->index == trk->endPt[ep].index)
+					continue;
 				trk->endPt[ep].track = FindTrack( trk->endPt[ep].index );
 				if (trk->endPt[ep].track == NULL) {
 					int rc = NoticeMessage( MSG_RESOLV_INDEX_BAD_TRK, _("Continue"), _("Quit"), trk->index, ep, trk->endPt[ep].index );
@@ -1118,6 +1847,7 @@ EXPORT void ResolveIndex( void )
 						return;
 				}
 			}
+		GridUpdateEndPts( trk );
                 ResolveBlockTrack (trk);
                 ResolveSwitchmotorTurnout (trk);
         }
@@ -1167,22 +1897,53 @@ EXPORT void SaveTrackState( void )
 	savedTrackState.count = trackCount;
 	savedTrackState.changed = changed;
 	savedTrackState.max_index = max_index;
+	savedTrackState.max_seq = max_seq;
+	savedTrackState.trackIndex_da = trackIndex_da;
+	savedTrackState.trkHot = trkHot;
+	savedTrackState.trkSel = trkSel;
+	savedTrackState.selectedTrackCount = selectedTrackCount;
+	savedTrackState.typeLists_da = typeLists_da;
+	savedTrackState.layerLists_da = layerLists_da;
 	to_first = NULL;
 	to_last = &to_first;
 	trackCount = 0;
 	changed = 0;
 	max_index = 0;
+	max_seq = 0;
+	memset( &trackIndex_da, 0, sizeof trackIndex_da );
+	memset( &trkHot, 0, sizeof trkHot );
+	memset( &trkSel, 0, sizeof trkSel );
+	trkSel.sorted = TRUE;
+	selectedTrackCount = 0;
+	memset( &typeLists_da, 0, sizeof typeLists_da );
+	memset( &layerLists_da, 0, sizeof layerLists_da );
+	UndoSaveGraveyard();
+	GridSaveState();
 	SaveCarState();
 	InfoCount( trackCount );
 }
 
 EXPORT void RestoreTrackState( void )
 {
+	UndoRestoreGraveyard();
 	to_first = savedTrackState.first;
 	to_last = savedTrackState.last;
 	trackCount = savedTrackState.count;
 	changed = savedTrackState.changed;
 	max_index = savedTrackState.max_index;
+	max_seq = savedTrackState.max_seq;
+	DYNARR_FREE( track_p, trackIndex_da );
+	trackIndex_da = savedTrackState.trackIndex_da;
+	HotFree( &trkHot );
+	trkHot = savedTrackState.trkHot;
+	DYNARR_FREE( trkSelSlot_t, trkSel.slots_da );
+	trkSel = savedTrackState.trkSel;
+	selectedTrackCount = savedTrackState.selectedTrackCount;
+	DYNARR_FREE( trkListHead_t, typeLists_da );
+	DYNARR_FREE( trkListHead_t, layerLists_da );
+	typeLists_da = savedTrackState.typeLists_da;
+	layerLists_da = savedTrackState.layerLists_da;
+	GridRestoreState();
 	RestoreCarState();
 	InfoCount( trackCount );
 }
@@ -1332,6 +2093,7 @@ EXPORT void SelectAbove( void )
 	if (xtrk) {
 		*to_last = xtrk;
 		to_last = &ltrk->next;
+		ResequenceTracks();
 	}
 	UndoEnd();
 	DrawSelectedTracks( &mainD );
@@ -1368,6 +2130,7 @@ EXPORT void SelectBelow( void )
 		}
 		ltrk->next = to_first;
 		to_first = xtrk;
+		ResequenceTracks();
 		highest.x -= lowest.x;
 		highest.y -= lowest.y;
 		DrawTracks( &mainD, 0.0, lowest, highest );
@@ -1452,6 +2215,19 @@ if (bsearchRead) {
 }
 
 
+/**
+ * Write the layout file record of one track.
+ *
+ * \param trk IN the track
+ * \param f IN output file
+ * \return FALSE on a write error
+ */
+EXPORT BOOL_T WriteTrack( track_p trk, FILE * f )
+{
+	return trackCmds(GetTrkType(trk))->write( trk, f );
+}
+
+
 EXPORT BOOL_T WriteTracks( FILE * f, wBool_t bFull )
 {
 	track_p trk;
@@ -1471,9 +2247,19 @@ EXPORT BOOL_T WriteTracks( FILE * f, wBool_t bFull )
 
 
 
+/*
+ * The imported tracks are indexed in a table of their own, so they do not
+ * take the slots of the tracks of the layout and ResolveIndex only connects
+ * them to each other.  ImportEnd puts the layout's table back and
+ * RenumberTracks gives the imported tracks their own indexes.
+ */
+static dynArr_t importSavedIndex_da;
+
 EXPORT void ImportStart( void )
 {
 	importTrack = to_last;
+	importSavedIndex_da = trackIndex_da;
+	memset( &trackIndex_da, 0, sizeof trackIndex_da );
 }
 
 
@@ -1551,6 +2337,9 @@ EXPORT void ImportEnd( coOrd offset, wBool_t import, wBool_t inPlace )
 	trackCountOld = trackCount;
 	ResolveIndex();
 	to_first = to_firstOld;
+	DYNARR_FREE( track_p, trackIndex_da );
+	trackIndex_da = importSavedIndex_da;
+	memset( &importSavedIndex_da, 0, sizeof importSavedIndex_da );
 	RenumberTracks();
 
 	// move the imported track into place
@@ -1560,6 +2349,7 @@ EXPORT void ImportEnd( coOrd offset, wBool_t import, wBool_t inPlace )
 		move.y = offset.y;
 		MoveTrack( trk, move );// mainD.orig );
 		trk->bits |= TB_SELECTED;
+		HotUpdateTrack( trk );
 		DrawTrack( trk, &mainD, wDrawColorBlack );
 	}
 	importTrack = NULL; 
@@ -1715,6 +2505,10 @@ EXPORT void AuditTracks( char * event, ... )
 			if (!auditCmd( trk, msgp ))
 				AuditPrint( msg );
 		}
+		if (FindTrack(trk->index) != trk) {
+			sprintf( msgp, "T%d: not found in track index\n", trk->index );
+			AuditPrint( msg );
+		}
 		if (trk->index < 8*sizeof used) {
 			if (BIT_SET(used,trk->index)) {
 				sprintf( msgp, "T%d: index used again\n", trk->index );
@@ -1728,6 +2522,7 @@ EXPORT void AuditTracks( char * event, ... )
 					sprintf( msgp, "T%d[%d]: T%d is deleted\n", trk->index, i, tn->index );
 					AuditPrint( msg );
 					trk->endPt[i].track = NULL;
+					GridUpdateEndPts( trk );
 				} else {
 					for (j=0;j<tn->endCnt;j++)
 						if (tn->endPt[j].track == trk)
@@ -1735,6 +2530,7 @@ EXPORT void AuditTracks( char * event, ... )
 					sprintf( msgp, "T%d[%d]: T%d doesn\'t point back\n", trk->index, i, tn->index );
 					AuditPrint( msg );
 					trk->endPt[i].track = NULL;
+					GridUpdateEndPts( trk );
 				}
 			}
 nextEndPt:;
@@ -1780,6 +2576,8 @@ EXPORT void ComputeRectBoundingBox( track_p trk, coOrd p0, coOrd p1 )
 	trk->lo.y = (float)min(p0.y, p1.y);
 	trk->hi.x = (float)max(p0.x, p1.x);
 	trk->hi.y = (float)max(p0.y, p1.y);
+	GridUpdateTrack( trk );
+	HotUpdateTrack( trk );
 }
 
 
@@ -1802,6 +2600,8 @@ EXPORT void ComputeBoundingBox( track_p trk )
 		if (trk->endPt[i].pos.y < trk->lo.y)
 			trk->lo.y = (float)trk->endPt[i].pos.y;
 	}
+	GridUpdateTrack( trk );
+	HotUpdateTrack( trk );
 }
 
 
@@ -1962,12 +2762,14 @@ LOG( log_track, 3, ( "ConnectTracks( T%d[%d] @ [%0.3f, %0.3f] = T%d[%d] @ [%0.3f
 		NoticeMessage( MSG_CONNECT_TRK, _("Continue"), NULL, trk0->index, inx0, trk1->index, inx1, d, a );
 		return -1; /* Stop connecting out of alignment tracks! */
 	}
-	UndoModify( trk0 );
-	UndoModify( trk1 );
+	UndoConnect( trk0 );
+	UndoConnect( trk1 );
 	if (!suspendElevUpdates)
 		SetTrkElevModes( TRUE, trk0, inx0, trk1, inx1 );
 	trk0->endPt[inx0].track = trk1;
 	trk1->endPt[inx1].track = trk0;
+	GridUpdateEndPts( trk0 );
+	GridUpdateEndPts( trk1 );
 	AuditTracks( "connectTracks T%d[%d], T%d[%d]", trk0->index, inx0, trk1->index, inx1 );
 	return 0;
 }
@@ -1978,10 +2780,12 @@ EXPORT void DisconnectTracks( track_p trk1, EPINX_T ep1, track_p trk2, EPINX_T e
 	if (trk1->endPt[ep1].track != trk2 ||
 		trk2->endPt[ep2].track != trk1 )
 		AbortProg("disconnectTracks: tracks not connected" );
-	UndoModify( trk1 );
-	UndoModify( trk2 );
+	UndoConnect( trk1 );
+	UndoConnect( trk2 );
 	trk1->endPt[ep1].track = NULL;
 	trk2->endPt[ep2].track = NULL;
+	GridUpdateEndPts( trk1 );
+	GridUpdateEndPts( trk2 );
 	if (!suspendElevUpdates)
 		SetTrkElevModes( FALSE, trk1, ep1, trk2, ep2 );
 }
@@ -3019,6 +3823,7 @@ static void DrawATrack( track_cp trk, wDrawColor color )
 EXPORT void DrawNewTrack( track_cp t )
 {
 	t->bits &= ~TB_UNDRAWN;
+	HotUpdateTrack( t );
 	DrawATrack( t, wDrawColorBlack );
 }
 
@@ -3026,6 +3831,7 @@ EXPORT void UndrawNewTrack( track_cp t )
 {
 	DrawATrack( t, wDrawColorWhite );
 	t->bits |= TB_UNDRAWN;
+	HotUpdateTrack( t );
 }
 
 EXPORT int doDrawPositionIndicator = 1;
@@ -3291,36 +4097,44 @@ EXPORT void DrawEndPt2(
 EXPORT void DrawTracks( drawCmd_p d, DIST_T scale, coOrd orig, coOrd size )
 {
 	track_cp trk;
+	track_p trk1;
+	trkSelIter_t selIter;
 	TRKINX_T inx;
 	wIndex_t count = 0;
-	coOrd lo, hi;
+	coOrd hi;
 	BOOL_T doSelectRecount = FALSE;
+	dynArr_t trks_da;
+	int trkInx;
 	
 	inDrawTracks = TRUE;
 	InfoCount( 0 );
 
-	TRK_ITERATE( trk ) {
+	for ( trk1=NULL; SelectedTrackIterate( &selIter, &trk1 ); ) {
+		if ( (!GetLayerVisible(trk1->layer)) ||
+			 (drawTunnel==0 && (trk1->bits&TB_VISIBLE) == 0) ) {
+			ClrTrkBits( trk1, TB_SELECTED );
+			doSelectRecount = TRUE;
+		}
+	}
+
+	memset( &trks_da, 0, sizeof trks_da );
+	hi.x = orig.x + size.x;
+	hi.y = orig.y + size.y;
+	GridFindTracks( orig, hi, d == &mapD ? GetLayerOnMap : GetLayerVisible, &trks_da );
+	for ( trkInx=0; trkInx<trks_da.cnt; trkInx++ ) {
+		trk = DYNARR_N( track_p, trks_da, trkInx );
 		if ( (d->options&DC_PRINT) != 0 &&
 			 wPrintQuit() ) {
+			DYNARR_FREE( track_p, trks_da );
 			inDrawTracks = FALSE;
 			return;
 		}
-		if ( GetTrkSelected(trk) && 
-			( (!GetLayerVisible(GetTrkLayer(trk))) ||
-			  (drawTunnel==0 && !GetTrkVisible(trk)) ) ) {
-			ClrTrkBits( trk, TB_SELECTED );
-			doSelectRecount = TRUE;
-		}
-		GetBoundingBox( trk, &hi, &lo );
-		if ( OFF_D( orig, size, lo, hi ) ||
-			(d != &mapD && !GetLayerVisible( GetTrkLayer(trk) ) ) ||
-			(d == &mapD && !GetLayerOnMap( GetTrkLayer(trk) ) ) )
-			continue;
 		DrawTrack( trk, d, wDrawColorBlack );
 		count++;
 		if (count%10 == 0) 
 			InfoCount( count );
 	}
+	DYNARR_FREE( track_p, trks_da );
 
 	if (d == &mainD) {
 		for (inx=1; inx<trackCmds_da.cnt; inx++)
@@ -61,6 +61,7 @@ extern wDrawColor tieColor;
 
 
 extern TRKINX_T max_index;
+extern long max_seq;
 
 typedef signed char * PATHPTR_T;
 extern PATHPTR_T pathPtr;
@@ -213,6 +214,11 @@ typedef struct {
 extern dynArr_t tempEndPts_da;
 #define tempEndPts(N) DYNARR_N( trkEndPt_t, tempEndPts_da, N )
 
+typedef struct {
+		track_p trk;
+		EPINX_T ep;
+		} trkEndPtRef_t;
+
 typedef enum { FREEFORM, RECTANGLE, POLYLINE
 } PolyType_e;
 
@@ -597,6 +603,7 @@ wBool_t CompareTrack( track_cp, track_cp );
 
 void MoveTrack( track_p, coOrd );
 void RotateTrack( track_p, coOrd, ANGLE_T );
+BOOL_T CanRotateTrack( track_p );
 void RescaleTrack( track_p, FLOAT_T, coOrd );
 #define GNTignoreIgnore (1<<0)
 #define GNTfirstDefined (1<<1)
@@ -644,16 +651,40 @@ DIST_T EndPtDescriptionDistance( coOrd, track_p, EPINX_T, coOrd *, BOOL_T show_h
 STATUS_T EndPtDescriptionMove( track_p, EPINX_T, wAction_t, coOrd );
 
 track_p FindTrack( TRKINX_T );
+void UnindexTrack( track_p );
+void ReindexTrack( track_p, TRKINX_T );
+void HotUpdateTrack( track_p );
+void HotRebuild( void );
+typedef BOOL_T (*layerTest_p)( unsigned int );
+void HotFindTracks( coOrd, coOrd, layerTest_p, dynArr_t * );
+void UpdateTrackLists( track_p );
 void ResolveIndex( void );
 void RenumberTracks( void );
+void SortTracksByIndex( track_p * );
 BOOL_T ReadTrack( char * );
+BOOL_T WriteTrack( track_p, FILE * );
 BOOL_T WriteTracks( FILE *, wBool_t );
+BOOL_T WriteTracksBinary( FILE *, BOOL_T (*)( FILE * ), wBool_t );
+BOOL_T IsTracksBinary( const char *, size_t );
+BOOL_T ReadTracksBinary( char *, size_t, BOOL_T (*)( unsigned int ) );
+BOOL_T LoadHiddenLayers( BOOL_T );
+void FreeHiddenLayers( void );
+long HiddenLayerTrackCount( unsigned int );
+TRKINX_T HiddenLayerMaxIndex( void );
 BOOL_T ExportTracks( FILE * , coOrd *);
 void ImportStart( void );
 void ImportEnd( coOrd , wBool_t, wBool_t);
 void FreeTrack( track_p );
 void ClearTracks( void );
 BOOL_T TrackIterate( track_p * );
+typedef struct {
+		int inx;
+		long seq;
+		long tidyCnt;
+		} trkSelIter_t;
+BOOL_T SelectedTrackIterate( trkSelIter_t *, track_p * );
+BOOL_T TrackIterateType( TRKTYP_T, track_p * );
+BOOL_T TrackIterateLayer( unsigned int, track_p * );
 
 void LoosenTracks( void );
 
@@ -685,6 +716,7 @@ char * GetTrkTypeName( track_p );
 BOOL_T RebuildTrackSegs(track_p);
 BOOL_T StoreTrackData(track_p, void **, long *);
 BOOL_T ReplayTrackData(track_p, void *, long);
+BOOL_T HasTrackData(track_p);
 
 DIST_T GetFlexLength( track_p, EPINX_T, coOrd * );
 void LabelLengths( drawCmd_p, track_p, wDrawColor );
@@ -794,12 +826,30 @@ void AddHotBarTurnouts( void );
 void AddHotBarStructures( void );
 void AddHotBarCarDesc( void );
 
+/* trkpool.c */
+void * PoolAlloc( long );
+void PoolFree( void *, long );
+void * PoolRealloc( void *, long, long );
+
+/* trkgrid.c */
+void GridAddTrack( track_p );
+void GridDeleteTrack( track_p );
+void GridUpdateTrack( track_p );
+void GridFindTracks( coOrd, coOrd, layerTest_p, dynArr_t * );
+void GridFindTracksNear( coOrd, DIST_T, layerTest_p, dynArr_t * );
+void GridUpdateEndPts( track_p );
+void GridFindEndPtsNear( coOrd, DIST_T, dynArr_t * );
+void GridSaveState( void );
+void GridRestoreState( void );
+
 /* cblock.c */
 void CheckDeleteBlock( track_p t );
 void ResolveBlockTrack ( track_p trk );
+void RenumberBlockTrack ( track_p trk );
 /* cswitchmotor.c */
 void CheckDeleteSwitchmotor( track_p t );
 void ResolveSwitchmotorTurnout ( track_p trk );
+void RenumberSwitchmotorTurnout ( track_p trk );
 
 #endif
 
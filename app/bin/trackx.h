@@ -29,6 +29,22 @@
 
 struct extraData;
 
+typedef struct {
+		int x0, y0, x1, y1;		/**< grid cells covered, see trkgrid.c */
+		BOOL_T large;			/**< on the list of large tracks instead */
+		BOOL_T inGrid;
+		unsigned long mark;		/**< last query which visited this track */
+		dynArr_t endPts_da;		/**< endpoint cells registered, see trkgrid.c */
+		} trkGrid_t;
+
+typedef struct {
+		struct track_t * typeNext;		/**< tracks of the same type */
+		struct track_t * typePrev;
+		struct track_t * layerNext;		/**< tracks on the same layer */
+		struct track_t * layerPrev;
+		unsigned int layer;				/**< layer list the track is on */
+		} trkLists_t;
+
 typedef struct track_t {
 		struct track_t *next;
 		TRKINX_T index;
@@ -47,9 +63,15 @@ typedef struct track_t {
 		struct extraData * extraData;
 		CSIZE_T extraSize;
 		DIST_T elev;
+		long seq;				/**< position in the track list */
+		trkGrid_t grid;
+		int hot;				/**< slot in the hot field arrays, see track.c */
+		int sel;				/**< slot in the selected track vector, see track.c */
+		trkLists_t lists;
 		} track_t;
 
 extern track_p to_first;
 extern track_p * to_last;
+extern dynArr_t trackIndex_da;
 #define TRK_ITERATE(TRK)		for (TRK=to_first; TRK!=NULL; TRK=TRK->next) if (!(TRK->deleted)) 
 #endif
@@ -0,0 +1,810 @@
+/** \file trkbin.c
+ * Binary layout file format
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+
+#include "common.h"
+#include "cundo.h"
+#include "custom.h"
+#include "fileio.h"
+#include "i18n.h"
+#include "misc.h"
+#include "track.h"
+#include "trackx.h"
+#include "utility.h"
+
+/*
+ * A binary layout file (.xtcb) is a header, the sections and a table of the
+ * sections.  All numbers are unsigned little-endian; offsets are from the
+ * start of the file.
+ *
+ *	header		magic[8] version sectionCnt trackCnt tableOffset
+ *	table entry	kind layer recordCnt offset size
+ *
+ * TRKBIN_TEXT and TRKBIN_CARS sections hold the lines of a layout file which
+ * come before and after the tracks.  Each TRKBIN_TRACKS section holds the
+ * tracks on one layer, so a reader can skip the layers it does not need.  A
+ * track record is
+ *
+ *	index(4) endCnt(2) flags(2) link(4)*endCnt body NUL padding
+ *
+ * where link is the index of the track connected at each endpoint (0 if
+ * none) and body is the record the track type writes to a layout file.  The
+ * type specific data of most tracks points into other memory, so the bodies
+ * are kept as text and handed to the usual readers.  Text is followed by at
+ * least one NUL and padded to a multiple of 4 bytes.
+ *
+ * The tracks are renumbered before writing, so the indexes also give the order
+ * of the track list.
+ *
+ * When a layout is loaded the sections of hidden layers can be left unread.
+ * A copy of each is kept and read by LoadHiddenLayers once the layer is
+ * shown or made current, or when all tracks are needed; a binary layout file
+ * or check point written meanwhile gets the copies.  Hidden layers which
+ * are connected to a layer being read are read with it, so endpoints never
+ * link read and unread tracks.  Blocks and switch motors refer to tracks by
+ * index on any layer, so nothing is left unread if there are any.
+ */
+
+#define TRKBIN_MAGIC			"\211XTC\r\n\032\n"
+#define TRKBIN_MAGIC_SIZE		(8)
+#define TRKBIN_VERSION			(1)
+#define TRKBIN_HEADER_SIZE		(TRKBIN_MAGIC_SIZE+4*4)
+#define TRKBIN_SECTION_SIZE		(5*4)
+#define TRKBIN_RECORD_SIZE		(4+2+2)
+
+enum { TRKBIN_TEXT=1, TRKBIN_TRACKS, TRKBIN_CARS };
+
+typedef struct {
+		unsigned long kind;
+		unsigned long layer;
+		unsigned long recordCnt;
+		unsigned long offset;
+		unsigned long size;
+		BOOL_T hidden;					/**< not read yet, see HideLayers */
+		} trkBinSection_t;
+
+static dynArr_t trkBinSections_da;
+#define trkBinSections(N) DYNARR_N( trkBinSection_t, trkBinSections_da, N )
+
+typedef struct {
+		track_p trk;
+		const unsigned char * links;
+		} trkBinLinks_t;
+
+static dynArr_t trkBinLinks_da;
+
+typedef struct {
+		TRKINX_T index;
+		EPINX_T endCnt;
+		const unsigned char * links;
+		char * body;
+		char * bodyEnd;
+		} trkBinRecord_t;
+
+typedef struct {
+		char * image;					/**< MyMalloc'd copy of the section */
+		trkBinSection_t sect;			/**< offset is 0 */
+		BOOL_T read;
+		} trkBinHidden_t;
+
+static dynArr_t trkBinHidden_da;
+#define trkBinHidden(N) DYNARR_N( trkBinHidden_t, trkBinHidden_da, N )
+static long trkBinHiddenVersion;		/**< paramVersion of the file */
+static char * trkBinHiddenFile = NULL;	/**< paramFileName of the file */
+static TRKINX_T trkBinHiddenMaxIndex = 0;	/**< highest index of the unread tracks */
+
+/* Records which refer to tracks by index, see above */
+static const char * trkBinIndexRefs[] = { "BLOCK ", "SWITCHMOTOR ", NULL };
+
+static dynArr_t trkBinIndexSet_da;		/**< one char per track index */
+
+static int log_trkbin = 0;
+static BOOL_T log_trkbinInitted = FALSE;
+
+
+static void LogTrkBinInit( void )
+{
+	if ( !log_trkbinInitted ) {
+		log_trkbin = LogFindIndex( "trkbin" );
+		log_trkbinInitted = TRUE;
+	}
+}
+
+
+static BOOL_T PutU16( FILE * f, unsigned int val )
+{
+	unsigned char b[2];
+	b[0] = (unsigned char)(val & 0xFF);
+	b[1] = (unsigned char)((val>>8) & 0xFF);
+	return fwrite( b, 1, sizeof b, f ) == sizeof b;
+}
+
+
+static BOOL_T PutU32( FILE * f, unsigned long val )
+{
+	unsigned char b[4];
+	b[0] = (unsigned char)(val & 0xFF);
+	b[1] = (unsigned char)((val>>8) & 0xFF);
+	b[2] = (unsigned char)((val>>16) & 0xFF);
+	b[3] = (unsigned char)((val>>24) & 0xFF);
+	return fwrite( b, 1, sizeof b, f ) == sizeof b;
+}
+
+
+static unsigned int GetU16( const unsigned char * p )
+{
+	return p[0] | (p[1]<<8);
+}
+
+
+static unsigned long GetU32( const unsigned char * p )
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1]<<8) |
+		   ((unsigned long)p[2]<<16) | ((unsigned long)p[3]<<24);
+}
+
+
+/* Terminate text with a NUL and pad to a multiple of 4 bytes */
+static BOOL_T PutPad( FILE * f )
+{
+	static const char zeros[4] = { 0, 0, 0, 0 };
+	long pos = ftell( f );
+	if ( pos < 0 )
+		return FALSE;
+	return fwrite( zeros, 1, 4-pos%4, f ) == (size_t)(4-pos%4);
+}
+
+
+static trkBinSection_t * StartSection( FILE * f, unsigned long kind, unsigned long layer )
+{
+	trkBinSection_t * sect;
+	DYNARR_APPEND( trkBinSection_t, trkBinSections_da, 10 );
+	sect = &DYNARR_LAST( trkBinSection_t, trkBinSections_da );
+	sect->kind = kind;
+	sect->layer = layer;
+	sect->recordCnt = 0;
+	sect->offset = ftell( f );
+	sect->size = 0;
+	sect->hidden = FALSE;
+	return sect;
+}
+
+
+static BOOL_T EndSection( FILE * f )
+{
+	trkBinSection_t * sect = &DYNARR_LAST( trkBinSection_t, trkBinSections_da );
+	long pos = ftell( f );
+	if ( pos < 0 )
+		return FALSE;
+	sect->size = pos - sect->offset;
+	return TRUE;
+}
+
+
+static BOOL_T WriteTextSection( FILE * f, unsigned long kind, BOOL_T (*writeText)( FILE * ) )
+{
+	BOOL_T rc = TRUE;
+	StartSection( f, kind, 0 );
+	rc &= writeText( f );
+	rc &= PutPad( f );
+	rc &= EndSection( f );
+	return rc;
+}
+
+
+static BOOL_T WriteTrackRecord( FILE * f, track_p trk )
+{
+	BOOL_T rc = TRUE;
+	EPINX_T ep;
+	track_p trk1;
+	rc &= PutU32( f, GetTrkIndex( trk ) );
+	rc &= PutU16( f, GetTrkEndPtCnt( trk ) );
+	rc &= PutU16( f, 0 );
+	for ( ep=0; ep<GetTrkEndPtCnt( trk ); ep++ ) {
+		trk1 = GetTrkEndTrk( trk, ep );
+		rc &= PutU32( f, trk1 ? GetTrkIndex( trk1 ) : 0 );
+	}
+	rc &= WriteTrack( trk, f );
+	rc &= PutPad( f );
+	return rc;
+}
+
+
+static BOOL_T WriteTrackSection( FILE * f, unsigned int layer )
+{
+	track_p trk = NULL;
+	trkBinSection_t * sect;
+	BOOL_T rc = TRUE;
+	if ( !TrackIterateLayer( layer, &trk ) )
+		return TRUE;
+	sect = StartSection( f, TRKBIN_TRACKS, layer );
+	do {
+		rc &= WriteTrackRecord( f, trk );
+		sect->recordCnt++;
+	} while ( TrackIterateLayer( layer, &trk ) );
+	rc &= EndSection( f );
+	return rc;
+}
+
+
+/*
+ * Copy the sections left unread as they are.  Their tracks keep the indexes
+ * they were read with, which RenumberTracks does not give to other tracks.
+ */
+static BOOL_T WriteHiddenSections( FILE * f )
+{
+	trkBinHidden_t * hidden;
+	trkBinSection_t * sect;
+	BOOL_T rc = TRUE;
+	int inx;
+	for ( inx=0; inx<trkBinHidden_da.cnt; inx++ ) {
+		hidden = &trkBinHidden(inx);
+		sect = StartSection( f, TRKBIN_TRACKS, hidden->sect.layer );
+		sect->recordCnt = hidden->sect.recordCnt;
+		rc &= fwrite( hidden->image, 1, hidden->sect.size, f ) == hidden->sect.size;
+		rc &= EndSection( f );
+	}
+	return rc;
+}
+
+
+/**
+ * Write the tracks in the binary layout format.  Tracks on layers which were
+ * never read are written as they were read, unless the file they came from
+ * was written by another version.
+ *
+ * \param f IN file opened for binary writing
+ * \param writeHeader IN writes the lines that precede the tracks, can be NULL
+ * \param bFull IN renumber the tracks first and include the cars and the layers not read
+ * \return FALSE on a write error
+ */
+EXPORT BOOL_T WriteTracksBinary(
+		FILE * f,
+		BOOL_T (*writeHeader)( FILE * ),
+		wBool_t bFull )
+{
+	BOOL_T rc = TRUE;
+	track_p trk;
+	long trackCnt = 0;
+	unsigned int layer;
+	int inx;
+
+	LogTrkBinInit();
+	if ( bFull ) {
+		if ( trkBinHidden_da.cnt > 0 && trkBinHiddenVersion != iParamVersion )
+			LoadHiddenLayers( TRUE );
+		RenumberTracks();
+		for ( inx=0; inx<trkBinHidden_da.cnt; inx++ )
+			trackCnt += trkBinHidden(inx).sect.recordCnt;
+	}
+	TRK_ITERATE( trk )
+		trackCnt++;
+	DYNARR_RESET( trkBinSection_t, trkBinSections_da );
+
+	/* The section count and table offset are filled in at the end */
+	rc &= fwrite( TRKBIN_MAGIC, 1, TRKBIN_MAGIC_SIZE, f ) == TRKBIN_MAGIC_SIZE;
+	rc &= PutU32( f, TRKBIN_VERSION );
+	rc &= PutU32( f, 0 );
+	rc &= PutU32( f, trackCnt );
+	rc &= PutU32( f, 0 );
+	if ( writeHeader )
+		rc &= WriteTextSection( f, TRKBIN_TEXT, writeHeader );
+	for ( layer=0; layer<NUM_LAYERS; layer++ )
+		rc &= WriteTrackSection( f, layer );
+	if ( bFull ) {
+		rc &= WriteHiddenSections( f );
+		rc &= WriteTextSection( f, TRKBIN_CARS, WriteCars );
+	}
+
+	/* The table goes after the sections */
+	long tableOffset = ftell( f );
+	for ( inx=0; inx<trkBinSections_da.cnt; inx++ ) {
+		trkBinSection_t * sect = &trkBinSections(inx);
+		rc &= PutU32( f, sect->kind );
+		rc &= PutU32( f, sect->layer );
+		rc &= PutU32( f, sect->recordCnt );
+		rc &= PutU32( f, sect->offset );
+		rc &= PutU32( f, sect->size );
+	}
+	rc &= fseek( f, TRKBIN_MAGIC_SIZE+4, SEEK_SET ) == 0;
+	rc &= PutU32( f, trkBinSections_da.cnt );
+	rc &= PutU32( f, trackCnt );
+	rc &= PutU32( f, tableOffset );
+	rc &= fseek( f, 0, SEEK_END ) == 0;
+	LOG( log_trkbin, 1, ( "WriteTracksBinary: %ld tracks, %d sections, %ld bytes\n",
+				trackCnt, trkBinSections_da.cnt, ftell( f ) ) );
+	return rc;
+}
+
+
+/**
+ * Check whether a file image is in the binary layout format.
+ *
+ * \param image IN the file image
+ * \param size IN size of the image
+ * \return TRUE if the image starts with the binary format's magic
+ */
+EXPORT BOOL_T IsTracksBinary( const char * image, size_t size )
+{
+	return image != NULL && size >= TRKBIN_HEADER_SIZE &&
+		   memcmp( image, TRKBIN_MAGIC, TRKBIN_MAGIC_SIZE ) == 0;
+}
+
+
+static BOOL_T BadImage( char * msg )
+{
+	InputError( msg, FALSE );
+	return FALSE;
+}
+
+
+static char * TextEnd( char * text, size_t size )
+{
+	return (char*)memchr( text, '\0', size );
+}
+
+
+/* Decode the record at cp, return the next one or NULL if it is truncated */
+static char * NextTrackRecord( char * image, char * cp, char * end, trkBinRecord_t * rec )
+{
+	if ( end-cp < TRKBIN_RECORD_SIZE )
+		return NULL;
+	rec->index = (TRKINX_T)GetU32( (unsigned char*)cp );
+	rec->endCnt = (EPINX_T)GetU16( (unsigned char*)cp+4 );
+	rec->links = (unsigned char*)cp + TRKBIN_RECORD_SIZE;
+	rec->body = cp + TRKBIN_RECORD_SIZE + 4*rec->endCnt;
+	if ( rec->body >= end || (rec->bodyEnd = TextEnd( rec->body, end-rec->body )) == NULL )
+		return NULL;
+	return image + ((rec->bodyEnd+1-image+3) & ~3);
+}
+
+
+static BOOL_T ReadTrackRecords( char * image, trkBinSection_t * sect )
+{
+	char * cp = image + sect->offset;
+	char * end = cp + sect->size;
+	char * next;
+	trkBinRecord_t rec;
+	track_p * last;
+	trkBinLinks_t * links;
+
+	while ( cp < end ) {
+		if ( (next = NextTrackRecord( image, cp, end, &rec )) == NULL )
+			return BadImage( _("Binary layout file: truncated track record") );
+		last = to_last;
+		if ( !ReadTrackText( rec.body, rec.bodyEnd-rec.body ) )
+			return FALSE;
+		/* The links are applied once every track has been read */
+		if ( *last != NULL && GetTrkIndex( *last ) == rec.index &&
+			 GetTrkEndPtCnt( *last ) == rec.endCnt && rec.endCnt > 0 ) {
+			DYNARR_APPEND( trkBinLinks_t, trkBinLinks_da, 1000 );
+			links = &DYNARR_LAST( trkBinLinks_t, trkBinLinks_da );
+			links->trk = *last;
+			links->links = rec.links;
+		}
+		cp = next;
+	}
+	return TRUE;
+}
+
+
+static void LinkTrackRecords( void )
+{
+	int inx;
+	EPINX_T ep;
+	trkBinLinks_t * links;
+	TRKINX_T index;
+	for ( inx=0; inx<trkBinLinks_da.cnt; inx++ ) {
+		links = &DYNARR_N( trkBinLinks_t, trkBinLinks_da, inx );
+		for ( ep=0; ep<GetTrkEndPtCnt( links->trk ); ep++ ) {
+			index = (TRKINX_T)GetU32( links->links+4*ep );
+			if ( index > 0 && links->trk->endPt[ep].index == index )
+				links->trk->endPt[ep].track = FindTrack( index );
+		}
+	}
+	DYNARR_RESET( trkBinLinks_t, trkBinLinks_da );
+}
+
+
+/*
+ * Sets of track indexes, used to find the hidden layers connected to others
+ */
+static void IndexSetClear( void )
+{
+	DYNARR_RESET( char, trkBinIndexSet_da );
+}
+
+
+static void IndexSetAdd( TRKINX_T index )
+{
+	int cnt = trkBinIndexSet_da.cnt;
+	int newCnt = index+1;
+	if ( index <= 0 )
+		return;
+	if ( newCnt > cnt ) {
+		DYNARR_SET( char, trkBinIndexSet_da, newCnt );
+		memset( &DYNARR_N( char, trkBinIndexSet_da, cnt ), 0, newCnt-cnt );
+	}
+	DYNARR_N( char, trkBinIndexSet_da, index ) = 1;
+}
+
+
+static BOOL_T IndexSetHas( TRKINX_T index )
+{
+	return index > 0 && index < trkBinIndexSet_da.cnt &&
+		   DYNARR_N( char, trkBinIndexSet_da, index ) != 0;
+}
+
+
+/* Add the indexes of the tracks in a section to the set */
+static void IndexSetAddSection( char * image, trkBinSection_t * sect )
+{
+	char * cp = image + sect->offset;
+	char * end = cp + sect->size;
+	trkBinRecord_t rec;
+	while ( cp < end && (cp = NextTrackRecord( image, cp, end, &rec )) != NULL )
+		IndexSetAdd( rec.index );
+}
+
+
+/* The highest index of the tracks in a section */
+static TRKINX_T MaxSectionIndex( char * image, trkBinSection_t * sect )
+{
+	char * cp = image + sect->offset;
+	char * end = cp + sect->size;
+	trkBinRecord_t rec;
+	TRKINX_T index = 0;
+	while ( cp < end && (cp = NextTrackRecord( image, cp, end, &rec )) != NULL )
+		if ( index < rec.index )
+			index = rec.index;
+	return index;
+}
+
+
+/* TRUE if a track in the section is connected to a track in the set */
+static BOOL_T IndexSetLinked( char * image, trkBinSection_t * sect )
+{
+	char * cp = image + sect->offset;
+	char * end = cp + sect->size;
+	trkBinRecord_t rec;
+	EPINX_T ep;
+	while ( cp < end && (cp = NextTrackRecord( image, cp, end, &rec )) != NULL )
+		for ( ep=0; ep<rec.endCnt; ep++ )
+			if ( IndexSetHas( (TRKINX_T)GetU32( rec.links+4*ep ) ) )
+				return TRUE;
+	return FALSE;
+}
+
+
+/**
+ * Decide which track sections are left unread and keep copies of them.
+ * Called once the text before the tracks, which defines the layers, has
+ * been read.
+ *
+ * \param image IN the file image
+ * \param hideLayer IN returns TRUE for the layers which may be left unread
+ */
+static void HideLayers(
+		char * image,
+		BOOL_T (*hideLayer)( unsigned int ) )
+{
+	trkBinSection_t * sect;
+	trkBinHidden_t * hidden;
+	trkBinRecord_t rec;
+	char * cp;
+	char * end;
+	const char ** ref;
+	BOOL_T any = FALSE;
+	BOOL_T changed;
+	TRKINX_T index;
+	int inx;
+
+	IndexSetClear();
+	for ( inx=0; inx<trkBinSections_da.cnt; inx++ ) {
+		sect = &trkBinSections(inx);
+		if ( sect->kind != TRKBIN_TRACKS )
+			continue;
+		sect->hidden = hideLayer( sect->layer );
+		any |= sect->hidden;
+		cp = image + sect->offset;
+		end = cp + sect->size;
+		while ( cp < end ) {
+			/* a bad record is reported when the section is read */
+			if ( (cp = NextTrackRecord( image, cp, end, &rec )) == NULL )
+				goto readAll;
+			for ( ref=trkBinIndexRefs; *ref; ref++ )
+				if ( strncmp( rec.body, *ref, strlen( *ref ) ) == 0 )
+					goto readAll;
+			if ( !sect->hidden )
+				IndexSetAdd( rec.index );
+		}
+	}
+	if ( !any )
+		return;
+
+	do {
+		changed = FALSE;
+		for ( inx=0; inx<trkBinSections_da.cnt; inx++ ) {
+			sect = &trkBinSections(inx);
+			if ( sect->hidden && IndexSetLinked( image, sect ) ) {
+				sect->hidden = FALSE;
+				IndexSetAddSection( image, sect );
+				changed = TRUE;
+			}
+		}
+	} while ( changed );
+
+	for ( inx=0; inx<trkBinSections_da.cnt; inx++ ) {
+		sect = &trkBinSections(inx);
+		if ( !sect->hidden )
+			continue;
+		DYNARR_APPEND( trkBinHidden_t, trkBinHidden_da, 10 );
+		hidden = &DYNARR_LAST( trkBinHidden_t, trkBinHidden_da );
+		hidden->image = MyMalloc( sect->size );
+		memcpy( hidden->image, image+sect->offset, sect->size );
+		hidden->sect = *sect;
+		hidden->sect.offset = 0;
+		hidden->read = FALSE;
+		if ( trkBinHiddenMaxIndex < (index = MaxSectionIndex( image, sect )) )
+			trkBinHiddenMaxIndex = index;
+		LOG( log_trkbin, 1, ( "HideLayers: layer %ld, %ld tracks not read\n",
+					sect->layer, sect->recordCnt ) );
+	}
+	/* new tracks must not take the index of an unread one */
+	if ( max_index < trkBinHiddenMaxIndex )
+		max_index = trkBinHiddenMaxIndex;
+	trkBinHiddenVersion = paramVersion;
+	if ( trkBinHiddenFile )
+		MyFree( trkBinHiddenFile );
+	trkBinHiddenFile = MyStrdup( paramFileName ? paramFileName : "" );
+	return;
+
+readAll:
+	for ( inx=0; inx<trkBinSections_da.cnt; inx++ )
+		trkBinSections(inx).hidden = FALSE;
+}
+
+
+/**
+ * Read the tracks left unread by ReadTracksBinary on layers which are now
+ * visible or current, or all of them.  Hidden layers connected to those are
+ * read as well.  The new tracks are resolved among themselves, like an
+ * import, put ahead of the tracks of the commands which can be undone, see
+ * UndoLoadEnd, and the tracks are renumbered.
+ *
+ * \param all IN read every layer
+ * \return TRUE if tracks were read
+ */
+EXPORT BOOL_T LoadHiddenLayers( BOOL_T all )
+{
+	trkBinHidden_t * hidden;
+	track_p * start = to_last;
+	track_p to_firstOld;
+	long oldVersion = paramVersion;
+	char * oldFileName = paramFileName;
+	char * oldLocale;
+	BOOL_T changed;
+	BOOL_T any = FALSE;
+	TRKINX_T index;
+	long trackCnt = 0;
+	long time0 = wGetTimer();
+	int inx, cnt;
+
+	if ( trkBinHidden_da.cnt == 0 )
+		return FALSE;
+	IndexSetClear();
+	for ( inx=0; inx<trkBinHidden_da.cnt; inx++ ) {
+		hidden = &trkBinHidden(inx);
+		hidden->read = all || GetLayerVisible( hidden->sect.layer ) ||
+					   hidden->sect.layer == curLayer;
+		if ( hidden->read ) {
+			IndexSetAddSection( hidden->image, &hidden->sect );
+			any = TRUE;
+		}
+	}
+	if ( !any )
+		return FALSE;
+	do {
+		changed = FALSE;
+		for ( inx=0; inx<trkBinHidden_da.cnt; inx++ ) {
+			hidden = &trkBinHidden(inx);
+			if ( !hidden->read && IndexSetLinked( hidden->image, &hidden->sect ) ) {
+				hidden->read = TRUE;
+				IndexSetAddSection( hidden->image, &hidden->sect );
+				changed = TRUE;
+			}
+		}
+	} while ( changed );
+
+	oldLocale = SaveLocale( "C" );
+	paramVersion = trkBinHiddenVersion;
+	paramFileName = trkBinHiddenFile;
+	DYNARR_RESET( trkBinLinks_t, trkBinLinks_da );
+	UndoLoadStart();
+	trkBinHiddenMaxIndex = 0;
+	for ( inx=0, cnt=0; inx<trkBinHidden_da.cnt; inx++ ) {
+		hidden = &trkBinHidden(inx);
+		if ( !hidden->read ) {
+			if ( trkBinHiddenMaxIndex < (index = MaxSectionIndex( hidden->image, &hidden->sect )) )
+				trkBinHiddenMaxIndex = index;
+			trkBinHidden(cnt++) = *hidden;
+			continue;
+		}
+		ReadTrackRecords( hidden->image, &hidden->sect );
+		trackCnt += hidden->sect.recordCnt;
+		MyFree( hidden->image );
+	}
+	DYNARR_SET( trkBinHidden_t, trkBinHidden_da, cnt );
+	LinkTrackRecords();
+	SortTracksByIndex( start );
+	to_firstOld = to_first;
+	to_first = *start;
+	ResolveIndex();
+	to_first = to_firstOld;
+	UndoLoadEnd( start, (wIndex_t)trackCnt );
+	RenumberTracks();
+	RecomputeElevations();
+	AttachTrains();
+	LayerSetCounts();
+	paramVersion = oldVersion;
+	paramFileName = oldFileName;
+	RestoreLocale( oldLocale );
+	LOG( log_trkbin, 1, ( "LoadHiddenLayers: %ld tracks (%ld ms)\n",
+				trackCnt, wGetTimer()-time0 ) );
+	return TRUE;
+}
+
+
+/**
+ * Forget the tracks left unread, when the layout is cleared.
+ */
+EXPORT void FreeHiddenLayers( void )
+{
+	int inx;
+	for ( inx=0; inx<trkBinHidden_da.cnt; inx++ )
+		MyFree( trkBinHidden(inx).image );
+	DYNARR_RESET( trkBinHidden_t, trkBinHidden_da );
+	trkBinHiddenMaxIndex = 0;
+}
+
+
+/**
+ * Tracks left unread keep the indexes they were written with, so the others
+ * are numbered after them.
+ *
+ * \return the highest index of the tracks left unread, or 0
+ */
+EXPORT TRKINX_T HiddenLayerMaxIndex( void )
+{
+	return trkBinHiddenMaxIndex;
+}
+
+
+/**
+ * Count the tracks left unread on a layer.
+ *
+ * \param layer IN the layer
+ * \return the number of tracks LoadHiddenLayers would read for it
+ */
+EXPORT long HiddenLayerTrackCount( unsigned int layer )
+{
+	long cnt = 0;
+	int inx;
+	for ( inx=0; inx<trkBinHidden_da.cnt; inx++ )
+		if ( trkBinHidden(inx).sect.layer == layer )
+			cnt += trkBinHidden(inx).sect.recordCnt;
+	return cnt;
+}
+
+
+/**
+ * Read tracks from an image of a binary layout file.  The tracks are appended
+ * to the track list in the order they were written.  Endpoints are linked as
+ * far as the tracks they connect to were read; ResolveIndex does the rest.
+ * The image is modified.
+ *
+ * \param image IN the file image
+ * \param size IN size of the image
+ * \param hideLayer IN returns TRUE for layers whose tracks may be left for LoadHiddenLayers, can be NULL
+ * \return FALSE if the image is bad or reading was stopped
+ */
+EXPORT BOOL_T ReadTracksBinary(
+		char * image,
+		size_t size,
+		BOOL_T (*hideLayer)( unsigned int ) )
+{
+	const unsigned char * hdr = (unsigned char*)image;
+	unsigned long version, sectionCnt, tableOffset;
+	trkBinSection_t * sect;
+	track_p * start = to_last;
+	char * text;
+	char * textEnd;
+	int inx;
+	BOOL_T rc = TRUE;
+	BOOL_T hideDone = ( hideLayer == NULL );
+	long time0 = wGetTimer();
+
+	LogTrkBinInit();
+	if ( !IsTracksBinary( image, size ) )
+		return BadImage( _("Not a binary layout file") );
+	version = GetU32( hdr+TRKBIN_MAGIC_SIZE );
+	sectionCnt = GetU32( hdr+TRKBIN_MAGIC_SIZE+4 );
+	tableOffset = GetU32( hdr+TRKBIN_MAGIC_SIZE+12 );
+	if ( version > TRKBIN_VERSION ) {
+		InputError( _("Binary layout file version %ld is not supported"), FALSE, version );
+		return FALSE;
+	}
+	if ( tableOffset < TRKBIN_HEADER_SIZE || tableOffset > size ||
+		 sectionCnt > (size-tableOffset)/TRKBIN_SECTION_SIZE )
+		return BadImage( _("Binary layout file: bad section table") );
+
+	DYNARR_SET( trkBinSection_t, trkBinSections_da, (int)sectionCnt );
+	for ( inx=0; inx<(int)sectionCnt; inx++ ) {
+		hdr = (unsigned char*)image + tableOffset + inx*TRKBIN_SECTION_SIZE;
+		sect = &trkBinSections(inx);
+		sect->kind = GetU32( hdr );
+		sect->layer = GetU32( hdr+4 );
+		sect->recordCnt = GetU32( hdr+8 );
+		sect->offset = GetU32( hdr+12 );
+		sect->size = GetU32( hdr+16 );
+		sect->hidden = FALSE;
+		if ( sect->offset < TRKBIN_HEADER_SIZE || sect->offset > tableOffset ||
+			 sect->size > tableOffset - sect->offset )
+			return BadImage( _("Binary layout file: bad section table") );
+	}
+
+	DYNARR_RESET( trkBinLinks_t, trkBinLinks_da );
+	for ( inx=0; rc && inx<(int)sectionCnt; inx++ ) {
+		sect = &trkBinSections(inx);
+		switch ( sect->kind ) {
+		case TRKBIN_TEXT:
+		case TRKBIN_CARS:
+			text = image + sect->offset;
+			if ( (textEnd = TextEnd( text, sect->size )) == NULL ) {
+				rc = BadImage( _("Binary layout file: unterminated text") );
+				break;
+			}
+			rc = ReadTrackText( text, textEnd-text );
+			break;
+		case TRKBIN_TRACKS:
+			if ( !hideDone ) {
+				/* the layers are known now */
+				HideLayers( image, hideLayer );
+				hideDone = TRUE;
+			}
+			if ( sect->hidden )
+				break;
+			rc = ReadTrackRecords( image, sect );
+			break;
+		default:
+			/* written by a later version, not needed to read this one */
+			break;
+		}
+	}
+	LinkTrackRecords();
+	SortTracksByIndex( start );
+	LOG( log_trkbin, 1, ( "ReadTracksBinary: %ld sections (%ld ms)\n",
+				sectionCnt, wGetTimer()-time0 ) );
+	return rc;
+}
+
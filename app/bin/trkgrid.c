@@ -0,0 +1,485 @@
+/** \file trkgrid.c
+ * Spatial indexes over the track bounding boxes and the unconnected endpoints
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "misc.h"
+#include "track.h"
+#include "trackx.h"
+#include "utility.h"
+#include "uthash.h"
+
+/*
+ * Every track is registered in each cell of a uniform grid that its bounding
+ * box overlaps.  Only occupied cells exist; they are kept in a hash table so
+ * the grid has no fixed extent.  Tracks which cover many cells (long straights,
+ * benchwork, table edges) are kept on a separate list which every query checks.
+ *
+ * The cells a track is registered in are remembered in the track (trk->grid)
+ * so the track can be found again when its bounding box changes.
+ *
+ * The unconnected endpoints are kept in a second, finer hash of cells so that
+ * partner endpoints can be found without looking at every track.  The cells a
+ * track's endpoints are registered in are remembered in trk->grid.endPts_da.
+ */
+
+#define GRID_CELL_SIZE	(12.0)	/**< edge length of a cell in layout units */
+#define GRID_MAX_SPAN	(16)	/**< tracks spanning more cells are 'large' */
+#define GRID_LIMIT		(INT_MAX/4)
+#define EPGRID_CELL_SIZE	(1.0)	/**< edge length of an endpoint cell */
+
+typedef struct {
+		int x;
+		int y;
+		} gridKey_t;
+
+typedef struct gridCell_t {
+		gridKey_t key;
+		dynArr_t trks_da;		/**< tracks overlapping this cell */
+		UT_hash_handle hh;		/**< makes this structure hashable */
+		} gridCell_t;
+
+typedef struct epCell_t {
+		gridKey_t key;
+		dynArr_t endPts_da;		/**< unconnected endpoints in this cell */
+		UT_hash_handle hh;
+		} epCell_t;
+
+typedef struct {
+		gridCell_t * cells;
+		dynArr_t large_da;
+		epCell_t * epCells;
+		} trackGrid_t;
+
+static trackGrid_t trackGrid;
+static trackGrid_t savedTrackGrid;
+static unsigned long gridMark = 0;
+
+#define gridTrk(DA,N) DYNARR_N( track_p, DA, N )
+#define gridEndPt(DA,N) DYNARR_N( trkEndPtRef_t, DA, N )
+#define gridKey(DA,N) DYNARR_N( gridKey_t, DA, N )
+
+
+static int GridQuantize( double v, double size )
+{
+	double c = floor( v / size );
+	if ( c < -GRID_LIMIT )
+		return -GRID_LIMIT;
+	if ( c > GRID_LIMIT )
+		return GRID_LIMIT;
+	return (int)c;
+}
+
+
+static int GridCoord( double v )
+{
+	return GridQuantize( v, GRID_CELL_SIZE );
+}
+
+
+static gridCell_t * GridFindCell( int x, int y )
+{
+	gridCell_t * cell;
+	gridKey_t key;
+	memset( &key, 0, sizeof key );
+	key.x = x;
+	key.y = y;
+	HASH_FIND( hh, trackGrid.cells, &key, sizeof key, cell );
+	return cell;
+}
+
+
+static void GridListRemove( dynArr_t * trks_da, track_p trk )
+{
+	int inx;
+	for ( inx=0; inx<trks_da->cnt; inx++ ) {
+		if ( gridTrk( *trks_da, inx ) == trk ) {
+			gridTrk( *trks_da, inx ) = gridTrk( *trks_da, trks_da->cnt-1 );
+			trks_da->cnt--;
+			return;
+		}
+	}
+}
+
+
+static void GridCellAdd( int x, int y, track_p trk )
+{
+	gridCell_t * cell = GridFindCell( x, y );
+	if ( cell == NULL ) {
+		cell = (gridCell_t*)MyMalloc( sizeof *cell );
+		cell->key.x = x;
+		cell->key.y = y;
+		HASH_ADD( hh, trackGrid.cells, key, sizeof cell->key, cell );
+	}
+	DYNARR_APPEND( track_p, cell->trks_da, 10 );
+	DYNARR_LAST( track_p, cell->trks_da ) = trk;
+}
+
+
+static void GridCellRemove( int x, int y, track_p trk )
+{
+	gridCell_t * cell = GridFindCell( x, y );
+	if ( cell == NULL )
+		return;
+	GridListRemove( &cell->trks_da, trk );
+	if ( cell->trks_da.cnt == 0 ) {
+		HASH_DEL( trackGrid.cells, cell );
+		DYNARR_FREE( track_p, cell->trks_da );
+		MyFree( cell );
+	}
+}
+
+
+static void GridInsert( track_p trk )
+{
+	int x, y;
+	trk->grid.x0 = GridCoord( trk->lo.x );
+	trk->grid.y0 = GridCoord( trk->lo.y );
+	trk->grid.x1 = GridCoord( trk->hi.x );
+	trk->grid.y1 = GridCoord( trk->hi.y );
+	trk->grid.large = ( trk->grid.x1 - trk->grid.x0 >= GRID_MAX_SPAN ||
+	                    trk->grid.y1 - trk->grid.y0 >= GRID_MAX_SPAN );
+	if ( trk->grid.large ) {
+		DYNARR_APPEND( track_p, trackGrid.large_da, 10 );
+		DYNARR_LAST( track_p, trackGrid.large_da ) = trk;
+	} else {
+		for ( x=trk->grid.x0; x<=trk->grid.x1; x++ )
+			for ( y=trk->grid.y0; y<=trk->grid.y1; y++ )
+				GridCellAdd( x, y, trk );
+	}
+	trk->grid.inGrid = TRUE;
+}
+
+
+static void GridRemove( track_p trk )
+{
+	int x, y;
+	if ( !trk->grid.inGrid )
+		return;
+	if ( trk->grid.large ) {
+		GridListRemove( &trackGrid.large_da, trk );
+	} else {
+		for ( x=trk->grid.x0; x<=trk->grid.x1; x++ )
+			for ( y=trk->grid.y0; y<=trk->grid.y1; y++ )
+				GridCellRemove( x, y, trk );
+	}
+	trk->grid.inGrid = FALSE;
+}
+
+
+static epCell_t * EndPtFindCell( int x, int y )
+{
+	epCell_t * cell;
+	gridKey_t key;
+	memset( &key, 0, sizeof key );
+	key.x = x;
+	key.y = y;
+	HASH_FIND( hh, trackGrid.epCells, &key, sizeof key, cell );
+	return cell;
+}
+
+
+static void EndPtRemove( track_p trk )
+{
+	int inx, inx2;
+	epCell_t * cell;
+	for ( inx=0; inx<trk->grid.endPts_da.cnt; inx++ ) {
+		cell = EndPtFindCell( gridKey( trk->grid.endPts_da, inx ).x,
+		                      gridKey( trk->grid.endPts_da, inx ).y );
+		if ( cell == NULL )
+			continue;
+		for ( inx2=0; inx2<cell->endPts_da.cnt; ) {
+			if ( gridEndPt( cell->endPts_da, inx2 ).trk == trk ) {
+				gridEndPt( cell->endPts_da, inx2 ) = gridEndPt( cell->endPts_da, cell->endPts_da.cnt-1 );
+				cell->endPts_da.cnt--;
+			} else {
+				inx2++;
+			}
+		}
+		if ( cell->endPts_da.cnt == 0 ) {
+			HASH_DEL( trackGrid.epCells, cell );
+			DYNARR_FREE( trkEndPtRef_t, cell->endPts_da );
+			MyFree( cell );
+		}
+	}
+	DYNARR_RESET( gridKey_t, trk->grid.endPts_da );
+}
+
+
+static void EndPtInsert( track_p trk )
+{
+	EPINX_T ep;
+	epCell_t * cell;
+	int x, y;
+	for ( ep=0; ep<trk->endCnt; ep++ ) {
+		if ( trk->endPt[ep].track != NULL )
+			continue;
+		x = GridQuantize( trk->endPt[ep].pos.x, EPGRID_CELL_SIZE );
+		y = GridQuantize( trk->endPt[ep].pos.y, EPGRID_CELL_SIZE );
+		if ( (cell = EndPtFindCell( x, y )) == NULL ) {
+			cell = (epCell_t*)MyMalloc( sizeof *cell );
+			cell->key.x = x;
+			cell->key.y = y;
+			HASH_ADD( hh, trackGrid.epCells, key, sizeof cell->key, cell );
+		}
+		DYNARR_APPEND( trkEndPtRef_t, cell->endPts_da, 10 );
+		DYNARR_LAST( trkEndPtRef_t, cell->endPts_da ).trk = trk;
+		DYNARR_LAST( trkEndPtRef_t, cell->endPts_da ).ep = ep;
+		DYNARR_APPEND( gridKey_t, trk->grid.endPts_da, 4 );
+		DYNARR_LAST( gridKey_t, trk->grid.endPts_da ).x = x;
+		DYNARR_LAST( gridKey_t, trk->grid.endPts_da ).y = y;
+	}
+}
+
+
+/**
+ * Re-register the unconnected endpoints of a track.  Called whenever an
+ * endpoint is moved, connected or disconnected.  Tracks which are not
+ * registered in the grid are ignored.
+ *
+ * \param trk IN the track
+ */
+EXPORT void GridUpdateEndPts( track_p trk )
+{
+	if ( !trk->grid.inGrid )
+		return;
+	EndPtRemove( trk );
+	EndPtInsert( trk );
+}
+
+
+/**
+ * Register a new track in the grid.
+ *
+ * \param trk IN the track
+ */
+EXPORT void GridAddTrack( track_p trk )
+{
+	trk->grid.mark = 0;
+	memset( &trk->grid.endPts_da, 0, sizeof trk->grid.endPts_da );
+	GridInsert( trk );
+}
+
+
+/**
+ * Remove a track from the grid before it is freed.
+ *
+ * \param trk IN the track
+ */
+EXPORT void GridDeleteTrack( track_p trk )
+{
+	EndPtRemove( trk );
+	DYNARR_FREE( gridKey_t, trk->grid.endPts_da );
+	GridRemove( trk );
+}
+
+
+/**
+ * Move a track to the cells covered by its current bounding box.  Called
+ * whenever the bounding box is set.  Tracks which are not registered (like the
+ * temporary copies built by undo) are ignored.
+ *
+ * \param trk IN the track
+ */
+EXPORT void GridUpdateTrack( track_p trk )
+{
+	if ( !trk->grid.inGrid )
+		return;
+	if ( trk->grid.x0 == GridCoord( trk->lo.x ) &&
+		 trk->grid.y0 == GridCoord( trk->lo.y ) &&
+		 trk->grid.x1 == GridCoord( trk->hi.x ) &&
+		 trk->grid.y1 == GridCoord( trk->hi.y ) )
+		return;
+	GridRemove( trk );
+	GridInsert( trk );
+}
+
+
+static int CompareEndPtRef( const void * a, const void * b )
+{
+	const trkEndPtRef_t * ref1 = (const trkEndPtRef_t*)a;
+	const trkEndPtRef_t * ref2 = (const trkEndPtRef_t*)b;
+	if ( ref1->trk->seq != ref2->trk->seq )
+		return ( ref1->trk->seq < ref2->trk->seq ) ? -1 : 1;
+	return ref1->ep - ref2->ep;
+}
+
+
+/**
+ * Find the unconnected endpoints within a distance of a point.  The endpoints
+ * are returned in track list order and, for each track, in endpoint order.
+ *
+ * \param pos IN the point
+ * \param dist IN the distance
+ * \param endPts_da OUT array of trkEndPtRef_t, reset before use
+ */
+EXPORT void GridFindEndPtsNear( coOrd pos, DIST_T dist, dynArr_t * endPts_da )
+{
+	int x0, y0, x1, y1, x, y, inx;
+	epCell_t * cell;
+	trkEndPtRef_t ref;
+
+	DYNARR_RESET( trkEndPtRef_t, *endPts_da );
+	x0 = GridQuantize( pos.x - dist, EPGRID_CELL_SIZE );
+	y0 = GridQuantize( pos.y - dist, EPGRID_CELL_SIZE );
+	x1 = GridQuantize( pos.x + dist, EPGRID_CELL_SIZE );
+	y1 = GridQuantize( pos.y + dist, EPGRID_CELL_SIZE );
+	for ( x=x0; x<=x1; x++ ) {
+		for ( y=y0; y<=y1; y++ ) {
+			if ( (cell = EndPtFindCell( x, y )) == NULL )
+				continue;
+			for ( inx=0; inx<cell->endPts_da.cnt; inx++ ) {
+				ref = gridEndPt( cell->endPts_da, inx );
+				if ( ref.trk->deleted ||
+					 ref.trk->endPt[ref.ep].track != NULL ||
+					 FindDistance( pos, ref.trk->endPt[ref.ep].pos ) > dist )
+					continue;
+				DYNARR_APPEND( trkEndPtRef_t, *endPts_da, 10 );
+				DYNARR_LAST( trkEndPtRef_t, *endPts_da ) = ref;
+			}
+		}
+	}
+	if ( endPts_da->cnt > 1 )
+		qsort( endPts_da->ptr, endPts_da->cnt, sizeof (trkEndPtRef_t), CompareEndPtRef );
+}
+
+
+static int CompareTrackSeq( const void * a, const void * b )
+{
+	long seq1 = (*(track_p*)a)->seq;
+	long seq2 = (*(track_p*)b)->seq;
+	return ( seq1 < seq2 ) ? -1 : ( seq1 > seq2 ) ? 1 : 0;
+}
+
+
+static void GridCollect( dynArr_t * from_da, coOrd lo, coOrd hi, layerTest_p layerTest, dynArr_t * trks_da )
+{
+	int inx;
+	track_p trk;
+	for ( inx=0; inx<from_da->cnt; inx++ ) {
+		trk = gridTrk( *from_da, inx );
+		if ( trk->grid.mark == gridMark )
+			continue;
+		trk->grid.mark = gridMark;
+		if ( trk->deleted )
+			continue;
+		if ( trk->hi.x < lo.x || trk->lo.x > hi.x ||
+			 trk->hi.y < lo.y || trk->lo.y > hi.y )
+			continue;
+		if ( layerTest != NULL && !layerTest( trk->layer ) )
+			continue;
+		DYNARR_APPEND( track_p, *trks_da, 10 );
+		DYNARR_LAST( track_p, *trks_da ) = trk;
+	}
+}
+
+
+/**
+ * Find the tracks whose bounding box intersects a rectangle.  The tracks are
+ * returned in track list (drawing) order.  When the rectangle covers more
+ * cells than are occupied the hot field arrays are scanned instead.
+ *
+ * \param lo IN lower left corner of the rectangle
+ * \param hi IN upper right corner of the rectangle
+ * \param layerTest IN only tracks on layers it accepts, NULL for all layers
+ * \param trks_da OUT array of track_p, reset before use
+ */
+EXPORT void GridFindTracks( coOrd lo, coOrd hi, layerTest_p layerTest, dynArr_t * trks_da )
+{
+	int x0, y0, x1, y1, x, y;
+	gridCell_t * cell;
+
+	DYNARR_RESET( track_p, *trks_da );
+	x0 = GridCoord( lo.x );
+	y0 = GridCoord( lo.y );
+	x1 = GridCoord( hi.x );
+	y1 = GridCoord( hi.y );
+	if ( (double)(x1-x0+1) * (double)(y1-y0+1) >= (double)HASH_COUNT( trackGrid.cells ) ) {
+		HotFindTracks( lo, hi, layerTest, trks_da );
+		return;
+	}
+	gridMark++;
+	for ( x=x0; x<=x1; x++ ) {
+		for ( y=y0; y<=y1; y++ ) {
+			if ( (cell = GridFindCell( x, y )) != NULL )
+				GridCollect( &cell->trks_da, lo, hi, layerTest, trks_da );
+		}
+	}
+	GridCollect( &trackGrid.large_da, lo, hi, layerTest, trks_da );
+	if ( trks_da->cnt > 1 )
+		qsort( trks_da->ptr, trks_da->cnt, sizeof (track_p), CompareTrackSeq );
+}
+
+
+/**
+ * Find the tracks whose bounding box is within a distance of a point.
+ *
+ * \param pos IN the point
+ * \param dist IN the distance
+ * \param layerTest IN only tracks on layers it accepts, NULL for all layers
+ * \param trks_da OUT array of track_p in track list order
+ */
+EXPORT void GridFindTracksNear( coOrd pos, DIST_T dist, layerTest_p layerTest, dynArr_t * trks_da )
+{
+	coOrd lo, hi;
+	lo.x = pos.x - dist;
+	lo.y = pos.y - dist;
+	hi.x = pos.x + dist;
+	hi.y = pos.y + dist;
+	GridFindTracks( lo, hi, layerTest, trks_da );
+}
+
+
+/**
+ * Set aside the grid for the current track list, see SaveTrackState.
+ */
+EXPORT void GridSaveState( void )
+{
+	savedTrackGrid = trackGrid;
+	memset( &trackGrid, 0, sizeof trackGrid );
+}
+
+
+/**
+ * Reinstate the grid saved by GridSaveState.  The current grid is discarded.
+ */
+EXPORT void GridRestoreState( void )
+{
+	gridCell_t * cell, * tmp;
+	epCell_t * epCell, * epTmp;
+	HASH_ITER( hh, trackGrid.cells, cell, tmp ) {
+		HASH_DEL( trackGrid.cells, cell );
+		DYNARR_FREE( track_p, cell->trks_da );
+		MyFree( cell );
+	}
+	DYNARR_FREE( track_p, trackGrid.large_da );
+	HASH_ITER( hh, trackGrid.epCells, epCell, epTmp ) {
+		HASH_DEL( trackGrid.epCells, epCell );
+		DYNARR_FREE( trkEndPtRef_t, epCell->endPts_da );
+		MyFree( epCell );
+	}
+	trackGrid = savedTrackGrid;
+}
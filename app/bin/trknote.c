@@ -28,6 +28,7 @@
 #include "custom.h"
 #include "dynstring.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "misc.h"
 #include "note.h"
@@ -337,7 +338,7 @@ static BOOL_T WriteNote(track_p t, FILE * f)
     struct extraDataNote *xx = (struct extraDataNote *)GetTrkExtraData(t);
     BOOL_T rc = TRUE;
 
-	rc &= fprintf(f, "NOTE %d %u 0 0 %0.6f %0.6f 0 %d", GetTrkIndex(t),
+	rc &= FilePrintf(f, "NOTE %d %u 0 0 %0.6f %0.6f 0 %d", GetTrkIndex(t),
 		GetTrkLayer(t),
 		xx->pos.x, xx->pos.y, xx->op )>0;
 
@@ -366,13 +367,13 @@ static BOOL_T WriteNote(track_p t, FILE * f)
 		}
 	}
 #endif
-	rc &= fprintf( f, " \"%s\"", s[0] )>0;
+	rc &= FilePrintf( f, " \"%s\"", s[0] )>0;
 	MyFree(s[0]);
 	if ( s[1] ) {
-		rc &= fprintf( f, " \"%s\"", s[1] )>0;
+		rc &= FilePrintf( f, " \"%s\"", s[1] )>0;
 		MyFree( s[1] );
 	}
-	rc &= fprintf( f, "\n" )>0;
+	rc &= FilePrintf( f, "\n" )>0;
 	
 	return rc;
 }
@@ -0,0 +1,205 @@
+/** \file trkpool.c
+ * Size class pools for tracks, endpoint arrays and extra data
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+
+#include "common.h"
+#include "misc.h"
+#include "track.h"
+
+/*
+ * Blocks are rounded up to a multiple of POOL_GRAIN and carved out of slabs
+ * of about POOL_SLAB_SIZE bytes.  Freed blocks go onto a free list for their
+ * size class and are handed out again by the next allocation of that class;
+ * slabs are never returned.  Blocks bigger than POOL_MAX_SIZE are passed on to
+ * MyMalloc.
+ *
+ * The caller supplies the size of a block when it is freed or reallocated, so
+ * pooled blocks carry no header.  Debug builds add a size word and the guard
+ * words MyMalloc uses and check them whenever a block is released.
+ */
+
+#define POOL_GRAIN		(16)
+#define POOL_MAX_SIZE	(1024)
+#define POOL_CLASSES	(POOL_MAX_SIZE/POOL_GRAIN)
+#define POOL_SLAB_SIZE	(64*1024)
+
+#if DEBUG
+#define POOL_GUARD0		(0xDEADBEEFUL)
+#define POOL_GUARD1		(0xAF00BA8AUL)
+#define POOL_HEAD		(POOL_GRAIN)
+#define POOL_OVERHEAD	(POOL_HEAD+sizeof(unsigned long))
+#else
+#define POOL_HEAD		(0)
+#define POOL_OVERHEAD	(0)
+#endif
+
+typedef struct poolFree_t {
+		struct poolFree_t * next;
+		} poolFree_t;
+
+typedef struct {
+		poolFree_t * free;
+		char * slab;			/**< unused part of the current slab */
+		long slabLeft;
+		} pool_t;
+
+static pool_t pools[POOL_CLASSES];
+
+#define POOL_CLASS(SIZE) ( ((SIZE)+POOL_OVERHEAD+POOL_GRAIN-1)/POOL_GRAIN - 1 )
+
+
+static BOOL_T IsPooled( long size )
+{
+	return size + (long)POOL_OVERHEAD <= POOL_MAX_SIZE;
+}
+
+
+static char * PoolGet( int class )
+{
+	pool_t * pool = &pools[class];
+	long blockSize = (class+1)*POOL_GRAIN;
+	char * p;
+	if ( pool->free ) {
+		p = (char*)pool->free;
+		pool->free = pool->free->next;
+		return p;
+	}
+	if ( pool->slabLeft < blockSize ) {
+		pool->slabLeft = POOL_SLAB_SIZE - POOL_SLAB_SIZE % blockSize;
+		pool->slab = (char*)MyMalloc( pool->slabLeft );
+	}
+	p = pool->slab;
+	pool->slab += blockSize;
+	pool->slabLeft -= blockSize;
+	return p;
+}
+
+
+static void PoolPut( int class, char * p )
+{
+	poolFree_t * f = (poolFree_t*)p;
+	f->next = pools[class].free;
+	pools[class].free = f;
+}
+
+
+#if DEBUG
+static char * PoolCheck( void * ptr, long size )
+{
+	char * p = (char*)ptr - POOL_HEAD;
+	if ( *(unsigned long*)(p+sizeof(long)) != POOL_GUARD0 )
+		AbortProg( "Pool guard0 is hosed" );
+	if ( *(long*)p != size )
+		AbortProg( "Pool block size is %ld, expected %ld", *(long*)p, size );
+	if ( *(unsigned long*)((char*)ptr+size) != POOL_GUARD1 )
+		AbortProg( "Pool guard1 is hosed" );
+	return p;
+}
+#endif
+
+
+/**
+ * Allocate a zeroed block from the pools.
+ *
+ * \param size IN size of the block
+ * \return the block, NULL if size is 0
+ */
+EXPORT void * PoolAlloc( long size )
+{
+	char * p;
+	if ( size <= 0 )
+		return NULL;
+	if ( !IsPooled( size ) )
+		return MyMalloc( size );
+	p = PoolGet( POOL_CLASS(size) );
+#if DEBUG
+	*(long*)p = size;
+	*(unsigned long*)(p+sizeof(long)) = POOL_GUARD0;
+	*(unsigned long*)(p+POOL_HEAD+size) = POOL_GUARD1;
+#endif
+	p += POOL_HEAD;
+	memset( p, 0, size );
+	return p;
+}
+
+
+/**
+ * Return a block to its pool.
+ *
+ * \param ptr IN the block, may be NULL
+ * \param size IN the size it was allocated with
+ */
+EXPORT void PoolFree( void * ptr, long size )
+{
+	char * p;
+	if ( ptr == NULL )
+		return;
+	if ( !IsPooled( size ) ) {
+		MyFree( ptr );
+		return;
+	}
+#if DEBUG
+	p = PoolCheck( ptr, size );
+#else
+	p = (char*)ptr;
+#endif
+	PoolPut( POOL_CLASS(size), p );
+}
+
+
+/**
+ * Resize a pooled block.  The block stays in place when the size class does
+ * not change.  Any added space is zeroed.
+ *
+ * \param ptr IN the block, may be NULL
+ * \param oldSize IN the size it was allocated with
+ * \param size IN the new size
+ * \return the block, NULL if size is 0
+ */
+EXPORT void * PoolRealloc( void * ptr, long oldSize, long size )
+{
+	void * new;
+	if ( ptr == NULL || oldSize <= 0 )
+		return PoolAlloc( size );
+	if ( size <= 0 ) {
+		PoolFree( ptr, oldSize );
+		return NULL;
+	}
+	if ( !IsPooled( oldSize ) && !IsPooled( size ) )
+		return MyRealloc( ptr, size );
+	if ( IsPooled( oldSize ) && IsPooled( size ) &&
+		 POOL_CLASS(oldSize) == POOL_CLASS(size) ) {
+#if DEBUG
+		char * p = PoolCheck( ptr, oldSize );
+		*(long*)p = size;
+		*(unsigned long*)((char*)ptr+size) = POOL_GUARD1;
+#endif
+		if ( size > oldSize )
+			memset( (char*)ptr+oldSize, 0, size-oldSize );
+		return ptr;
+	}
+	new = PoolAlloc( size );
+	memcpy( new, ptr, (size<oldSize)?size:oldSize );
+	PoolFree( ptr, oldSize );
+	return new;
+}
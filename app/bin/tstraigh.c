@@ -25,6 +25,7 @@
 #include "cstraigh.h"
 #include "cundo.h"
 #include "fileio.h"
+#include "fmtnum.h"
 #include "i18n.h"
 #include "layout.h"
 #include "messages.h"
@@ -368,12 +369,12 @@ static void DeleteStraight( track_p t )
 static BOOL_T WriteStraight( track_p t, FILE * f )
 {
 	BOOL_T rc = TRUE;
-	rc &= fprintf(f, "STRAIGHT %d %d %ld 0 0 %s %d\n",
+	rc &= FilePrintf(f, "STRAIGHT %d %d %ld 0 0 %s %d\n",
 				GetTrkIndex(t), GetTrkLayer(t), (long)GetTrkWidth(t),
 				GetTrkScaleName(t), GetTrkVisible(t)|(GetTrkNoTies(t)?1<<2:0)|(GetTrkBridge(t)?1<<3:0) )>0;
 	rc &= WriteEndPt( f, t, 0 );
 	rc &= WriteEndPt( f, t, 1 );
-	rc &= fprintf(f, "\t%s\n", END_SEGS)>0;
+	rc &= FilePrintf(f, "\t%s\n", END_SEGS)>0;
 	return rc;
 }
 
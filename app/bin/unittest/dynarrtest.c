@@ -0,0 +1,170 @@
+/** \file dynarrtest.c
+* Unit tests and benchmark for the dynamic array macros
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "common.h"
+
+#define APPENDS 1000000L
+
+/* the growth policy DYNARR_APPEND used to have */
+#define FIXED_APPEND(T,DA,INCR) \
+		{ if ((DA).cnt >= (DA).max) { \
+			(DA).max += INCR; \
+			(DA).ptr = MyRealloc( (DA).ptr, (DA).max * sizeof *(T*)NULL ); \
+		} \
+		(DA).cnt++; }
+
+static long reallocs;
+static long long copied;		/**< bytes a copying realloc would have moved */
+
+/*
+ * Minimal allocator standing in for misc.c; the size is kept in front of the
+ * block so the cost of a copying realloc can be counted.
+ */
+
+void *
+MyMalloc(long size)
+{
+	size_t * p = calloc(1, size + sizeof(size_t));
+	*p = size;
+	return p + 1;
+}
+
+void *
+MyRealloc(void *old, long size)
+{
+	size_t * p;
+	size_t oldSize;
+	if (old == NULL)
+		return MyMalloc(size);
+	p = (size_t*)old - 1;
+	if (size == 0) {
+		free(p);
+		return NULL;
+	}
+	oldSize = *p;
+	reallocs++;
+	copied += (oldSize < (size_t)size) ? oldSize : (size_t)size;
+	p = realloc(p, size + sizeof(size_t));
+	if ((size_t)size > oldSize)
+		memset((char*)(p + 1) + oldSize, 0, size - oldSize);
+	*p = size;
+	return p + 1;
+}
+
+void
+MyFree(void *ptr)
+{
+	if (ptr)
+		free((size_t*)ptr - 1);
+}
+
+static double
+Seconds(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+GrowthIsGeometric(void **state)
+{
+	dynArr_t da;
+	long inx;
+	(void)state;
+
+	memset(&da, 0, sizeof da);
+	reallocs = 0;
+	for (inx = 0; inx < APPENDS; inx++) {
+		DYNARR_APPEND(long, da, 10);
+		DYNARR_LAST(long, da) = inx;
+	}
+	assert_int_equal(da.cnt, APPENDS);
+	assert_true(da.max >= da.cnt);
+	assert_true(da.max < 2 * da.cnt);
+	assert_true(reallocs < 64);
+	for (inx = 0; inx < APPENDS; inx++)
+		assert_int_equal(DYNARR_N(long, da, inx), inx);
+
+	DYNARR_TRIM(long, da);
+	assert_int_equal(da.max, APPENDS);
+	assert_int_equal(DYNARR_N(long, da, APPENDS - 1), APPENDS - 1);
+	DYNARR_FREE(long, da);
+	assert_null(da.ptr);
+}
+
+static void
+TrimEmpty(void **state)
+{
+	dynArr_t da;
+	(void)state;
+
+	memset(&da, 0, sizeof da);
+	DYNARR_APPEND(int, da, 10);
+	DYNARR_RESET(int, da);
+	DYNARR_TRIM(int, da);
+	assert_null(da.ptr);
+	assert_int_equal(da.max, 0);
+}
+
+static void
+CompareGrowth(void **state)
+{
+	dynArr_t da;
+	long inx;
+	clock_t start;
+	long fixedReallocs, geomReallocs;
+	long long fixedCopied, geomCopied;
+	double fixedTime, geomTime;
+	(void)state;
+
+	memset(&da, 0, sizeof da);
+	reallocs = 0;
+	copied = 0;
+	start = clock();
+	for (inx = 0; inx < APPENDS; inx++) {
+		FIXED_APPEND(long, da, 10);
+		DYNARR_LAST(long, da) = inx;
+	}
+	fixedTime = Seconds(start);
+	fixedReallocs = reallocs;
+	fixedCopied = copied;
+	DYNARR_FREE(long, da);
+
+	reallocs = 0;
+	copied = 0;
+	start = clock();
+	for (inx = 0; inx < APPENDS; inx++) {
+		DYNARR_APPEND(long, da, 10);
+		DYNARR_LAST(long, da) = inx;
+	}
+	geomTime = Seconds(start);
+	geomReallocs = reallocs;
+	geomCopied = copied;
+	DYNARR_FREE(long, da);
+
+	printf("%ld appends, fixed increment: %ld reallocs, %lld bytes to copy, %.3fs\n",
+		APPENDS, fixedReallocs, fixedCopied, fixedTime);
+	printf("%ld appends, geometric:       %ld reallocs, %lld bytes to copy, %.3fs\n",
+		APPENDS, geomReallocs, geomCopied, geomTime);
+
+	assert_true(geomCopied < 2 * APPENDS * (long long)sizeof(long));
+	assert_true(geomCopied * 1000 < fixedCopied);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(GrowthIsGeometric),
+		cmocka_unit_test(TrimEmpty),
+		cmocka_unit_test(CompareGrowth),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
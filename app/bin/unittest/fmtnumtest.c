@@ -0,0 +1,114 @@
+/** \file fmtnumtest.c
+* Unit tests for the locale independent number formatting
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../fmtnum.h"
+
+static void CheckFixed( double val, int precision )
+{
+	char buff1[512], buff2[512];
+	int len1 = FormatFixed( buff1, sizeof buff1, val, precision );
+	int len2 = snprintf( buff2, sizeof buff2, "%0.*f", precision, val );
+	assert_string_equal( buff1, buff2 );
+	assert_int_equal( len1, len2 );
+}
+
+static void Fixed(void **state)
+{
+	static const double vals[] = {
+		0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 2.675, 1.005, 0.0000005,
+		-0.0000005, 0.0000015, 1e-9, -1e-9, 9.9999995, 123456.1234565,
+		1e15, -1e22, 1e300, 4.9406564584124654e-324 };
+	int inx, precision;
+	(void)state;
+	for ( inx=0; inx<sizeof vals/sizeof vals[0]; inx++ )
+		for ( precision=0; precision<12; precision++ )
+			CheckFixed( vals[inx], precision );
+	CheckFixed( INFINITY, 6 );
+	CheckFixed( -INFINITY, 3 );
+}
+
+static void RandomFixed(void **state)
+{
+	int inx;
+	(void)state;
+	srand( 1 );
+	for ( inx=0; inx<100000; inx++ ) {
+		double val = (rand()-RAND_MAX/2) / (double)(rand()%10000+1);
+		CheckFixed( val, 6 );
+		CheckFixed( val, 3 );
+		CheckFixed( (rand()%2000000) / 2e6, rand()%10 );
+		CheckFixed( ldexp( rand(), rand()%60-40 ), 6 );
+	}
+}
+
+static void Printf(void **state)
+{
+	char buff1[256], buff2[256];
+	FILE * f;
+	int len1, len2;
+	size_t size;
+	(void)state;
+
+	f = tmpfile();
+	assert_non_null( f );
+	FileBuffer( f );
+	len1 = FilePrintf( f, "\tT4 %d %0.6f %0.6f %0.6f %ld %0.3f %u %lx %6.6lx %2.2x %08x %05d %c %% %e %g\n",
+		-12, 1.25, -0.0000004, 123.4567895, 42L, 2.0005, 7u, 0xdeadL, 0x12L, 3, 0xabc, -42, 'Z', 1234.5, 1e-5 );
+	len2 = snprintf( buff2, sizeof buff2, "\tT4 %d %0.6f %0.6f %0.6f %ld %0.3f %u %lx %6.6lx %2.2x %08x %05d %c %% %e %g\n",
+		-12, 1.25, -0.0000004, 123.4567895, 42L, 2.0005, 7u, 0xdeadL, 0x12L, 3, 0xabc, -42, 'Z', 1234.5, 1e-5 );
+	assert_int_equal( len1, len2 );
+	len1 = FilePrintf( f, "TITLE1 %s|%-8s|%8.3s|%-*.*s|%*d|%.*s\n", "Layout", "ab", "abcdef", 6, 2, "abcdef", 4, 5, 3, "xyzzy" );
+	len2 = snprintf( buff2+len2, sizeof buff2-len2, "TITLE1 %s|%-8s|%8.3s|%-*.*s|%*d|%.*s\n", "Layout", "ab", "abcdef", 6, 2, "abcdef", 4, 5, 3, "xyzzy" );
+	assert_int_equal( len1, len2 );
+	rewind( f );
+	size = fread( buff1, 1, sizeof buff1 - 1, f );
+	buff1[size] = '\0';
+	FileClose( f );
+	assert_string_equal( buff1, buff2 );
+}
+
+static void PrintfFallback(void **state)
+{
+	char buff1[256], buff2[256];
+	FILE * f;
+	int len1, len2;
+	size_t size;
+	(void)state;
+
+	f = tmpfile();
+	assert_non_null( f );
+	len1 = FilePrintf( f, "%+ld|% ld|%#lx|%lo|%le|%+lld\n",
+		-123456789012L, 123456789012L, 0x123456789aL, 0123456701234L, 1.5e10, 42LL );
+	len2 = snprintf( buff2, sizeof buff2, "%+ld|% ld|%#lx|%lo|%le|%+lld\n",
+		-123456789012L, 123456789012L, 0x123456789aL, 0123456701234L, 1.5e10, 42LL );
+	assert_int_equal( len1, len2 );
+	len1 = FilePrintf( f, "%*e|%*o|%-*g|%*.*e|\n", -14, 2.5, -6, 8, 10, 0.5, -12, 2, 1e5 );
+	len2 = snprintf( buff2+len2, sizeof buff2-len2, "%*e|%*o|%-*g|%*.*e|\n", -14, 2.5, -6, 8, 10, 0.5, -12, 2, 1e5 );
+	assert_int_equal( len1, len2 );
+	rewind( f );
+	size = fread( buff1, 1, sizeof buff1 - 1, f );
+	buff1[size] = '\0';
+	fclose( f );
+	assert_string_equal( buff1, buff2 );
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(Fixed),
+		cmocka_unit_test(RandomFixed),
+		cmocka_unit_test(Printf),
+		cmocka_unit_test(PrintfFallback),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,96 @@
+/** \file lzblocktest.c
+* Unit tests for the block compressor
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../lzblock.h"
+
+#define BLOCK_SIZE (4096)
+
+static void RoundTrip( const char * src, int size, int expectCompressed )
+{
+	char packed[BLOCK_SIZE+BLOCK_SIZE/8];
+	char unpacked[BLOCK_SIZE];
+	int len;
+	len = LzCompress( src, size, packed, sizeof packed );
+	if ( expectCompressed )
+		assert_in_range( len, 1, size-1 );
+	assert_true( len > 0 );
+	assert_int_equal( LzDecompress( packed, len, unpacked, size ), size );
+	assert_memory_equal( src, unpacked, size );
+}
+
+static void Simple(void **state)
+{
+	static char zeros[BLOCK_SIZE];
+	char buff[BLOCK_SIZE];
+	int inx;
+	(void)state;
+	RoundTrip( zeros, sizeof zeros, 1 );
+	RoundTrip( "a", 1, 0 );
+	RoundTrip( "abcdabcdabcdabcdabcd", 20, 1 );
+	for ( inx=0; inx<BLOCK_SIZE; inx++ )
+		buff[inx] = (char)(inx%7 == 0 ? inx : 0);
+	RoundTrip( buff, sizeof buff, 1 );
+}
+
+static void Random(void **state)
+{
+	char buff[BLOCK_SIZE];
+	int inx, cnt;
+	(void)state;
+	srand( 1 );
+	for ( cnt=0; cnt<1000; cnt++ ) {
+		for ( inx=0; inx<BLOCK_SIZE; inx++ )
+			buff[inx] = (char)(rand()%(cnt%5+1) == 0 ? rand() : 0);
+		RoundTrip( buff, rand()%BLOCK_SIZE+1, 0 );
+	}
+}
+
+static void TooSmall(void **state)
+{
+	char buff[BLOCK_SIZE];
+	char packed[BLOCK_SIZE];
+	int inx;
+	(void)state;
+	srand( 2 );
+	for ( inx=0; inx<BLOCK_SIZE; inx++ )
+		buff[inx] = (char)rand();
+	assert_int_equal( LzCompress( buff, BLOCK_SIZE, packed, BLOCK_SIZE/2 ), 0 );
+}
+
+static void Corrupt(void **state)
+{
+	static char zeros[BLOCK_SIZE];
+	char packed[BLOCK_SIZE];
+	char unpacked[BLOCK_SIZE];
+	int len, inx;
+	(void)state;
+	len = LzCompress( zeros, BLOCK_SIZE, packed, sizeof packed );
+	assert_true( len > 0 );
+	assert_int_equal( LzDecompress( packed, len, unpacked, BLOCK_SIZE/2 ), -1 );
+	assert_true( LzDecompress( packed, len/2, unpacked, BLOCK_SIZE ) != BLOCK_SIZE );
+	srand( 3 );
+	for ( inx=0; inx<10000; inx++ ) {
+		packed[rand()%len] = (char)rand();
+		assert_true( LzDecompress( packed, len, unpacked, BLOCK_SIZE ) <= BLOCK_SIZE );
+	}
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(Simple),
+		cmocka_unit_test(Random),
+		cmocka_unit_test(TooSmall),
+		cmocka_unit_test(Corrupt),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
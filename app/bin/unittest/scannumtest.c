@@ -0,0 +1,99 @@
+/** \file scannumtest.c
+* Unit tests for the locale independent number scanners
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../scannum.h"
+
+static void CheckDouble( const char * str )
+{
+	char * end1, * end2;
+	double val1 = ScanDouble( str, &end1 );
+	double val2 = strtod( str, &end2 );
+	assert_memory_equal( &val1, &val2, sizeof val1 );
+	assert_ptr_equal( end1, end2 );
+}
+
+static void CheckLong( const char * str )
+{
+	char * end1, * end2;
+	assert_int_equal( ScanLong( str, &end1 ), strtol( str, &end2, 10 ) );
+	assert_ptr_equal( end1, end2 );
+}
+
+static void Doubles(void **state)
+{
+	(void)state;
+	CheckDouble( "0" );
+	CheckDouble( "-0.000000" );
+	CheckDouble( "1.5" );
+	CheckDouble( " 12.345678 " );
+	CheckDouble( "+3.25x" );
+	CheckDouble( ".5" );
+	CheckDouble( "5." );
+	CheckDouble( "1e3" );
+	CheckDouble( "1.25E-2" );
+	CheckDouble( "7e" );
+	CheckDouble( "7e+" );
+	CheckDouble( "0.1" );
+	CheckDouble( "123456789012345678901234567890" );
+	CheckDouble( "1e300" );
+	CheckDouble( "4.9406564584124654e-324" );
+	CheckDouble( "-" );
+	CheckDouble( "abc" );
+	CheckDouble( "" );
+}
+
+static void RandomDoubles(void **state)
+{
+	char buff[64];
+	int inx;
+	(void)state;
+	srand( 1 );
+	for ( inx=0; inx<100000; inx++ ) {
+		double val = (rand()-RAND_MAX/2) / (double)(rand()%10000+1);
+		sprintf( buff, "%0.6f", val );
+		CheckDouble( buff );
+		sprintf( buff, "%0.3f", val*1000 );
+		CheckDouble( buff );
+		sprintf( buff, "%0.15g", val );
+		CheckDouble( buff );
+	}
+}
+
+static void Longs(void **state)
+{
+	char buff[32];
+	(void)state;
+	CheckLong( "0" );
+	CheckLong( "-17" );
+	CheckLong( " +42 rest" );
+	CheckLong( "x" );
+	CheckLong( "-" );
+	CheckLong( "99999999999999999999999" );
+	CheckLong( "-99999999999999999999999" );
+	sprintf( buff, "%ld", LONG_MAX );
+	CheckLong( buff );
+	sprintf( buff, "%ld", LONG_MIN );
+	CheckLong( buff );
+	assert_int_equal( ScanULong( "4294967295", NULL ), strtoul( "4294967295", NULL, 10 ) );
+	assert_int_equal( ScanULong( "-1", NULL ), strtoul( "-1", NULL, 10 ) );
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(Doubles),
+		cmocka_unit_test(RandomDoubles),
+		cmocka_unit_test(Longs),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,142 @@
+/** \file workers.c
+ * Run jobs on worker threads
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include "common.h"
+#include "misc.h"
+#include "workers.h"
+
+/*
+ * A job started by StartWorker runs while the main thread goes on.  The main
+ * thread polls for its end, or waits for it for a while, with WaitWorker.
+ * Jobs must only touch memory of their own.  In particular they must not call
+ * wlib, and not MyMalloc either, which keeps unlocked statistics.
+ */
+struct worker_t {
+		workerProc_p proc;
+		void * data;
+#ifdef WINDOWS
+		HANDLE thread;
+#else
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		BOOL_T done;
+#endif
+		};
+
+
+#ifdef WINDOWS
+static DWORD WINAPI WorkerThread( LPVOID arg )
+#else
+static void * WorkerThread( void * arg )
+#endif
+{
+	worker_p worker = (worker_p)arg;
+	worker->proc( worker->data );
+#ifndef WINDOWS
+	pthread_mutex_lock( &worker->mutex );
+	worker->done = TRUE;
+	pthread_cond_signal( &worker->cond );
+	pthread_mutex_unlock( &worker->mutex );
+#endif
+	return 0;
+}
+
+
+/**
+ * Run proc( data ) on a thread of its own.
+ *
+ * \param proc IN the job
+ * \param data IN passed to the job
+ * \return the worker, or NULL if no thread could be started
+ */
+EXPORT worker_p StartWorker( workerProc_p proc, void * data )
+{
+	worker_p worker = (worker_p)MyMalloc( sizeof *worker );
+	worker->proc = proc;
+	worker->data = data;
+#ifdef WINDOWS
+	worker->thread = CreateThread( NULL, 0, WorkerThread, worker, 0, NULL );
+	if ( worker->thread != NULL )
+		return worker;
+#else
+	worker->done = FALSE;
+	pthread_mutex_init( &worker->mutex, NULL );
+	pthread_cond_init( &worker->cond, NULL );
+	if ( pthread_create( &worker->thread, NULL, WorkerThread, worker ) == 0 )
+		return worker;
+	pthread_mutex_destroy( &worker->mutex );
+	pthread_cond_destroy( &worker->cond );
+#endif
+	MyFree( worker );
+	return NULL;
+}
+
+
+/**
+ * Wait until a job started by StartWorker has ended, for at most timeout
+ * milliseconds.  Once it has ended the worker is freed.  A worker which is
+ * never seen to end is left to the end of the process.
+ *
+ * \param worker IN the worker
+ * \param timeout IN milliseconds to wait, 0 to poll
+ * \return TRUE if the job has ended
+ */
+EXPORT BOOL_T WaitWorker( worker_p worker, long timeout )
+{
+#ifdef WINDOWS
+	if ( WaitForSingleObject( worker->thread, (DWORD)timeout ) != WAIT_OBJECT_0 )
+		return FALSE;
+	CloseHandle( worker->thread );
+#else
+	struct timespec until;
+	BOOL_T done;
+
+	clock_gettime( CLOCK_REALTIME, &until );
+	until.tv_sec += timeout/1000;
+	until.tv_nsec += (timeout%1000)*1000000L;
+	if ( until.tv_nsec >= 1000000000L ) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock( &worker->mutex );
+	while ( !worker->done &&
+			pthread_cond_timedwait( &worker->cond, &worker->mutex, &until ) == 0 )
+		;
+	done = worker->done;
+	pthread_mutex_unlock( &worker->mutex );
+	if ( !done )
+		return FALSE;
+	pthread_join( worker->thread, NULL );
+	pthread_mutex_destroy( &worker->mutex );
+	pthread_cond_destroy( &worker->cond );
+#endif
+	MyFree( worker );
+	return TRUE;
+}
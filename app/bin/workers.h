@@ -0,0 +1,32 @@
+/** \file workers.h
+ * Run jobs on worker threads
+ */
+
+/*  XTrkCad - Model Railroad CAD
+ *  Copyright (C) 2005 Dave Bullis
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HAVE_WORKERS_H
+#define HAVE_WORKERS_H
+
+typedef void (*workerProc_p)( void * data );
+typedef struct worker_t * worker_p;
+
+worker_p StartWorker( workerProc_p proc, void * data );
+BOOL_T WaitWorker( worker_p worker, long timeout );
+
+#endif // !HAVE_WORKERS_H
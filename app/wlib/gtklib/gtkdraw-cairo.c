@@ -208,19 +208,25 @@ wBool_t wDrawSetTempMode(
 	return ret;
 }
 
-static cairo_t* gtkDrawCreateCairoContext(
+/*
+ * Between wDrawBeginSession and wDrawEndSession the cairo context of each
+ * target surface (the pixmap and temp_surface) is kept, instead of being
+ * created and destroyed for every primitive.  Lines, arcs, points and
+ * polygon outlines of the same color, width and line type are added to one
+ * path which is stroked when a primitive of another style, or anything
+ * else, is drawn on that surface, or when the session ends.
+ */
+#define SESSION_STROKE_MAX (500)
+
+static cairo_t* gtkDrawGetCairo(
 		wDraw_p bd,
 		GdkDrawable * win,
-		wDrawWidth width,
-		wDrawLineType_e lineType,
-		wDrawColor color,
 		wDrawOpts opts )
 {
 	cairo_t* cairo;
+	wlibDrawSurface_t * ds = NULL;
 
-	if (win)
-		cairo = gdk_cairo_create(win);
-	else {
+	if (win == NULL) {
 		if (opts & wDrawOptTemp) {
 			if ( ! bd->bTempMode )
 				printf( "Temp draw in Main Mode. Contact Developers. See %s:%d\n", "gtkdraw-cario.c", __LINE__+1 );
@@ -233,7 +239,6 @@ static cairo_t* gtkDrawCreateCairoContext(
 	This is not fatal but the draw will be ineffective because the next TempRedraw() will erase the temp surface
 	before the expose event can copy (or bitblt) it
 */
-			cairo = cairo_create(bd->temp_surface);
 		} else {
 			if ( bd->bTempMode )
 				printf( "Main draw in Temp Mode. Contact Developers. See %s:%d\n", "gtkdraw-cario.c", __LINE__+1 );
@@ -244,10 +249,32 @@ static cairo_t* gtkDrawCreateCairoContext(
 	If you set a break point on the printf you'll see the offending wDraw*() call in the traceback
 	This is not fatal but could result in garbage being left on the screen if the command is cancelled.
 */
-			cairo = gdk_cairo_create(bd->pixmap);
+		}
+		if ( bd->sessionDepth > 0 ) {
+			ds = &bd->session[(opts&wDrawOptTemp)?1:0];
+			if ( ds->cairo )
+				return ds->cairo;
 		}
 	}
 
+	if (win)
+		cairo = gdk_cairo_create(win);
+	else if (opts & wDrawOptTemp)
+		cairo = cairo_create(bd->temp_surface);
+	else
+		cairo = gdk_cairo_create(bd->pixmap);
+	if ( ds )
+		ds->cairo = cairo;
+	return cairo;
+}
+
+static void gtkDrawSetStyle(
+		wDraw_p bd,
+		cairo_t * cairo,
+		wDrawWidth width,
+		wDrawLineType_e lineType,
+		wDrawColor color )
+{
 	width = width ? abs(width) : 1;
 	if ( color == wDrawColorWhite )
 		width += 1;  // Remove ghosts
@@ -316,15 +343,144 @@ static cairo_t* gtkDrawCreateCairoContext(
 	bd->lastColor = color;
 
 	cairo_set_source_rgb(cairo, gcolor->red / 65535.0, gcolor->green / 65535.0, gcolor->blue / 65535.0);
+}
+
+/*
+ * Stroke the path collected on a surface of the session.
+ */
+static void gtkDrawFlushSurface(
+		wlibDrawSurface_t * ds )
+{
+	if ( ds->strokeCnt > 0 ) {
+		cairo_stroke( ds->cairo );
+		ds->strokeCnt = 0;
+	}
+}
+
+static void gtkDrawFlushSession(
+		wDraw_p bd )
+{
+	int inx;
+	for ( inx=0; inx<2; inx++ )
+		if ( bd->session[inx].cairo )
+			gtkDrawFlushSurface( &bd->session[inx] );
+}
+
+static void gtkDrawCloseSession(
+		wDraw_p bd )
+{
+	int inx;
+	gtkDrawFlushSession( bd );
+	for ( inx=0; inx<2; inx++ ) {
+		if ( bd->session[inx].cairo ) {
+			cairo_destroy( bd->session[inx].cairo );
+			bd->session[inx].cairo = NULL;
+		}
+	}
+}
+
+/**
+ * Start a drawing session: until the matching wDrawEndSession, drawing on bd
+ * reuses one cairo context per surface and strokes of the same style are
+ * batched.  Sessions may be nested.
+ *
+ * \param bd IN the drawing area
+ */
+void wDrawBeginSession(
+		wDraw_p bd )
+{
+	bd->sessionDepth++;
+}
+
+/**
+ * End a drawing session, drawing whatever is still pending.
+ *
+ * \param bd IN the drawing area
+ */
+void wDrawEndSession(
+		wDraw_p bd )
+{
+	if ( bd->sessionDepth <= 0 )
+		return;
+	if ( --bd->sessionDepth == 0 )
+		gtkDrawCloseSession( bd );
+}
+
+static cairo_t* gtkDrawCreateCairoContext(
+		wDraw_p bd,
+		GdkDrawable * win,
+		wDrawWidth width,
+		wDrawLineType_e lineType,
+		wDrawColor color,
+		wDrawOpts opts )
+{
+	cairo_t* cairo;
+
+	cairo = gtkDrawGetCairo( bd, win, opts );
+	if ( win == NULL && bd->sessionDepth > 0 ) {
+		gtkDrawFlushSurface( &bd->session[(opts&wDrawOptTemp)?1:0] );
+		cairo_save( cairo );
+	}
+	gtkDrawSetStyle( bd, cairo, width, lineType, color );
 
 	return cairo;
 }
 
-static cairo_t* gtkDrawDestroyCairoContext(cairo_t *cairo) {
-	cairo_destroy(cairo);
+static cairo_t* gtkDrawDestroyCairoContext(wDraw_p bd, cairo_t *cairo) {
+	if ( bd->sessionDepth > 0 &&
+		 ( cairo == bd->session[0].cairo || cairo == bd->session[1].cairo ) )
+		cairo_restore(cairo);
+	else
+		cairo_destroy(cairo);
 	return NULL;
 }
 
+/*
+ * Return the context to add a stroked primitive to.  In a session the path
+ * is left to be stroked together with the following primitives of the same
+ * style; gtkDrawEndStroke strokes it otherwise.
+ */
+static cairo_t* gtkDrawBeginStroke(
+		wDraw_p bd,
+		wDrawWidth width,
+		wDrawLineType_e lineType,
+		wDrawColor color,
+		wDrawOpts opts )
+{
+	wlibDrawSurface_t * ds;
+	cairo_t* cairo;
+
+	if ( bd->sessionDepth <= 0 )
+		return gtkDrawCreateCairoContext( bd, NULL, width, lineType, color, opts );
+	ds = &bd->session[(opts&wDrawOptTemp)?1:0];
+	cairo = gtkDrawGetCairo( bd, NULL, opts );
+	if ( ds->strokeCnt > 0 &&
+		 ( ds->width != width || ds->lineType != lineType || ds->color != color ||
+		   ds->strokeCnt >= SESSION_STROKE_MAX ) )
+		gtkDrawFlushSurface( ds );
+	if ( ds->strokeCnt == 0 ) {
+		gtkDrawSetStyle( bd, cairo, width, lineType, color );
+		ds->width = width;
+		ds->lineType = lineType;
+		ds->color = color;
+	}
+	cairo_new_sub_path( cairo );
+	return cairo;
+}
+
+static void gtkDrawEndStroke(
+		wDraw_p bd,
+		cairo_t * cairo,
+		wDrawOpts opts )
+{
+	if ( bd->sessionDepth <= 0 ) {
+		cairo_stroke( cairo );
+		gtkDrawDestroyCairoContext( bd, cairo );
+		return;
+	}
+	bd->session[(opts&wDrawOptTemp)?1:0].strokeCnt++;
+}
+
 #ifdef CURSOR_SURFACE
 cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wPos_t height, wDrawColor color, wDrawOpts opts) {
 
@@ -393,11 +549,10 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 	x1 = INMAPX(bd,x1);
 	y1 = INMAPY(bd,y1);
 
-	cairo_t* cairo = gtkDrawCreateCairoContext(bd, NULL, width, lineType, color, opts);
+	cairo_t* cairo = gtkDrawBeginStroke(bd, width, lineType, color, opts);
 	cairo_move_to(cairo, x0 + 0.5, y0 + 0.5);
 	cairo_line_to(cairo, x1 + 0.5, y1 + 0.5);
-	cairo_stroke(cairo);
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawEndStroke(bd, cairo, opts);
 	if (bd->widget)
 		gtk_widget_queue_draw(GTK_WIDGET(bd->widget)); //,x0,y0+1,x1,y1+1);
 
@@ -444,8 +599,7 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 	h = 2*r;
 
 	// now create the new arc
-	cairo_t* cairo = gtkDrawCreateCairoContext(bd, NULL, width, lineType, color, opts);
-	cairo_new_path(cairo);
+	cairo_t* cairo = gtkDrawBeginStroke(bd, width, lineType, color, opts);
 
 	// its center point marker
 	if(drawCenter)
@@ -461,9 +615,8 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 
 	// draw the curve itself
 	cairo_arc_negative(cairo, INMAPX(bd, x0), INMAPY(bd, y0), r, (angle0 - 90 + angle1) * (M_PI / 180.0), (angle0 - 90) * (M_PI / 180.0));
-	cairo_stroke(cairo);
 
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawEndStroke(bd, cairo, opts);
 	if (bd->widget && !bd->delayUpdate)
 			gtk_widget_queue_draw_area(bd->widget,x,y,w,h);
 
@@ -484,11 +637,9 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 		return;
 	}
 
-	cairo_t* cairo = gtkDrawCreateCairoContext(bd, NULL, 0, wDrawLineSolid, color, opts);
-	cairo_new_path(cairo);
+	cairo_t* cairo = gtkDrawBeginStroke(bd, 0, wDrawLineSolid, color, opts);
 	cairo_arc(cairo, INMAPX(bd, x0), INMAPY(bd, y0), 0.75, 0, 2 * M_PI);
-	cairo_stroke(cairo);
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawEndStroke(bd, cairo, opts);
 	if (bd->widget && !bd->delayUpdate)
 		gtk_widget_queue_draw_area(bd->widget,INMAPX(bd,x0-0.75),INMAPY(bd,y0+0.75),2,2);
 
@@ -552,7 +703,7 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 	pango_cairo_show_layout(cairo, layout);
 	wlibFontDestroyPangoLayout(layout);
 	cairo_restore( cairo );
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 
 	if (bd->delayUpdate || bd->widget == NULL) return;
 
@@ -608,7 +759,7 @@ cairo_t* CreateCursorSurface(wControl_p ct, wSurface_p surface, wPos_t width, wP
 	if (debugWindow >= 3)
 		fprintf(stderr, "text metrics: w=%d, h=%d, d=%d\n", *w, *h, *d);
 
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 }
 
 
@@ -668,7 +819,7 @@ static void wlibDrawFilled(
 	cairo_rel_line_to(cairo, 0, -h);
 	wlibDrawFilled( cairo, color, opt );
 
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 	if (bd->widget && !bd->delayUpdate)
 		gtk_widget_queue_draw_area(GTK_WIDGET(bd->widget),x,y,w,h);
 
@@ -715,7 +866,11 @@ static void wlibDrawFilled(
     	points[i].y = INMAPY(bd,p[i][1]);
 	}
 
-	cairo_t* cairo = gtkDrawCreateCairoContext(bd, NULL, fill?0:dw, fill?wDrawLineSolid:lt, color, opt);
+	cairo_t* cairo;
+	if (fill && !open)
+		cairo = gtkDrawCreateCairoContext(bd, NULL, 0, wDrawLineSolid, color, opt);
+	else
+		cairo = gtkDrawBeginStroke(bd, dw, lt, color, opt);
 
 	for(i = 0; i < cnt; ++i)
 	{
@@ -791,10 +946,10 @@ static void wlibDrawFilled(
 	}
 	if (fill && !open) {
 		wlibDrawFilled( cairo, color, opt );
+		gtkDrawDestroyCairoContext(bd, cairo);
 	} else {
-		cairo_stroke(cairo);
+		gtkDrawEndStroke(bd, cairo, opt);
 	}
-	gtkDrawDestroyCairoContext(cairo);
 	if (bd->widget && !bd->delayUpdate)
 			gtk_widget_queue_draw_area(GTK_WIDGET(bd->widget),min_x,min_y,max_x-min_y,max_y-min_y);
 
@@ -823,7 +978,7 @@ static void wlibDrawFilled(
 	cairo_t* cairo = gtkDrawCreateCairoContext(bd, NULL, 0, wDrawLineSolid, color, opt);
 	cairo_arc(cairo, INMAPX(bd, x0), INMAPY(bd, y0), r, 0, 2 * M_PI);
 	wlibDrawFilled( cairo, color, opt );
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 
 	if (bd->widget)
 			gtk_widget_queue_draw_area(GTK_WIDGET(bd->widget),x,y,w,h);
@@ -836,6 +991,7 @@ static void wlibDrawFilled(
 	static long cDCT = 0;
 	if ( iDrawLog )
 		printf( "wDrawClearTemp %ld\n", cDCT++ );
+	gtkDrawFlushSession( bd );
 	cairo_t* cairo = cairo_create(bd->temp_surface);
 
 	cairo_set_source_rgba(cairo, 0.0, 0.0, 0.0, 0.0);
@@ -863,7 +1019,7 @@ static void wlibDrawFilled(
 	cairo_fill(cairo);
 	if (bd->widget)
 		gtk_widget_queue_draw(bd->widget);
-	gtkDrawDestroyCairoContext(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 
 	wDrawClearTemp(bd);
 }
@@ -1005,7 +1161,7 @@ static void wlibDrawFilled(
 				cairo_fill(cairo);
 			}
 
-	cairo_destroy(cairo);
+	gtkDrawDestroyCairoContext(bd, cairo);
 
 	if (widget && !bd->delayUpdate)
 		gtk_widget_queue_draw_area(GTK_WIDGET(widget), x, y, bm->w, bm->h);
@@ -1025,6 +1181,7 @@ static void wlibDrawFilled(
 		wDraw_p bd )
 {
 	cairo_t * cr;
+	gtkDrawFlushSession( bd );
 	if ( bd->pixmapBackup ) {
 		gdk_pixmap_unref( bd->pixmapBackup );
 	}
@@ -1044,6 +1201,7 @@ static void wlibDrawFilled(
 		wDraw_p bd )
 {
 	GdkRectangle update_rect;
+	gtkDrawFlushSession( bd );
 	if ( bd->pixmapBackup ) {
 
 		cairo_t * cr;
@@ -1085,6 +1243,7 @@ static void wlibDrawFilled(
 	gtk_widget_set_size_request( bd->widget, w, h );
 	if (repaint)
 	{
+		gtkDrawCloseSession( bd );
 		if (bd->pixmap)
 			gdk_pixmap_unref( bd->pixmap );
 		bd->pixmap = gdk_pixmap_new( bd->widget->window, w, h, -1 );
@@ -1166,6 +1325,7 @@ static gint draw_expose_event(
 			event->area.x, event->area.y, event->area.width, event->area.height,
 			0, bd->w, 0, bd->h );
 
+	gtkDrawFlushSession( bd );
 	cairo_t* cairo = gdk_cairo_create (widget->window);
 	gdk_cairo_set_source_pixmap(cairo,bd->pixmap,0,0);
 	cairo_rectangle(cairo,event->area.x, event->area.y,
@@ -1721,7 +1881,7 @@ void wDrawShowBackground( wDraw_p bd, wPos_t pos_x, wPos_t pos_y, wPos_t size, w
 		cairo_mask(cairo,mask);
 		cairo_pattern_destroy(mask);
 		cairo_restore(cairo);
-		gtkDrawDestroyCairoContext(cairo);
+		gtkDrawDestroyCairoContext(bd, cairo);
 
 		gtk_widget_queue_draw(bd->widget);
 	}
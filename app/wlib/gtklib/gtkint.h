@@ -266,6 +266,14 @@ GdkPixbuf *wlibMakePixbuf(wIcon_p ip);
 /* png.c */
 
 /* print.c */
+typedef struct {
+		cairo_t * cairo;		/**< kept for the drawing session */
+		int strokeCnt;			/**< primitives in the path still to be stroked */
+		wDrawWidth width;
+		wDrawLineType_e lineType;
+		wDrawColor color;
+		} wlibDrawSurface_t;
+
 struct wDraw_t {
 		WOBJ_COMMON
 		void * context;
@@ -296,6 +304,8 @@ struct wDraw_t {
 		GdkPixbuf * background;
 
 		wBool_t bTempMode;
+		int sessionDepth;
+		wlibDrawSurface_t session[2];	/**< main and temp surface */
 		};
 
 void WlibApplySettings(GtkPrintOperation *op);
@@ -561,6 +561,8 @@ void wDrawClearTemp(		wDraw_p );
 wBool_t wDrawSetTempMode(	wDraw_p, wBool_t );
 
 void wDrawDelayUpdate(		wDraw_p, wBool_t );
+void wDrawBeginSession(		wDraw_p );
+void wDrawEndSession(		wDraw_p );
 void wDrawClip(			wDraw_p, wPos_t, wPos_t, wPos_t, wPos_t );
 wDrawColor wDrawColorGray(	int );
 wDrawColor wDrawFindColor(	long );
@@ -137,6 +137,16 @@ void wDrawDelayUpdate(
 {
 }
 
+void wDrawBeginSession(
+		wDraw_p d )
+{
+}
+
+void wDrawEndSession(
+		wDraw_p d )
+{
+}
+
 wBool_t wDrawSetTempMode(
 	wDraw_p bd,
 	wBool_t bTemp )